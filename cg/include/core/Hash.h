@@ -0,0 +1,158 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: Hash.h
+// ========
+// Hash functions.
+//
+// Author: Paulo Pagliosa
+// Last revision: 18/10/2026
+
+#ifndef __Hash_h
+#define __Hash_h
+
+#include <cstdint>
+#include <cstring>
+
+namespace cg
+{ // begin namespace cg
+
+namespace hash
+{ // begin namespace hash
+
+inline constexpr uint64_t p1{0x9e3779b185ebca87ULL};
+inline constexpr uint64_t p2{0xc2b2ae3d27d4eb4fULL};
+inline constexpr uint64_t p3{0x165667b19e3779f9ULL};
+inline constexpr uint64_t p4{0x85ebca77c2b2ae63ULL};
+inline constexpr uint64_t p5{0x27d4eb2f165667c5ULL};
+
+inline constexpr uint64_t
+rotl(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+inline constexpr uint64_t
+round64(uint64_t acc, uint64_t x)
+{
+  return rotl(acc + x * p2, 31) * p1;
+}
+
+inline constexpr uint64_t
+merge(uint64_t acc, uint64_t x)
+{
+  return (acc ^ round64(0, x)) * p1 + p4;
+}
+
+inline uint64_t
+read64(const uint8_t* p)
+{
+  uint64_t x;
+
+  memcpy(&x, p, sizeof x);
+  return x;
+}
+
+inline uint32_t
+read32(const uint8_t* p)
+{
+  uint32_t x;
+
+  memcpy(&x, p, sizeof x);
+  return x;
+}
+
+} // end namespace hash
+
+/**
+ * @brief Computes a 64-bit hash of \p size bytes starting at
+ * \p data.
+ *
+ * The function implements the XXH64 algorithm by Yann Collet,
+ * which processes the data in 32-byte stripes at memory speed.
+ * It is not a cryptographic hash; it is intended for content
+ * keys and checksums of cached data.
+ */
+inline uint64_t
+hash64(const void* data, size_t size, uint64_t seed = 0)
+{
+  using namespace hash;
+
+  auto p = static_cast<const uint8_t*>(data);
+  const auto end = p + size;
+  uint64_t h;
+
+  if (size >= 32)
+  {
+    const auto limit = end - 32;
+    auto v1 = seed + p1 + p2;
+    auto v2 = seed + p2;
+    auto v3 = seed;
+    auto v4 = seed - p1;
+
+    do
+    {
+      v1 = round64(v1, read64(p));
+      v2 = round64(v2, read64(p + 8));
+      v3 = round64(v3, read64(p + 16));
+      v4 = round64(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    h = merge(h, v1);
+    h = merge(h, v2);
+    h = merge(h, v3);
+    h = merge(h, v4);
+  }
+  else
+    h = seed + p5;
+  h += (uint64_t)size;
+  for (; p + 8 <= end; p += 8)
+    h = rotl(h ^ round64(0, read64(p)), 27) * p1 + p4;
+  if (p + 4 <= end)
+  {
+    h = rotl(h ^ (read32(p) * p1), 23) * p2 + p3;
+    p += 4;
+  }
+  for (; p < end; ++p)
+    h = rotl(h ^ (*p * p5), 11) * p1;
+  h ^= h >> 33;
+  h *= p2;
+  h ^= h >> 29;
+  h *= p3;
+  return h ^ (h >> 32);
+}
+
+/// Combines the hash \p h with the hash of a value.
+template <typename T>
+inline uint64_t
+hashCombine(uint64_t h, const T& value)
+{
+  return hash64(&value, sizeof(T), h);
+}
+
+} // end namespace cg
+
+#endif // __Hash_h
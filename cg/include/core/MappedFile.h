@@ -0,0 +1,118 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: MappedFile.h
+// ========
+// Class definition for memory-mapped file.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#ifndef __MappedFile_h
+#define __MappedFile_h
+
+#include "core/SharedObject.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// MappedFile: memory-mapped file class
+// ==========
+class MappedFile: public SharedObject
+{
+public:
+  enum class Access
+  {
+    ReadOnly,
+    CopyOnWrite
+  };
+
+  using enum Access;
+
+  /// Maps the file \p filename into memory. Pages mapped with
+  /// copy-on-write access can be modified without changing the
+  /// file. Returns null if the file cannot be mapped.
+  static MappedFile* open(const char* filename, Access = ReadOnly);
+
+  /// Returns a unique name for a temporary file in the directory of
+  /// \p filename. A file to be mapped is written to a temporary file
+  /// which is then renamed to \p filename, hence readers never map
+  /// a partially written file, and writers of the same file do not
+  /// clobber each other.
+  static std::string tempName(const char* filename);
+
+  /// Destructor.
+  ~MappedFile() override;
+
+  auto data() const
+  {
+    return _data;
+  }
+
+  auto size() const
+  {
+    return _size;
+  }
+
+  template <typename T>
+  T* as(size_t offset = 0) const
+  {
+    return reinterpret_cast<T*>(_data + offset);
+  }
+
+  /// Hints the system that the \p size bytes at \p offset of this
+  /// file will be accessed soon, hence their pages can be read
+  /// ahead.
+  void prefetch(size_t offset, size_t size) const;
+
+  /// Hints the system that the \p size bytes at \p offset of this
+  /// file will not be accessed soon, hence their pages can be
+  /// released. Pages accessed afterwards are read again from the
+  /// file, and changes made to pages mapped with copy-on-write
+  /// access may be lost. \p offset should be a multiple of the page
+  /// size.
+  void discard(size_t offset, size_t size) const;
+
+private:
+  uint8_t* _data{};
+  size_t _size{};
+#ifdef _WIN32
+  void* _file{};
+  void* _mapping{};
+#endif // _WIN32
+
+  MappedFile() = default;
+
+}; // MappedFile
+
+} // end namespace cg
+
+#endif // __MappedFile_h
@@ -0,0 +1,228 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: Parallel.h
+// ========
+// Parallel loop utilities.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#ifndef __Parallel_h
+#define __Parallel_h
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cg
+{ // begin namespace cg
+
+/// Returns the number of threads used by parallelFor().
+inline auto
+parallelThreadCount()
+{
+  auto n = std::thread::hardware_concurrency();
+  return n != 0 ? n : 1u;
+}
+
+/**
+ * @brief Calls \p f(begin, end) for consecutive ranges of (at most)
+ * \p grainSize indices in [0, \p count) in parallel.
+ *
+ * The ranges are taken on demand by the calling thread and by up
+ * to parallelThreadCount() - 1 other threads, hence \p f must be
+ * safe to call concurrently for distinct ranges. The first
+ * exception thrown by \p f is rethrown after all threads finish.
+ */
+template <typename F>
+void
+parallelFor(size_t count, size_t grainSize, F&& f)
+{
+  if (grainSize == 0)
+    grainSize = 1;
+
+  auto chunks = (count + grainSize - 1) / grainSize;
+  auto nt = std::min<size_t>(parallelThreadCount(), chunks);
+
+  if (nt <= 1)
+  {
+    if (count > 0)
+      f(size_t(0), count);
+    return;
+  }
+
+  std::atomic<size_t> next{0};
+  std::exception_ptr error;
+  std::mutex errorLock;
+  auto worker = [&]()
+    {
+      for (size_t c; (c = next.fetch_add(1)) < chunks;)
+        try
+        {
+          auto begin = c * grainSize;
+
+          f(begin, std::min(begin + grainSize, count));
+        }
+        catch (...)
+        {
+          std::lock_guard lock{errorLock};
+
+          if (!error)
+            error = std::current_exception();
+          next = chunks;
+        }
+    };
+  std::vector<std::thread> threads;
+
+  threads.reserve(nt - 1);
+  for (size_t i = 1; i < nt; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (auto& thread : threads)
+    thread.join();
+  if (error)
+    std::rethrow_exception(error);
+}
+
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// WorkerPool: background worker pool class
+// ==========
+/**
+ * @brief Bounded pool of threads running background jobs.
+ *
+ * Jobs are run in the order they are pushed by at most maxThreads
+ * threads, started on demand. The destructor discards the jobs not
+ * yet started and waits for the running ones, hence a job must not
+ * take long or must poll a flag of its own to stop early. Jobs
+ * should handle their own exceptions; an exception escaping a job
+ * is discarded.
+ */
+class WorkerPool
+{
+public:
+  using Job = std::function<void()>;
+
+  /// Constructs a pool of up to \p maxThreads threads. The default
+  /// is one thread less than parallelThreadCount(), but at least
+  /// one.
+  explicit WorkerPool(unsigned maxThreads = 0):
+    _maxThreads{maxThreads}
+  {
+    if (_maxThreads == 0)
+    {
+      auto n = parallelThreadCount();
+      _maxThreads = n > 1 ? n - 1 : 1;
+    }
+  }
+
+  /// Destructor.
+  ~WorkerPool()
+  {
+    {
+      std::lock_guard lock{_mutex};
+
+      _stop = true;
+      _jobs.clear();
+    }
+    _cv.notify_all();
+    for (auto& thread : _threads)
+      thread.join();
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator =(const WorkerPool&) = delete;
+
+  void push(Job job)
+  {
+    {
+      std::lock_guard lock{_mutex};
+
+      _jobs.push_back(std::move(job));
+      // Start a thread if every thread is busy.
+      if (_idle == 0 && _threads.size() < _maxThreads)
+        _threads.emplace_back([this]() { run(); });
+    }
+    _cv.notify_one();
+  }
+
+  auto maxThreads() const
+  {
+    return _maxThreads;
+  }
+
+private:
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  std::deque<Job> _jobs;
+  std::vector<std::thread> _threads;
+  unsigned _maxThreads;
+  unsigned _idle{};
+  bool _stop{};
+
+  void run()
+  {
+    std::unique_lock lock{_mutex};
+
+    for (;;)
+    {
+      ++_idle;
+      _cv.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+      --_idle;
+      if (_stop)
+        return;
+
+      auto job = std::move(_jobs.front());
+
+      _jobs.pop_front();
+      lock.unlock();
+      try
+      {
+        job();
+      }
+      catch (...)
+      {
+        // do nothing
+      }
+      // Release the captures of the job before taking the lock.
+      job = nullptr;
+      lock.lock();
+    }
+  }
+
+}; // WorkerPool
+
+} // end namespace cg
+
+#endif // __Parallel_h
@@ -28,11 +28,12 @@
 // Class definition for shared object.
 //
 // Author: Paulo Pagliosa
-// Last revision: 14/07/2023
+// Last revision: 18/10/2026
 
 #ifndef __SharedObject_h
 #define __SharedObject_h
 
+#include <atomic>
 #include <concepts>
 
 namespace cg
@@ -67,7 +68,7 @@ public:
   virtual ~SharedObject() = default;
 
   /// Returns the number of references of this object.
-  auto referenceCount() const
+  int referenceCount() const
   {
     return _referenceCount;
   }
@@ -93,8 +94,24 @@ protected:
   /// Constructs an unreferenced object.
   SharedObject() = default;
 
+  /// Constructs an unreferenced copy of an object.
+  SharedObject(const SharedObject&):
+    _referenceCount{0}
+  {
+    // do nothing
+  }
+
+  /// Assigns an object to this object. The number of references of
+  /// this object does not change.
+  SharedObject& operator =(const SharedObject&)
+  {
+    return *this;
+  }
+
 private:
-  mutable int _referenceCount{};
+  // The count is atomic, hence references to an object can be
+  // copied and released by different threads.
+  mutable std::atomic<int> _referenceCount{};
   
 }; // SharedObject
 
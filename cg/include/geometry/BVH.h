@@ -28,23 +28,28 @@
 // Class definition for BVH.
 //
 // Author: Paulo Pagliosa
-// Last revision: 19/08/2025
+// Last revision: 19/10/2026
 
 #ifndef __BVH_h
 #define __BVH_h
 
-#include "core/BlockAllocable.h"
 #include "core/SharedObject.h"
 #include "geometry/Bounds3.h"
+#include "geometry/Frustum.h"
 #include "geometry/Intersection.h"
 #include <functional>
+#include <span>
 #include <cassert>
 #include <cinttypes>
+#include <cstdio>
+#include <mutex>
 #include <vector>
 
 namespace cg
 { // begin namespace cg
 
+class MappedFile;
+
 
 /////////////////////////////////////////////////////////////////////
 //
@@ -53,16 +58,50 @@ namespace cg
 class BVHBase: public SharedObject
 {
 public:
+  /// Method used to partition the primitives of a node. Spatial
+  /// is the SAH-based spatial split method (SBVH), which weighs
+  /// object splits against splits of the primitives by a plane and
+  /// references a split primitive from both sides of the plane.
   enum class SplitMethod
   {
     SAH,
-    Median
+    Median,
+    Spatial
+  };
+
+  /// Node layout used by ray traversal. Wide layouts collapse the
+  /// binary tree after it is built into a 4-ary or 8-ary tree whose
+  /// child bounds are tested against a ray at once (SSE/AVX).
+  /// Quantized layouts replace the binary nodes by nodes whose
+  /// bounds are quantized to 8 or 16 bits relative to the bounds of
+  /// their parents. In a quantized BVH, root(), iterate() and
+  /// sahCost() use binary nodes decoded on demand, whose bounds are
+  /// the (conservative) bounds used by the traversal, and write()
+  /// is unavailable.
+  enum class NodeLayout
+  {
+    Binary,
+    Wide4,
+    Wide8,
+    Quantized8,
+    Quantized16
   };
 
   class NodeView;
 
   using NodeFunction = std::function<void(const NodeView&)>;
+  /// Function invoked by volume queries for a range [first, first +
+  /// count) of primitive ids (see primitiveId()). If contained is
+  /// true, the whole range is inside the query volume; otherwise,
+  /// it is the range of a leaf whose bounds intersect the volume,
+  /// and each primitive must be tested by the caller.
+  using QueryFunction = std::function<void(uint32_t, uint32_t, bool)>;
   using enum SplitMethod;
+  using enum NodeLayout;
+
+  /// Default maximum fraction of the number of primitives that can
+  /// be referenced twice by a BVH built by the Spatial method.
+  static constexpr float dflDuplicationBudget = 0.3f;
 
   ~BVHBase() override;
 
@@ -75,6 +114,19 @@ public:
   Bounds3f bounds() const;
   bool intersect(const Ray3f&) const;
   bool intersect(const Ray3f&, Intersection&) const;
+  void intersect(std::span<const Ray3f>, std::span<bool>, bool = false) const;
+  void intersect(std::span<const Ray3f>,
+    std::span<Intersection>,
+    bool = false) const;
+  bool closestPoint(const vec3f&,
+    ClosestPoint&,
+    float = math::Limits<float>::inf()) const;
+  void closestPoint(std::span<const vec3f>,
+    std::span<ClosestPoint>,
+    float = math::Limits<float>::inf()) const;
+  float distance(const vec3f&, float = math::Limits<float>::inf()) const;
+  void query(const Frustum&, const QueryFunction&) const;
+  void query(const Bounds3f&, const QueryFunction&) const;
   void iterate(NodeFunction) const;
 
   auto empty() const
@@ -84,80 +136,257 @@ public:
 
   auto primitiveId(int i) const
   {
-    return _primitiveIds[i];
+    return _ids[i];
   }
 
+  auto maxPrimitivesPerNode() const
+  {
+    return _maxPrimitivesPerNode;
+  }
+
+  auto splitMethod() const
+  {
+    return _splitMethod;
+  }
+
+  auto layout() const
+  {
+    return _layout;
+  }
+
+  auto duplicationBudget() const
+  {
+    return _duplicationBudget;
+  }
+
+  /// Returns the number of primitive references in the leaves.
+  /// Unless the BVH was built by spatial splits, this is the number
+  /// of primitives.
+  auto referenceCount() const
+  {
+    return _idCount;
+  }
+
+  float sahCost() const;
+  size_t memorySize() const;
+
+  bool write(FILE*, uint64_t) const;
+  size_t writeSize() const;
+
 protected:
   class PrimitiveInfo;
+  class RayPacket;
 
   using PrimitiveInfoArray = std::vector<PrimitiveInfo>;
   using IndexArray = std::vector<uint32_t>;
+  using LeafFunction = std::function<void(uint32_t, uint32_t)>;
 
-  BVHBase(uint32_t maxPrimitivesPerNode, SplitMethod splitMethod):
+  BVHBase(uint32_t maxPrimitivesPerNode,
+    SplitMethod splitMethod,
+    NodeLayout layout = NodeLayout::Binary,
+    float duplicationBudget = dflDuplicationBudget):
     _maxPrimitivesPerNode{maxPrimitivesPerNode},
-    _splitMethod{splitMethod}
+    _splitMethod{splitMethod},
+    _layout{layout},
+    _duplicationBudget{duplicationBudget}
   {
     assert(maxPrimitivesPerNode > 0);
+    assert(duplicationBudget >= 0);
   }
 
-  void build(const PrimitiveInfoArray&);
+  void build(const PrimitiveInfoArray&, bool = true);
+  void makeLayout();
+  void iterateLeaves(const LeafFunction&) const;
+
+  bool write(const char*, uint64_t) const;
+  bool read(const char*, uint64_t, uint32_t);
+  bool read(MappedFile&, size_t, size_t, uint64_t, uint32_t);
+
+  virtual bool splitPrimitive(uint32_t,
+    int,
+    float,
+    Bounds3f&,
+    Bounds3f&) const;
 
   virtual bool intersectLeaf(uint32_t, uint32_t, const Ray3f&) const = 0;
   virtual void intersectLeaf(uint32_t,
     uint32_t,
     const Ray3f&,
     Intersection&) const = 0;
+  virtual void intersectLeaf(uint32_t, uint32_t, const RayPacket&) const;
+  virtual void closestPointLeaf(uint32_t,
+    uint32_t,
+    const vec3f&,
+    ClosestPoint&) const;
 
 private:
   class NodeRay;
   class Node;
+  struct Split;
+  template <int N> class WideNode;
+  template <typename Q> class QuantizedNode;
 
-  Node* _root{};
+  struct WideLeaf
+  {
+    uint32_t first;
+    uint32_t count;
+
+  }; // WideLeaf
+
+  std::vector<Node> _nodes;
+  const Node* _root{};
   uint32_t _nodeCount{};
   uint32_t _maxPrimitivesPerNode;
   IndexArray _primitiveIds;
+  const uint32_t* _ids{};
+  uint32_t _idCount{};
+  Reference<SharedObject> _storage;
   SplitMethod _splitMethod;
+  NodeLayout _layout;
+  float _duplicationBudget;
+  uint32_t _maxReferences{};
+  uint32_t _references{};
+  float _rootArea{};
+  std::vector<WideNode<4>> _wide4;
+  std::vector<WideNode<8>> _wide8;
+  std::vector<WideLeaf> _wideLeaves;
+  uint32_t _wideDepth{};
+  std::vector<QuantizedNode<uint8_t>> _quantized8;
+  std::vector<QuantizedNode<uint16_t>> _quantized16;
+  uint32_t _quantizedDepth{};
+  mutable std::vector<Node> _decodedNodes;
+  mutable std::mutex _decodeLock;
+  Bounds3f _bounds;
+
+  uint32_t makeNode(const PrimitiveInfoArray&, uint32_t, uint32_t);
+  uint32_t makeLeaf(const Bounds3f&, uint32_t, uint32_t);
+  void makeSpatialNodes(const PrimitiveInfoArray&);
+  uint32_t makeSpatialNode(PrimitiveInfoArray&, uint32_t);
+  Split findObjectSplit(const PrimitiveInfoArray&, const Bounds3f&) const;
+  Split findSpatialSplit(const PrimitiveInfoArray&, const Bounds3f&) const;
+  void splitReference(uint32_t,
+    int,
+    float,
+    const Bounds3f&,
+    Bounds3f&,
+    Bounds3f&) const;
+  void splitObjects(const PrimitiveInfoArray&,
+    const Bounds3f&,
+    const Split&,
+    PrimitiveInfoArray&,
+    PrimitiveInfoArray&) const;
+  void splitReferences(const PrimitiveInfoArray&,
+    const Bounds3f&,
+    const Split&,
+    PrimitiveInfoArray&,
+    PrimitiveInfoArray&);
+  void collapse();
+
+  static bool isValid(const Node*,
+    uint32_t,
+    const uint32_t*,
+    uint32_t,
+    uint32_t);
+
+  template <int N>
+  int32_t collapse(std::vector<WideNode<N>>&, const NodeView&, uint32_t);
+
+  template <int N>
+  bool intersectWide(const std::vector<WideNode<N>>&, const Ray3f&) const;
+
+  template <typename Q>
+  void quantize(std::vector<QuantizedNode<Q>>&);
+
+  template <typename Q>
+  void quantize(std::vector<QuantizedNode<Q>>&,
+    const Node*,
+    const vec3f&,
+    const vec3f&,
+    uint32_t);
+
+  template <typename Q>
+  void decode(const std::vector<QuantizedNode<Q>>&) const;
+
+  const Node* nodes() const;
 
-  Node* makeNode(const PrimitiveInfoArray&, uint32_t, uint32_t);
+  template <typename Q>
+  bool intersectQuantized(const std::vector<QuantizedNode<Q>>&,
+    const Ray3f&) const;
+
+  template <typename Q>
+  bool intersectQuantized(const std::vector<QuantizedNode<Q>>&,
+    const Ray3f&,
+    Intersection&) const;
+
+  template <typename Q>
+  bool closestPointQuantized(const std::vector<QuantizedNode<Q>>&,
+    const vec3f&,
+    ClosestPoint&) const;
+
+  template <typename Volume>
+  void queryNodes(const Volume&, const QueryFunction&) const;
+
+  template <typename Q, typename Volume>
+  void queryQuantized(const std::vector<QuantizedNode<Q>>&,
+    const Volume&,
+    const QueryFunction&) const;
+
+  void intersectBatch(std::span<const Ray3f>,
+    Intersection*,
+    bool*,
+    bool) const;
+  void intersectStream(const Ray3f*,
+    Intersection*,
+    bool*,
+    const uint32_t*,
+    uint32_t) const;
+
+  template <int N>
+  bool intersectWide(const std::vector<WideNode<N>>&,
+    const Ray3f&,
+    Intersection&) const;
 
   friend NodeView;
 
 }; // BVHBase
 
-class BVHBase::Node: public BlockAllocable<BVHBase::Node, DflBlockSize>
+/**
+ * @brief Node of a BVH.
+ *
+ * The nodes are stored in a linear array in depth-first order:
+ * the first child of an interior node immediately follows it, and
+ * the offset of the second child relative to the node is stored in
+ * the node. A leaf node stores the index of its first primitive id
+ * and the (non-zero) number of primitives in it. Since nodes do
+ * not hold pointers, an array of nodes can be written to a file
+ * and used in place after the file is mapped into memory.
+ */
+class BVHBase::Node
 {
 public:
-  ~Node()
-  {
-    delete _children[0];
-    delete _children[1];
-  }
+  Node() = default;
 
 private:
   Bounds3f _bounds;
-  Node* _children[2];
-  uint32_t _first;
-  uint32_t _count;
+  uint32_t _offset; // first primitive (leaf) or second child offset
+  uint32_t _count; // number of primitives (leaf) or zero
 
   Node(const Bounds3f& bounds, uint32_t first, uint32_t count):
     _bounds{bounds},
-    _first{first},
+    _offset{first},
     _count{count}
   {
-    _children[0] = _children[1] = nullptr;
+    // do nothing
   }
 
-  Node(Node* c0, Node* c1):
-    _bounds{c0->_bounds + c1->_bounds},
-    _count{}
+  bool isLeaf() const
   {
-    _children[0] = c0;
-    _children[1] = c1;
+    return _count != 0;
   }
 
-  bool isLeaf() const
+  auto child(int i) const
   {
-    return _children[0] == nullptr;
+    return this + (i == 0 ? 1 : _offset);
   }
 
   bool intersect(const NodeRay&) const;
@@ -169,6 +398,115 @@ private:
 
 }; // BVHBase::Node
 
+/**
+ * @brief Node of a wide BVH.
+ *
+ * The bounds of the (up to) N children of the node are stored in
+ * SoA form in order to be tested against a ray with a single SIMD
+ * slab test. A non-negative child index refers to an interior
+ * wide node; a negative index i refers to the leaf ~i. Unused
+ * slots have empty bounds, which never intersect a ray.
+ */
+template <int N>
+class alignas(32) BVHBase::WideNode
+{
+public:
+  float minX[N];
+  float minY[N];
+  float minZ[N];
+  float maxX[N];
+  float maxY[N];
+  float maxZ[N];
+  int32_t children[N];
+
+  WideNode()
+  {
+    constexpr auto inf = math::Limits<float>::inf();
+
+    for (int i = 0; i < N; ++i)
+    {
+      minX[i] = minY[i] = minZ[i] = +inf;
+      maxX[i] = maxY[i] = maxZ[i] = -inf;
+      children[i] = 0;
+    }
+  }
+
+  void set(int i, const Bounds3f& bounds, int32_t child)
+  {
+    const auto& p1 = bounds.min();
+    const auto& p2 = bounds.max();
+
+    minX[i] = p1.x;
+    minY[i] = p1.y;
+    minZ[i] = p1.z;
+    maxX[i] = p2.x;
+    maxY[i] = p2.y;
+    maxZ[i] = p2.z;
+    children[i] = child;
+  }
+
+}; // BVHBase::WideNode
+
+/**
+ * @brief Node of a quantized BVH.
+ *
+ * The nodes are stored in the same order as the binary nodes they
+ * replace and have the same offsets and counts. The bounds of a
+ * node are stored as integer coordinates of the lattice with
+ * 2^(8 * sizeof(Q)) - 1 cells per axis spanning the (decoded)
+ * bounds of its parent. The minimum is measured from the minimum
+ * and the maximum from the maximum of the parent bounds, hence the
+ * decoded bounds of a node contain the bounds of the binary node.
+ */
+template <typename Q>
+class BVHBase::QuantizedNode
+{
+public:
+  static constexpr auto maxQ = float(Q(~Q{}));
+
+  Q min[3];
+  Q max[3];
+  uint32_t offset;
+  uint32_t count;
+
+  bool isLeaf() const
+  {
+    return count != 0;
+  }
+
+  /// Decodes the bounds of this node from the bounds [p1, p2] of
+  /// its parent.
+  void decode(const vec3f& p1,
+    const vec3f& p2,
+    vec3f& q1,
+    vec3f& q2) const
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      auto s = scale(p1[i], p2[i]);
+
+      q1[i] = decodeMin(p1[i], s, min[i]);
+      q2[i] = decodeMax(p2[i], s, max[i]);
+    }
+  }
+
+  static float scale(float p1, float p2)
+  {
+    return (p2 - p1) * (1 / maxQ);
+  }
+
+  static float decodeMin(float p1, float s, Q q)
+  {
+    return p1 + s * float(q);
+  }
+
+  static float decodeMax(float p2, float s, Q q)
+  {
+    return p2 - s * float(Q(~Q{} - q));
+  }
+
+}; // BVHBase::QuantizedNode
+
 class BVHBase::NodeView
 {
 public:
@@ -190,13 +528,13 @@ public:
   {
     assert(!isLeaf());
     assert(i == 0 || i == 1);
-    return NodeView{_node->_children[i]};
+    return NodeView{_node->child(i)};
   }
 
   auto first() const
   {
     assert(_node);
-    return _node->_first;
+    return _node->isLeaf() ? _node->_offset : 0u;
   }
 
   auto count() const
@@ -242,21 +580,68 @@ public:
 
 }; // BVHBase::PrimitiveInfo
 
+/**
+ * @brief Rays of a batch reaching a leaf node.
+ *
+ * The packet references the rays and results of the whole batch
+ * and the indices of the rays that hit the bounds of the leaf. A
+ * closest-hit query stores the results in the intersection array;
+ * an occlusion query sets the flag of each occluded ray and has a
+ * null intersection array.
+ */
+class BVHBase::RayPacket
+{
+public:
+  const Ray3f* rays;
+  Intersection* hits;
+  bool* occluded;
+  const uint32_t* indices;
+  uint32_t size;
+
+  auto isOcclusion() const
+  {
+    return hits == nullptr;
+  }
+
+}; // BVHBase::RayPacket
+
 inline auto
 BVHBase::root() const -> NodeView
 {
-  return _root;
+  return nodes();
 }
 
+/**
+ * @brief Builds the binary nodes of this BVH from \p primitiveInfo.
+ *
+ * If \p layout is true, the nodes of the layout of the BVH are made
+ * from the binary nodes. Otherwise, makeLayout() must be invoked
+ * before the BVH is used with a layout other than Binary.
+ */
 inline void
-BVHBase::build(const PrimitiveInfoArray& primitiveInfo)
+BVHBase::build(const PrimitiveInfoArray& primitiveInfo, bool layout)
 {
   auto np = (uint32_t)primitiveInfo.size();
 
-  _primitiveIds.resize(np);
-  for (uint32_t i = 0; i < np; ++i)
-    _primitiveIds[i] = i;
-  _root = makeNode(primitiveInfo, 0, np);
+  _nodes.clear();
+  _nodes.reserve(2 * (np / _maxPrimitivesPerNode) + 1);
+  if (_splitMethod == SplitMethod::Spatial)
+    makeSpatialNodes(primitiveInfo);
+  else
+  {
+    _primitiveIds.resize(np);
+    for (uint32_t i = 0; i < np; ++i)
+      _primitiveIds[i] = i;
+    makeNode(primitiveInfo, 0, np);
+  }
+  _nodes.shrink_to_fit();
+  _root = _nodes.data();
+  _nodeCount = (uint32_t)_nodes.size();
+  _ids = _primitiveIds.data();
+  _idCount = (uint32_t)_primitiveIds.size();
+  _bounds = _nodeCount != 0 ? _nodes[0]._bounds : Bounds3f{};
+  if (layout)
+    makeLayout();
 }
 
 
@@ -269,17 +654,39 @@ class BVH final: public BVHBase
 {
 public:
   using PrimitiveArray = std::vector<Reference<T>>;
+  /// Function invoked by primitive queries for a primitive. If
+  /// contained is true, the primitive is in a subtree inside the
+  /// query volume (see BVHBase::query()); otherwise, the primitive
+  /// must be tested by the caller.
+  using PrimitiveFunction = std::function<void(T*, bool)>;
 
-  BVH(PrimitiveArray&&, uint32_t = 8, SplitMethod = SAH);
+  BVH(PrimitiveArray&&,
+    uint32_t = 8,
+    SplitMethod = SplitMethod::SAH,
+    NodeLayout = NodeLayout::Binary);
 
   auto& primitives() const
   {
     return _primitives;
   }
 
+  void queryPrimitives(const Frustum& frustum,
+    const PrimitiveFunction& f) const
+  {
+    queryPrimitives<Frustum>(frustum, f);
+  }
+
+  void queryPrimitives(const Bounds3f& box, const PrimitiveFunction& f) const
+  {
+    queryPrimitives<Bounds3f>(box, f);
+  }
+
 private:
   PrimitiveArray _primitives;
 
+  template <typename Volume>
+  void queryPrimitives(const Volume&, const PrimitiveFunction&) const;
+
   bool intersectLeaf(uint32_t, uint32_t, const Ray3f&) const override;
   void intersectLeaf(uint32_t,
     uint32_t,
@@ -291,8 +698,9 @@ private:
 template <typename T>
 BVH<T>::BVH(PrimitiveArray&& primitives,
   uint32_t maxPrimitivesPerNode,
-  SplitMethod splitMethod):
-  BVHBase{maxPrimitivesPerNode, splitMethod},
+  SplitMethod splitMethod,
+  NodeLayout layout):
+  BVHBase{maxPrimitivesPerNode, splitMethod, layout},
   _primitives{std::move(primitives)}
 {
   auto np = (uint32_t)_primitives.size();
@@ -306,6 +714,19 @@ BVH<T>::BVH(PrimitiveArray&& primitives,
   build(primitiveInfo);
 }
 
+template <typename T>
+template <typename Volume>
+void
+BVH<T>::queryPrimitives(const Volume& volume, const PrimitiveFunction& f)
+  const
+{
+  query(volume, [&, this](uint32_t first, uint32_t count, bool contained)
+    {
+      for (auto i = first, e = i + count; i < e; ++i)
+        f(_primitives[primitiveId(i)], contained);
+    });
+}
+
 template <typename T>
 bool
 BVH<T>::intersectLeaf(uint32_t first, uint32_t count, const Ray3f& ray) const
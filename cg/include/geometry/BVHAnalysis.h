@@ -0,0 +1,91 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: BVHAnalysis.h
+// ========
+// Class definition for BVH analysis.
+//
+// Author: Paulo Pagliosa
+// Last revision: 18/10/2026
+
+#ifndef __BVHAnalysis_h
+#define __BVHAnalysis_h
+
+#include "geometry/TriangleMeshBVH.h"
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// BVHAnalysis: BVH analysis class
+// ===========
+class BVHAnalysis
+{
+public:
+  /// Function returning the surface area of the part of a primitive
+  /// (given by its index) inside a box.
+  using AreaFunction = std::function<float(uint32_t, const Bounds3f&)>;
+
+  uint32_t nodeCount{};
+  uint32_t leafCount{};
+  uint32_t referenceCount{};
+  uint32_t maxDepth{};
+  float averageLeafDepth{};
+  float sahCost{};
+  float siblingOverlap{};
+  float epo{-1}; // negative if not computed
+  /// Number of leaves at each depth.
+  std::vector<uint32_t> depthHistogram;
+  /// Number of leaves with each number of primitive references.
+  std::vector<uint32_t> leafSizeHistogram;
+
+  BVHAnalysis(const BVHBase& bvh, const AreaFunction& area = {});
+  BVHAnalysis(const TriangleMeshBVH& bvh, bool epo);
+
+  void print(FILE* f = stdout) const;
+
+  static float triangleArea(const vec3f&,
+    const vec3f&,
+    const vec3f&,
+    const Bounds3f&);
+  static AreaFunction triangleAreaFunction(const TriangleMeshBVH&);
+
+private:
+  struct Entry;
+
+  void computeEPO(const BVHBase&,
+    const std::vector<Entry>&,
+    const AreaFunction&);
+
+}; // BVHAnalysis
+
+} // end namespace cg
+
+#endif // __BVHAnalysis_h
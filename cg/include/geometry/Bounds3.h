@@ -28,7 +28,7 @@
 // Class definition for 3D axis-aligned bounding box.
 //
 // Author: Paulo Pagliosa
-// Last revision: 21/07/2025
+// Last revision: 18/10/2026
 
 #ifndef __Bounds3_h
 #define __Bounds3_h
@@ -218,8 +218,8 @@ public:
   HOST DEVICE
   void inflate(const Bounds& b)
   {
-    inflate(b._p1);
-    inflate(b._p2);
+    _p1 = math::min(_p1, b._p1);
+    _p2 = math::max(_p2, b._p2);
   }
 
   HOST DEVICE
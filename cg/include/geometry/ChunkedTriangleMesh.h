@@ -0,0 +1,199 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: ChunkedTriangleMesh.h
+// ========
+// Class definition for out-of-core chunked triangle mesh.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#ifndef __ChunkedTriangleMesh_h
+#define __ChunkedTriangleMesh_h
+
+#include "geometry/Frustum.h"
+#include "geometry/TriangleMeshBVH.h"
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <vector>
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// ChunkedTriangleMesh: out-of-core chunked triangle mesh class
+// ===================
+/**
+ * @brief Triangle mesh stored in spatially clustered chunks in a
+ * mapped chunked triangle mesh file (see MeshWriter::
+ * writeChunkedMesh()), which can be larger than the memory.
+ *
+ * Only the chunk table is read when the file is opened. A chunk is
+ * paged in on demand, when it is reached by a ray, through the BVH
+ * of the chunk bounds, or asked for by chunkMesh(). Paging in a
+ * chunk makes a triangle mesh whose arrays reference the pages of
+ * the file and adopts the nodes of its BVH from the file. When the
+ * bytes of the resident chunks exceed the residency budget, the
+ * least recently used chunks not referenced outside this mesh are
+ * paged out and their pages are released.
+ *
+ * A chunk is paged in and out without holding the lock of this
+ * mesh, hence rays reaching resident chunks are not blocked by
+ * paging. Threads reaching a chunk being paged in or out wait only
+ * for that chunk.
+ *
+ * The triangles of the chunks are numbered consecutively, in the
+ * order of the chunks. Intersections hold this mesh as object and
+ * the triangle index in this numbering.
+ */
+class ChunkedTriangleMesh: public SharedObject
+{
+public:
+  struct Statistics
+  {
+    size_t hits;
+    size_t pageIns;
+    size_t pageOuts;
+    size_t peakResidentBytes;
+
+  }; // Statistics
+
+  using ChunkFunction = std::function<void(int)>;
+
+  static constexpr size_t dflResidencyBudget = size_t(1) << 30;
+
+  /// Opens the chunked triangle mesh file \p filename. Returns null
+  /// if the file cannot be mapped or is not a valid chunked
+  /// triangle mesh file.
+  static ChunkedTriangleMesh* open(const char* filename);
+
+  /// Destructor.
+  ~ChunkedTriangleMesh() override;
+
+  auto chunkCount() const
+  {
+    return (int)_chunks.size();
+  }
+
+  auto vertexCount() const
+  {
+    return _vertexCount;
+  }
+
+  auto triangleCount() const
+  {
+    return _triangleCount;
+  }
+
+  const auto& bounds() const
+  {
+    return _bounds;
+  }
+
+  const Bounds3f& chunkBounds(int i) const;
+  int chunkTriangleCount(int i) const;
+  int chunkFirstTriangle(int i) const;
+  /// Returns the index of the chunk of the triangle \p index.
+  int findChunk(int index) const;
+
+  /// Returns the mesh of the chunk \p i, paging the chunk in if it
+  /// is not resident. The chunk is not paged out while the mesh is
+  /// referenced outside this mesh.
+  Reference<TriangleMesh> chunkMesh(int i) const;
+  /// Returns the BVH of the mesh of the chunk \p i. See chunkMesh().
+  Reference<TriangleMeshBVH> chunkBVH(int i) const;
+
+  bool isResident(int i) const;
+
+  bool intersect(const Ray3f& ray) const;
+  bool intersect(const Ray3f& ray, Intersection& hit) const;
+
+  /// Returns the interpolated normal at the intersection \p hit.
+  vec3f normal(const Intersection& hit) const;
+
+  /// Invokes \p f for the index of every chunk whose bounds are not
+  /// outside \p frustum, in the local space of this mesh.
+  void queryChunks(const Frustum& frustum, const ChunkFunction& f) const;
+
+  auto residencyBudget() const
+  {
+    return _residencyBudget;
+  }
+
+  void setResidencyBudget(size_t budget);
+
+  /// Returns the bytes of the resident chunks.
+  size_t residentBytes() const;
+  int residentChunkCount() const;
+  Statistics statistics() const;
+  void resetStatistics();
+
+  /**
+   * @brief Releases the meshes of the chunks paged out with user
+   * data since the last call.
+   *
+   * The user data of a chunk mesh, e.g., its GL buffers, may have
+   * to be released in the thread that made them, which is not
+   * necessarily the thread paging the chunk out. Such meshes are
+   * kept until this function is invoked by that thread.
+   */
+  void releasePagedOut() const;
+
+private:
+  class Chunk;
+
+  using ChunkLRU = std::list<Chunk*>;
+  using ChunkList = std::vector<Chunk*>;
+
+  Reference<MappedFile> _file;
+  std::vector<Reference<Chunk>> _chunks;
+  Reference<BVH<Chunk>> _bvh;
+  Bounds3f _bounds;
+  int _vertexCount;
+  int _triangleCount;
+  uint32_t _maxTrianglesPerNode;
+  mutable std::mutex _lock;
+  mutable std::condition_variable _paged;
+  mutable ChunkLRU _lru; // from the most to the least recently used
+  mutable std::vector<Reference<TriangleMesh>> _pagedOut;
+  mutable Statistics _statistics{};
+  mutable size_t _residentBytes{};
+  size_t _residencyBudget{dflResidencyBudget};
+
+  ChunkedTriangleMesh(MappedFile&);
+
+  Reference<TriangleMeshBVH> pageIn(Chunk&) const;
+  void pageOut(const ChunkList&) const;
+  ChunkList evict(size_t) const;
+
+}; // ChunkedTriangleMesh
+
+} // end namespace cg
+
+#endif // __ChunkedTriangleMesh_h
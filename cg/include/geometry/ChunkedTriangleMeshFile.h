@@ -0,0 +1,148 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: ChunkedTriangleMeshFile.h
+// ========
+// Binary chunked triangle mesh file format.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#ifndef __ChunkedTriangleMeshFile_h
+#define __ChunkedTriangleMeshFile_h
+
+#include "geometry/TriangleMeshFile.h"
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// ChunkedTriangleMeshFileHeader: chunked triangle mesh file header
+// =============================
+//
+// A chunked triangle mesh file stores the triangles of a mesh in
+// spatially clustered chunks. Each chunk is a triangle mesh on its
+// own, whose arrays and the binary nodes of its BVH, written with
+// the chunk checksum as key, are stored in sections aligned to 64
+// bytes, as in a triangle mesh file. The sections of a chunk are in
+// a region aligned to chunkAlignment, hence the pages of a chunk can
+// be released without touching the pages of any other chunk. The
+// chunk table is stored after the last chunk. The triangles of the
+// chunks are numbered consecutively, in the order of the chunks.
+//
+struct ChunkedTriangleMeshFileHeader
+{
+  using Section = TriangleMeshFileHeader::Section;
+
+  struct Chunk
+  {
+    float bounds[6];
+    int32_t vertexCount;
+    int32_t triangleCount;
+    int32_t firstTriangle;
+    uint32_t reserved;
+    uint64_t checksum;
+    struct
+    {
+      uint64_t offset;
+      uint64_t size;
+
+    } sections[TriangleMeshFileHeader::SectionCount];
+
+  }; // Chunk
+
+  static constexpr char fileMagic[8]{'C', 'G', 'C', 'H', 'U', 'N', 'K', 0};
+  static constexpr uint32_t fileVersion{1};
+  static constexpr uint32_t fileByteOrder{0x01020304};
+  static constexpr uint64_t alignment{TriangleMeshFileHeader::alignment};
+  static constexpr uint64_t chunkAlignment{65536};
+
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  int32_t vertexCount;
+  int32_t triangleCount;
+  int32_t chunkCount;
+  uint32_t maxTrianglesPerNode;
+  float bounds[6];
+  uint64_t chunkTableOffset;
+
+  /// Returns the header of the mapped chunked triangle mesh file
+  /// \p file, or null if \p file is not a valid chunked triangle
+  /// mesh file.
+  static const ChunkedTriangleMeshFileHeader* get(const MappedFile& file);
+
+  /// Returns the chunk table of the mapped file \p file.
+  const Chunk* chunks(const MappedFile& file) const
+  {
+    return file.as<const Chunk>(chunkTableOffset);
+  }
+
+}; // ChunkedTriangleMeshFileHeader
+
+inline const ChunkedTriangleMeshFileHeader*
+ChunkedTriangleMeshFileHeader::get(const MappedFile& file)
+{
+  using Header = ChunkedTriangleMeshFileHeader;
+
+  if (file.size() < sizeof(Header))
+    return nullptr;
+
+  auto header = file.as<const Header>();
+
+  if (memcmp(header->magic, fileMagic, sizeof fileMagic) != 0 ||
+    header->version != fileVersion ||
+    header->byteOrder != fileByteOrder ||
+    header->chunkCount <= 0 ||
+    header->chunkTableOffset % alignment != 0 ||
+    header->chunkTableOffset > file.size() ||
+    file.size() - header->chunkTableOffset <
+      sizeof(Chunk) * header->chunkCount)
+    return nullptr;
+
+  auto chunk = header->chunks(file);
+  int32_t firstTriangle{};
+
+  for (auto e = chunk + header->chunkCount; chunk != e; ++chunk)
+  {
+    if (chunk->vertexCount <= 0 ||
+      chunk->triangleCount <= 0 ||
+      chunk->firstTriangle != firstTriangle)
+      return nullptr;
+    for (const auto& section : chunk->sections)
+      if (section.size > 0 && (section.offset % alignment != 0 ||
+        section.offset > file.size() ||
+        section.size > file.size() - section.offset))
+        return nullptr;
+    firstTriangle += chunk->triangleCount;
+  }
+  return firstTriangle == header->triangleCount ? header : nullptr;
+}
+
+} // end namespace cg
+
+#endif // __ChunkedTriangleMeshFile_h
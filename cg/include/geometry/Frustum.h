@@ -0,0 +1,165 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: Frustum.h
+// ========
+// Class definition for view frustum.
+//
+// Author: Paulo Pagliosa
+// Last revision: 18/10/2026
+
+#ifndef __Frustum_h
+#define __Frustum_h
+
+#include "geometry/Bounds3.h"
+#include "math/Matrix4x4.h"
+#include "math/Vector2.h"
+#include <cassert>
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// Frustum: view frustum class
+// =======
+class Frustum
+{
+public:
+  enum class Containment
+  {
+    Outside,
+    Intersecting,
+    Inside
+  };
+
+  using enum Containment;
+
+  /**
+   * @brief Constructs the frustum of the view-projection matrix
+   * \p m whose cross section is the rectangle [\p p1, \p p2] of the
+   * normalized device coordinates.
+   *
+   * The default rectangle is the whole view. A smaller rectangle,
+   * e.g., the one dragged by the mouse for a rubber-band selection,
+   * makes the subfrustum of the view through it.
+   */
+  explicit Frustum(const mat4f& m,
+    const vec2f& p1 = vec2f{-1, -1},
+    const vec2f& p2 = vec2f{+1, +1})
+  {
+    const auto x1 = math::min(p1.x, p2.x);
+    const auto x2 = math::max(p1.x, p2.x);
+    const auto y1 = math::min(p1.y, p2.y);
+    const auto y2 = math::max(p1.y, p2.y);
+    const auto r0 = row(m, 0);
+    const auto r1 = row(m, 1);
+    const auto r2 = row(m, 2);
+    const auto r3 = row(m, 3);
+
+    // Planes of the clip space inequalities x1 * w <= x <= x2 * w,
+    // y1 * w <= y <= y2 * w and -w <= z <= w.
+    _planes[0] = r0 - r3 * x1;
+    _planes[1] = r3 * x2 - r0;
+    _planes[2] = r1 - r3 * y1;
+    _planes[3] = r3 * y2 - r1;
+    _planes[4] = r3 + r2;
+    _planes[5] = r3 - r2;
+  }
+
+  /// Returns the plane \p i of this frustum. A point p is on the
+  /// inner side of the plane (a, b, c, d) if ax + by + cz + d >= 0.
+  /// The planes are not normalized.
+  const auto& plane(int i) const
+  {
+    assert(i >= 0 && i < 6);
+    return _planes[i];
+  }
+
+  bool contains(const vec3f& p) const
+  {
+    for (const auto& plane : _planes)
+      if (distance(plane, p) < 0)
+        return false;
+    return true;
+  }
+
+  /**
+   * @brief Classifies \p bounds against this frustum.
+   *
+   * The test is conservative: bounds outside the frustum but not
+   * outside any of its planes are classified as Intersecting.
+   */
+  Containment classify(const Bounds3f& bounds) const
+  {
+    const auto& p1 = bounds.min();
+    const auto& p2 = bounds.max();
+    auto result = Inside;
+
+    for (const auto& plane : _planes)
+    {
+      vec3f pv;
+      vec3f nv;
+
+      // Corners of the bounds farthest along and against the
+      // normal of the plane.
+      for (int i = 0; i < 3; ++i)
+        if (plane[i] >= 0)
+        {
+          pv[i] = p2[i];
+          nv[i] = p1[i];
+        }
+        else
+        {
+          pv[i] = p1[i];
+          nv[i] = p2[i];
+        }
+      if (distance(plane, pv) < 0)
+        return Outside;
+      if (distance(plane, nv) < 0)
+        result = Intersecting;
+    }
+    return result;
+  }
+
+private:
+  vec4f _planes[6];
+
+  static vec4f row(const mat4f& m, int i)
+  {
+    return vec4f{m(i, 0), m(i, 1), m(i, 2), m(i, 3)};
+  }
+
+  static float distance(const vec4f& plane, const vec3f& p)
+  {
+    return plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w;
+  }
+
+}; // Frustum
+
+} // end namespace cg
+
+#endif // __Frustum_h
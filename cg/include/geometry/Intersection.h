@@ -25,10 +25,10 @@
 //
 // OVERVIEW: Intersection.h
 // ========
-// Class definition for intersection ray/object.
+// Class definitions for intersection ray/object and closest point.
 //
 // Author: Paulo Pagliosa
-// Last revision: 21/01/2022
+// Last revision: 18/10/2026
 
 #ifndef __Intersection_h
 #define __Intersection_h
@@ -53,6 +53,21 @@ struct Intersection
 
 }; // Intersection
 
+
+/////////////////////////////////////////////////////////////////////
+//
+// ClosestPoint: closest point point/object class
+// ============
+struct ClosestPoint
+{
+  const void* object; // object containing the closest point
+  int triangleIndex; // index of the triangle containing the closest point
+  float distance; // distance from the query point to the closest point
+  vec3f position; // closest point
+  vec3f p; // barycentric coordinates of the closest point
+
+}; // ClosestPoint
+
 } // end namespace cg
 
 #endif // __Intersection_h
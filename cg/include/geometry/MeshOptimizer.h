@@ -0,0 +1,78 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: MeshOptimizer.h
+// ========
+// Class definition for mesh optimizer.
+//
+// Author: Paulo Pagliosa
+// Last revision: 18/10/2026
+
+#ifndef __MeshOptimizer_h
+#define __MeshOptimizer_h
+
+#include "geometry/TriangleMesh.h"
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// MeshOptimizer: mesh optimizer class
+// =============
+class MeshOptimizer
+{
+public:
+  /// Size of the LRU vertex cache the triangles are ordered for.
+  static constexpr int cacheSize = 32;
+
+  struct VertexCacheStatistics
+  {
+    int vertexCount; // number of vertices transformed
+    float acmr; // average cache miss ratio (per triangle)
+    float atvr; // average transformed vertex ratio (per vertex)
+
+  }; // VertexCacheStatistics
+
+  /// Simulates a FIFO post-transform cache with \p fifoSize entries.
+  static VertexCacheStatistics analyzeVertexCache(const TriangleMesh&,
+    int fifoSize = 16);
+
+  static void optimizeVertexCache(TriangleMesh&);
+  static void optimizeVertexFetch(TriangleMesh&);
+
+  /// Optimizes the vertex cache and then the vertex fetch of a mesh.
+  static void optimize(TriangleMesh& mesh)
+  {
+    optimizeVertexCache(mesh);
+    optimizeVertexFetch(mesh);
+  }
+
+}; // MeshOptimizer
+
+} // end namespace cg
+
+#endif // __MeshOptimizer_h
@@ -0,0 +1,89 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: MeshSimplifier.h
+// ========
+// Class definition for quadric error mesh simplifier.
+//
+// Author: Paulo Pagliosa
+// Last revision: 18/10/2026
+
+#ifndef __MeshSimplifier_h
+#define __MeshSimplifier_h
+
+#include "geometry/TriangleMesh.h"
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// MeshSimplifier: quadric error mesh simplifier class
+// ==============
+/**
+ * @brief Simplifies a triangle mesh by edge collapses ordered by
+ * the quadric error metric of Garland and Heckbert.
+ *
+ * The vertices of the mesh are welded by position before the
+ * simplification, so attribute seams do not crack. Successive calls
+ * to simplify() continue collapsing edges from where the previous
+ * call stopped, hence a chain of levels of detail is made by a
+ * single simplifier.
+ */
+class MeshSimplifier
+{
+public:
+  /// Constructs a simplifier of \p mesh, which is copied.
+  MeshSimplifier(const TriangleMesh& mesh);
+
+  /// Destructor.
+  ~MeshSimplifier();
+
+  /// Collapses edges until the number of triangles is at most
+  /// \p triangleCount, if possible. Returns the number of triangles.
+  int simplify(int triangleCount);
+
+  int triangleCount() const;
+
+  /// Returns the square root of the largest quadric error of the
+  /// collapses so far, an estimate in mesh units of the distance
+  /// between the simplified and the original surfaces.
+  float error() const;
+
+  /// Makes a mesh with the current triangles, with vertex normals
+  /// and, if the original mesh has them, texture coordinates.
+  TriangleMesh* mesh() const;
+
+private:
+  struct Data;
+
+  Data* _data;
+
+}; // MeshSimplifier
+
+} // end namespace cg
+
+#endif // __MeshSimplifier_h
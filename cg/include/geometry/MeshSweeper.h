@@ -28,7 +28,7 @@
 // Class definition for mesh sweeper.
 //
 // Author: Paulo Pagliosa
-// Last revision: 11/03/2022
+// Last revision: 18/10/2026
 
 #ifndef __MeshSweeper_h
 #define __MeshSweeper_h
@@ -46,10 +46,47 @@ namespace cg
 class MeshSweeper
 {
 public:
+  /// Swept shapes with cached meshes (see mesh()).
+  enum class Shape
+  {
+    Cone,
+    Cylinder,
+    Sphere
+  };
+
+  /// Resolutions of the cached meshes: 8, 16, 32, 64, 128 and 256.
+  static constexpr int minResolution = 8;
+  static constexpr int maxResolution = 256;
+  static constexpr int levelCount = 6;
+  static constexpr int dflResolution = 16;
+
   static TriangleMesh* makeBox();
-  static TriangleMesh* makeCone(int = 16);
-  static TriangleMesh* makeCylinder(int = 16);
-  static TriangleMesh* makeSphere(int = 16);
+  static TriangleMesh* makeCone(int = dflResolution);
+  static TriangleMesh* makeCylinder(int = dflResolution);
+  static TriangleMesh* makeSphere(int = dflResolution);
+
+  /**
+   * @brief Returns the cached mesh of \p shape with resolution \p ns
+   * rounded up to a power of two in [minResolution, maxResolution].
+   *
+   * The mesh is made on the first request for its resolution. It
+   * is shared and must not be modified.
+   */
+  static TriangleMesh* mesh(Shape shape, int ns = dflResolution);
+
+  /**
+   * @brief Returns the resolution of a shape whose radius projects
+   * onto \p radius pixels.
+   *
+   * It is the least number of sides of a regular polygon inscribed
+   * in a circle of \p radius pixels whose distance to the circle is
+   * at most \p tolerance pixels, clamped to the cached resolutions.
+   */
+  static int resolution(float radius, float tolerance = 0.5f);
+
+  /// Returns true if \p mesh is a cached mesh, whose shape is
+  /// returned in \p shape.
+  static bool isCached(const TriangleMesh& mesh, Shape& shape);
 
 }; // MeshSweeper
 
@@ -28,7 +28,7 @@
 // Class definition for triangle functions.
 //
 // Author: Paulo Pagliosa
-// Last revision: 01/09/2023
+// Last revision: 18/10/2026
 
 #ifndef __Triangle_h
 #define __Triangle_h
@@ -111,17 +111,22 @@ interpolate(const vec3& b, const T t[3])
   return interpolate(b, t[0], t[1], t[2]);
 }
 
+/**
+ * @brief Intersects \p ray with the triangle with vertex \p p0 and
+ * edges \p e1 = p1 - p0 and \p e2 = p2 - p0.
+ *
+ * This is the Moller-Trumbore test used by intersect() for callers
+ * that store the edges of the triangles instead of their vertices.
+ */
 template <typename real>
 HOST DEVICE inline bool
-intersect(const Ray3<real>& ray,
+intersectEdges(const Ray3<real>& ray,
   const Vector3<real>& p0,
-  const Vector3<real>& p1,
-  const Vector3<real>& p2,
+  const Vector3<real>& e1,
+  const Vector3<real>& e2,
   Vector3<real>& b,
   real& t)
 {
-  auto e1 = p1 - p0;
-  auto e2 = p2 - p0;
   auto s1 = ray.direction.cross(e2);
   auto invDet = s1.dot(e1);
 
@@ -150,6 +155,114 @@ intersect(const Ray3<real>& ray,
   return true;
 }
 
+template <typename real>
+HOST DEVICE inline bool
+intersect(const Ray3<real>& ray,
+  const Vector3<real>& p0,
+  const Vector3<real>& p1,
+  const Vector3<real>& p2,
+  Vector3<real>& b,
+  real& t)
+{
+  return intersectEdges(ray, p0, p1 - p0, p2 - p0, b, t);
+}
+
+/**
+ * @brief Returns the point of the triangle (\p p0, \p p1, \p p2)
+ * closest to \p p and sets \p b to its barycentric coordinates.
+ *
+ * The closest point is found by classifying \p p against the
+ * Voronoi regions of the vertices, edges and face of the triangle
+ * (Ericson, Real-Time Collision Detection, 5.1.5). The coordinates
+ * of a point in the region of a vertex or an edge are exactly zero
+ * for the other vertices.
+ */
+template <typename real>
+HOST DEVICE inline Vector3<real>
+closestPoint(const Vector3<real>& p,
+  const Vector3<real>& p0,
+  const Vector3<real>& p1,
+  const Vector3<real>& p2,
+  Vector3<real>& b)
+{
+  auto e1 = p1 - p0;
+  auto e2 = p2 - p0;
+
+  // Vertex region of p0
+  auto s0 = p - p0;
+  auto d1 = e1.dot(s0);
+  auto d2 = e2.dot(s0);
+
+  if (d1 <= 0 && d2 <= 0)
+  {
+    b.set(1, 0, 0);
+    return p0;
+  }
+
+  // Vertex region of p1
+  auto s1 = p - p1;
+  auto d3 = e1.dot(s1);
+  auto d4 = e2.dot(s1);
+
+  if (d3 >= 0 && d4 <= d3)
+  {
+    b.set(0, 1, 0);
+    return p1;
+  }
+
+  // Edge region of p0p1
+  auto vc = d1 * d4 - d3 * d2;
+
+  if (vc <= 0 && d1 >= 0 && d3 <= 0)
+  {
+    auto v = d1 / (d1 - d3);
+
+    b.set(1 - v, v, 0);
+    return p0 + e1 * v;
+  }
+
+  // Vertex region of p2
+  auto s2 = p - p2;
+  auto d5 = e1.dot(s2);
+  auto d6 = e2.dot(s2);
+
+  if (d6 >= 0 && d5 <= d6)
+  {
+    b.set(0, 0, 1);
+    return p2;
+  }
+
+  // Edge region of p0p2
+  auto vb = d5 * d2 - d1 * d6;
+
+  if (vb <= 0 && d2 >= 0 && d6 <= 0)
+  {
+    auto w = d2 / (d2 - d6);
+
+    b.set(1 - w, 0, w);
+    return p0 + e2 * w;
+  }
+
+  // Edge region of p1p2
+  auto va = d3 * d6 - d5 * d4;
+
+  if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+  {
+    auto w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+
+    b.set(0, 1 - w, w);
+    return p1 + (p2 - p1) * w;
+  }
+
+  // Face region
+  auto invD = math::inverse(va + vb + vc);
+  auto v = vb * invD;
+  auto w = vc * invD;
+
+  b.set(1 - v - w, v, w);
+  return p0 + e1 * v + e2 * w;
+}
+
 } // end namespace triangle
 
 } // end namespace cg
@@ -28,12 +28,12 @@
 // Class definition for simple triangle mesh.
 //
 // Author: Paulo Pagliosa
-// Last revision: 16/08/2022
+// Last revision: 19/10/2026
 
 #ifndef __TriangleMesh_h
 #define __TriangleMesh_h
 
-#include "core/SharedObject.h"
+#include "core/MappedFile.h"
 #include "geometry/Bounds3.h"
 #include "geometry/Triangle.h"
 #include "graphics/Color.h"
@@ -88,19 +88,43 @@ public:
 
   const uint32_t id;
   mutable Reference<SharedObject> userData;
+  /// Levels of detail of this mesh (see TriangleMeshLOD).
+  mutable Reference<SharedObject> lod;
+  /// Clusters of the triangles of this mesh (see
+  /// TriangleMeshClusters). Released when the triangles or vertices
+  /// of this mesh change.
+  mutable Reference<SharedObject> clusters;
 
   /// Constructs a triangle mesh from data.
   TriangleMesh(Data&& data);
 
+  /// Constructs a triangle mesh from data whose arrays can be in
+  /// the pages of the mapped file \p file, which are not copied.
+  /// If not empty, \p bounds are the bounds of the vertices.
+  TriangleMesh(const Data& data,
+    MappedFile* file,
+    const Bounds3f& bounds = {});
+
   /// Destructor.
   ~TriangleMesh();
 
   const Bounds3f& bounds() const;
+  uint64_t hash() const;
 
   void computeNormals();
   void TRS(const mat4f& trs);
   void normalize();
 
+  /// Reorders the triangles of this mesh. The i-th triangle becomes
+  /// the triangle order[i] of the mesh before the call. \p order
+  /// must be a permutation of [0, triangleCount).
+  void reorderTriangles(const int* order);
+
+  /// Renumbers the vertices of this mesh. The vertex i becomes the
+  /// vertex remap[i], and the triangle indices are remapped
+  /// accordingly. \p remap must be a permutation of [0, vertexCount).
+  void remapVertices(const int* remap);
+
   const Data& data() const
   {
     return _data;
@@ -116,11 +140,21 @@ public:
     return _data.uv != nullptr;
   }
 
+  /// Returns the mapped file this mesh was read from, or null if
+  /// the mesh was not read from a mapped file or its vertices have
+  /// changed since.
+  MappedFile* source() const
+  {
+    return _source;
+  }
+
   void print(const char* s, FILE* f = stdout) const;
 
 private:
   Data _data;
   mutable Bounds3f _bounds;
+  Reference<MappedFile> _file;
+  MappedFile* _source{};
 
 }; // TriangleMesh
 
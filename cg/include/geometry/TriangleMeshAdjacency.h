@@ -0,0 +1,208 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: TriangleMeshAdjacency.h
+// ========
+// Class definition for triangle mesh half-edge adjacency.
+//
+// Author: Paulo Pagliosa
+// Last revision: 18/10/2026
+
+#ifndef __TriangleMeshAdjacency_h
+#define __TriangleMeshAdjacency_h
+
+#include "core/Array.h"
+#include "core/SoA.h"
+#include "geometry/TriangleMesh.h"
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// TriangleMeshAdjacency: triangle mesh adjacency class
+// =====================
+/**
+ * @brief Half-edge adjacency of a triangle mesh.
+ *
+ * The half-edges are implicit: the half-edge 3t + k of triangle t
+ * goes from its vertex k to its vertex (k + 1) % 3. An edge joins
+ * the half-edges with the same (unordered) end vertices. An edge
+ * with one half-edge is a boundary edge, with two is a manifold
+ * edge, and with more is a non-manifold edge. Only the half-edges
+ * of a manifold edge are twins of each other.
+ *
+ * The adjacency is built by sorting the half-edges by their end
+ * vertices in parallel (see parallelFor()), and all indices are
+ * 32-bit integers stored in SoA arrays.
+ */
+class TriangleMeshAdjacency: public SharedObject
+{
+public:
+  /// Returned by twin() and halfEdge() when there is none.
+  static constexpr int none = -1;
+
+  /// Constructs the adjacency of the mesh \p data.
+  TriangleMeshAdjacency(const TriangleMesh::Data& data);
+
+  /// Constructs the adjacency of \p mesh.
+  TriangleMeshAdjacency(const TriangleMesh& mesh):
+    TriangleMeshAdjacency{mesh.data()}
+  {
+    // do nothing
+  }
+
+  auto halfEdgeCount() const
+  {
+    return _halfEdges.size();
+  }
+
+  auto edgeCount() const
+  {
+    return _edges.size();
+  }
+
+  auto vertexCount() const
+  {
+    return _vertexHalfEdges.size();
+  }
+
+  auto boundaryEdgeCount() const
+  {
+    return _boundaryEdgeCount;
+  }
+
+  auto nonManifoldEdgeCount() const
+  {
+    return _nonManifoldEdgeCount;
+  }
+
+  /// Returns true if every edge has two half-edges.
+  bool isClosed() const
+  {
+    return _boundaryEdgeCount == 0 && _nonManifoldEdgeCount == 0;
+  }
+
+  /// Returns true if no edge has more than two half-edges.
+  bool isManifold() const
+  {
+    return _nonManifoldEdgeCount == 0;
+  }
+
+  static int triangle(int h)
+  {
+    return h / 3;
+  }
+
+  static int next(int h)
+  {
+    return h % 3 == 2 ? h - 2 : h + 1;
+  }
+
+  static int prev(int h)
+  {
+    return h % 3 == 0 ? h + 2 : h - 1;
+  }
+
+  /// Returns the origin vertex of the half-edge \p h.
+  int origin(int h) const
+  {
+    return _halfEdges.get<0>(h);
+  }
+
+  /// Returns the target vertex of the half-edge \p h.
+  int target(int h) const
+  {
+    return origin(next(h));
+  }
+
+  /// Returns the opposite half-edge of the half-edge \p h, or none.
+  int twin(int h) const
+  {
+    return _halfEdges.get<1>(h);
+  }
+
+  /// Returns the edge of the half-edge \p h.
+  int edge(int h) const
+  {
+    return _halfEdges.get<2>(h);
+  }
+
+  /// Returns a half-edge of the edge \p e.
+  int edgeHalfEdge(int e) const
+  {
+    return _edges.get<0>(e);
+  }
+
+  /// Returns the number of half-edges of the edge \p e.
+  int edgeValence(int e) const
+  {
+    return _edges.get<1>(e);
+  }
+
+  bool isBoundaryEdge(int e) const
+  {
+    return edgeValence(e) == 1;
+  }
+
+  bool isNonManifoldEdge(int e) const
+  {
+    return edgeValence(e) > 2;
+  }
+
+  /**
+   * @brief Returns a half-edge leaving the vertex \p v, or none if
+   * \p v is isolated.
+   *
+   * If \p v is on a boundary, the half-edge is a boundary one, so
+   * the half-edges around a manifold vertex \p v can be visited by
+   * h = twin(prev(h)) from the half-edge returned.
+   */
+  int halfEdge(int v) const
+  {
+    return _vertexHalfEdges.get<0>(v);
+  }
+
+  /// Returns the size in bytes of the adjacency arrays.
+  size_t memorySize() const;
+
+private:
+  using Allocator = ArrayAllocator;
+
+  // origin vertex, twin and edge of the half-edges
+  SoA<Allocator, int, int, int, int> _halfEdges;
+  // half-edge and valence of the edges
+  SoA<Allocator, int, int, int> _edges;
+  // outgoing half-edge of the vertices
+  SoA<Allocator, int, int> _vertexHalfEdges;
+  int _boundaryEdgeCount{};
+  int _nonManifoldEdgeCount{};
+
+}; // TriangleMeshAdjacency
+
+} // end namespace cg
+
+#endif // __TriangleMeshAdjacency_h
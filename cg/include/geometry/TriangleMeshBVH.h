@@ -28,13 +28,16 @@
 // Class definition for triangle mesh BVH.
 //
 // Author: Paulo Pagliosa
-// Last revision: 29/07/2025
+// Last revision: 19/10/2026
 
 #ifndef __TriangleMeshBVH_h
 #define __TriangleMeshBVH_h
 
 #include "geometry/BVH.h"
+#include "geometry/Grid3.h"
 #include "geometry/TriangleMesh.h"
+#include <mutex>
+#include <string>
 
 namespace cg
 { // begin namespace cg
@@ -47,23 +50,134 @@ namespace cg
 class TriangleMeshBVH final: public BVHBase
 {
 public:
+  static constexpr uint32_t dflMaxTrianglesPerNode = 20;
+
+  /// Constructs a BVH for \p mesh. If \p splitMethod is Spatial,
+  /// \p duplicationBudget is the maximum fraction of the number of
+  /// triangles of the mesh that can be referenced twice.
   TriangleMeshBVH(const TriangleMesh& mesh,
-    uint32_t maxTrianglesPerNode = 20,
-    SplitMethod splitMethod = SAH);
+    uint32_t maxTrianglesPerNode = dflMaxTrianglesPerNode,
+    SplitMethod splitMethod = SAH,
+    NodeLayout layout = Binary,
+    float duplicationBudget = dflDuplicationBudget);
+
+  static TriangleMeshBVH* make(const TriangleMesh& mesh,
+    uint32_t maxTrianglesPerNode = dflMaxTrianglesPerNode,
+    SplitMethod splitMethod = SAH,
+    NodeLayout layout = Binary,
+    float duplicationBudget = dflDuplicationBudget);
+
+  /// Makes a BVH for \p mesh adopting the binary nodes written with
+  /// \p key in the \p size bytes at \p offset of the mapped file
+  /// \p file (see BVHBase::write()). If the nodes cannot be adopted,
+  /// they are built with the given parameters, which should be the
+  /// ones the nodes were built with.
+  static TriangleMeshBVH* make(const TriangleMesh& mesh,
+    MappedFile& file,
+    size_t offset,
+    size_t size,
+    uint64_t key,
+    uint32_t maxTrianglesPerNode = dflMaxTrianglesPerNode,
+    SplitMethod splitMethod = SAH,
+    NodeLayout layout = Binary,
+    float duplicationBudget = dflDuplicationBudget);
 
   const TriangleMesh* mesh() const
   {
     return _mesh;
   }
 
+  void setPackedTriangles(bool);
+
+  /// Returns true if the triangles of the leaves are packed in
+  /// SoA groups (see setPackedTriangles()).
+  auto packedTriangles() const
+  {
+    return !_groups.empty();
+  }
+
+  size_t packedTriangleMemorySize() const;
+
+  float signedDistance(const vec3f&,
+    float = math::Limits<float>::inf()) const;
+  void signedDistance(std::span<const vec3f>,
+    std::span<float>,
+    float = math::Limits<float>::inf()) const;
+  void signedDistance(RegionGrid3<float, float>&,
+    float = math::Limits<float>::inf()) const;
+
+  /// Returns the directory of the BVH cache.
+  static const auto& cacheDirectory()
+  {
+    return _cacheDirectory;
+  }
+
+  /// Sets the directory of the BVH cache. An empty directory
+  /// disables the cache.
+  static void setCacheDirectory(const std::string& directory)
+  {
+    _cacheDirectory = directory;
+  }
+
 private:
+  /// Triangles of a leaf stored in SoA form for SIMD intersection.
+  /// Unused slots have null edges, which never intersect a ray.
+  struct alignas(32) TriangleGroup
+  {
+    static constexpr int size = 8;
+
+    float p0[3][size];
+    float e1[3][size];
+    float e2[3][size];
+    int32_t ids[size];
+
+  }; // TriangleGroup
+
   Reference<TriangleMesh> _mesh;
+  std::vector<TriangleGroup> _groups;
+  std::vector<uint32_t> _firstGroup;
+  mutable std::once_flag _pseudonormalFlag;
+  mutable std::vector<vec3f> _vertexNormals;
+  mutable std::vector<vec3f> _edgeNormals;
+
+  static std::string _cacheDirectory;
+
+  TriangleMeshBVH(const TriangleMesh&,
+    uint32_t,
+    SplitMethod,
+    NodeLayout,
+    float,
+    int);
+
+  void buildNodes(bool = true);
+  void makeNodes();
+  void makePseudonormals() const;
+  bool intersectGroups(uint32_t, uint32_t, const Ray3f&) const;
+  void intersectGroups(uint32_t,
+    uint32_t,
+    const Ray3f&,
+    Intersection&) const;
+
+  bool splitPrimitive(uint32_t,
+    int,
+    float,
+    Bounds3f&,
+    Bounds3f&) const override;
 
   bool intersectLeaf(uint32_t, uint32_t, const Ray3f&) const override;
   void intersectLeaf(uint32_t,
     uint32_t,
     const Ray3f&,
     Intersection&) const override;
+  void intersectLeaf(uint32_t,
+    uint32_t,
+    const RayPacket&) const override;
+  void closestPointLeaf(uint32_t,
+    uint32_t,
+    const vec3f&,
+    ClosestPoint&) const override;
+
+  friend class TriangleMeshBVHCache;
 
 }; // TriangleMeshBVH
 
@@ -0,0 +1,137 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: TriangleMeshBVHCache.h
+// ========
+// Class definition for triangle mesh BVH cache.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#ifndef __TriangleMeshBVHCache_h
+#define __TriangleMeshBVHCache_h
+
+#include "core/Parallel.h"
+#include "geometry/TriangleMeshBVH.h"
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// TriangleMeshBVHCache: triangle mesh BVH cache class
+// ====================
+/**
+ * @brief Concurrent cache of BVHs of triangle meshes keyed by mesh.
+ *
+ * Entries are looked up by the address of the mesh rather than by
+ * its id. The BVH of an entry references its mesh, hence the mesh
+ * cannot be destroyed, nor its address reused, while cached.
+ *
+ * Threads asking for the BVH of a mesh being built wait for the
+ * build instead of building it again. When the memory used by the
+ * cached BVHs exceeds the memory budget, the least recently used
+ * BVHs not referenced outside the cache are evicted.
+ * A BVH is referenced outside the cache if its reference count is
+ * greater than one; the count can only grow from one under the
+ * lock of the cache, which holds the only reference.
+ */
+class TriangleMeshBVHCache
+{
+public:
+  static constexpr size_t dflMemoryBudget = size_t(1) << 30;
+  /// Minimum of the maximum number of triangles per leaf of a
+  /// coarse BVH (see getAsync()).
+  static constexpr uint32_t coarseLeafSize = 1024;
+
+  TriangleMeshBVHCache() = default;
+  ~TriangleMeshBVHCache();
+
+  Reference<TriangleMeshBVH> get(const TriangleMesh&);
+  Reference<TriangleMeshBVH> getAsync(const TriangleMesh&, bool&);
+
+  auto memoryBudget() const
+  {
+    return _memoryBudget;
+  }
+
+  void setMemoryBudget(size_t);
+  size_t memorySize() const;
+  size_t memorySize(const TriangleMesh&) const;
+  int meshReferenceCount(const TriangleMesh&) const;
+  bool remove(const TriangleMesh&);
+  size_t size() const;
+  void wait();
+  void clear();
+
+private:
+  enum class State
+  {
+    Building,
+    Ready,
+    Failed
+  };
+
+  struct Entry
+  {
+    const TriangleMesh* mesh;
+    State state;
+    Reference<TriangleMeshBVH> bvh;
+    Reference<TriangleMeshBVH> coarse;
+    size_t memorySize;
+    bool buildingCoarse;
+
+  }; // Entry
+
+  using EntryList = std::list<Entry>;
+  using EntryMap =
+    std::unordered_map<const TriangleMesh*, EntryList::iterator>;
+
+  mutable std::mutex _lock;
+  std::condition_variable _built;
+  EntryList _entries; // from the most to the least recently used
+  EntryMap _map;
+  size_t _memoryBudget{dflMemoryBudget};
+  size_t _memorySize{};
+  uint32_t _pending{};
+  // Threads of the background builds. Declared last, hence joined
+  // after the destructor waits for the pending builds.
+  WorkerPool _workers;
+
+  EntryList::iterator find(const TriangleMesh&);
+  EntryList::iterator startBuild(const TriangleMesh&);
+  void finishBuild(const TriangleMesh*, bool, bool);
+  void evict();
+
+}; // TriangleMeshBVHCache
+
+} // end namespace cg
+
+#endif // __TriangleMeshBVHCache_h
@@ -0,0 +1,152 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: TriangleMeshClusters.h
+// ========
+// Class definition for triangle mesh clusters.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#ifndef __TriangleMeshClusters_h
+#define __TriangleMeshClusters_h
+
+#include "geometry/Frustum.h"
+#include "geometry/TriangleMesh.h"
+#include "math/Vector4.h"
+#include <vector>
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// TriangleMeshClusters: triangle mesh clusters class
+// ====================
+/**
+ * @brief Partition of the triangles of a mesh into spatially
+ * coherent clusters, each one a range of the triangles of the mesh,
+ * for culling ranges of triangles before drawing them.
+ *
+ * Each cluster has its bounds and the cone of the normals of its
+ * triangles. A cluster whose bounds are outside the view frustum,
+ * or whose triangles are all back-facing from every point of its
+ * bounding sphere, can be skipped (see cull()).
+ */
+class TriangleMeshClusters: public SharedObject
+{
+public:
+  /// Default maximum number of triangles of a cluster.
+  static constexpr int dflMaxTriangleCount = 128;
+  /// Minimum number of triangles of a mesh worth partitioning.
+  static constexpr int minMeshSize = 1 << 14;
+
+  struct Cluster
+  {
+    Bounds3f bounds;
+    /// Axis of the normal cone.
+    vec3f coneAxis;
+    /// Sine of the half-angle of the normal cone, or a value
+    /// greater than one if the cone is not narrower than a
+    /// half-space, hence the cluster is never back-facing.
+    float coneCutoff;
+    int first;
+    int count;
+
+  }; // Cluster
+
+  /**
+   * @brief Partitions the triangles of \p mesh into clusters.
+   *
+   * The clusters have at most \p maxTriangleCount triangles and at
+   * least about half of that. The triangles of the mesh are
+   * reordered so that the triangles of each cluster are a range,
+   * in the order they were in the mesh. The clusters are cached in
+   * the mesh until its triangles or vertices change, hence this
+   * should be invoked before the mesh is drawn or traced.
+   */
+  static TriangleMeshClusters* make(TriangleMesh& mesh,
+    int maxTriangleCount = dflMaxTriangleCount);
+
+  /// Returns the clusters of \p mesh, or null if \p mesh has not
+  /// been partitioned (see make()).
+  static TriangleMeshClusters* get(const TriangleMesh& mesh);
+
+  auto size() const
+  {
+    return (int)_clusters.size();
+  }
+
+  const auto& operator [](int i) const
+  {
+    return _clusters[i];
+  }
+
+  auto begin() const
+  {
+    return _clusters.begin();
+  }
+
+  auto end() const
+  {
+    return _clusters.end();
+  }
+
+  size_t memorySize() const
+  {
+    return sizeof(Cluster) * _clusters.capacity();
+  }
+
+  /// Returns true if the triangles of \p cluster are back-facing
+  /// from \p viewpoint, a point (w = 1) or, for a parallel
+  /// projection, the direction of projection (w = 0).
+  static bool isBackFacing(const Cluster& cluster, const vec4f& viewpoint);
+
+  /**
+   * @brief Computes the ranges of the triangles of the clusters not
+   * outside \p frustum and, if \p viewpoint is not null, not
+   * back-facing from it (see isBackFacing()).
+   *
+   * The frustum and viewpoint are in the local space of the mesh.
+   * The range i has counts[i] triangles starting at the triangle
+   * offsets[i]. Ranges of consecutive clusters are merged. Returns
+   * the number of triangles of the ranges.
+   */
+  int cull(const Frustum& frustum,
+    const vec4f* viewpoint,
+    std::vector<int>& counts,
+    std::vector<int>& offsets) const;
+
+private:
+  std::vector<Cluster> _clusters;
+
+  TriangleMeshClusters() = default;
+
+}; // TriangleMeshClusters
+
+} // end namespace cg
+
+#endif // __TriangleMeshClusters_h
@@ -0,0 +1,124 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: TriangleMeshFile.h
+// ========
+// Binary triangle mesh file format.
+//
+// Author: Paulo Pagliosa
+// Last revision: 18/10/2026
+
+#ifndef __TriangleMeshFile_h
+#define __TriangleMeshFile_h
+
+#include "core/MappedFile.h"
+#include <cstring>
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// TriangleMeshFileHeader: triangle mesh file header
+// ======================
+//
+// A triangle mesh file stores the arrays of TriangleMesh::Data in
+// sections aligned to 64 bytes, in the byte order of the machine
+// that wrote the file, after this header. An empty section has size
+// zero. The checksum is the hash of the vertex, normal, uv and
+// triangle sections. The optional BVH section holds the binary
+// nodes of a TriangleMeshBVH written with the checksum as key.
+//
+struct TriangleMeshFileHeader
+{
+  enum Section
+  {
+    Vertices,
+    Normals,
+    UV,
+    Triangles,
+    BVH,
+    SectionCount
+  };
+
+  enum Flags: uint32_t
+  {
+    HasBounds = 1
+  };
+
+  static constexpr char fileMagic[8]{'C', 'G', 'M', 'E', 'S', 'H', 0, 0};
+  static constexpr uint32_t fileVersion{1};
+  static constexpr uint32_t fileByteOrder{0x01020304};
+  static constexpr uint64_t alignment{64};
+
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t flags;
+  int32_t vertexCount;
+  int32_t triangleCount;
+  float bounds[6];
+  uint64_t checksum;
+  struct
+  {
+    uint64_t offset;
+    uint64_t size;
+
+  } sections[SectionCount];
+
+  /// Returns the header of the mapped triangle mesh file \p file,
+  /// or null if \p file is not a valid triangle mesh file.
+  static const TriangleMeshFileHeader* get(const MappedFile& file);
+
+}; // TriangleMeshFileHeader
+
+inline const TriangleMeshFileHeader*
+TriangleMeshFileHeader::get(const MappedFile& file)
+{
+  using Header = TriangleMeshFileHeader;
+
+  if (file.size() < sizeof(Header))
+    return nullptr;
+
+  auto header = file.as<const Header>();
+
+  if (memcmp(header->magic, fileMagic, sizeof fileMagic) != 0 ||
+    header->version != fileVersion ||
+    header->byteOrder != fileByteOrder ||
+    header->vertexCount < 0 ||
+    header->triangleCount < 0)
+    return nullptr;
+  for (const auto& section : header->sections)
+    if (section.size > 0 && (section.offset % alignment != 0 ||
+      section.offset > file.size() ||
+      section.size > file.size() - section.offset))
+      return nullptr;
+  return header;
+}
+
+} // end namespace cg
+
+#endif // __TriangleMeshFile_h
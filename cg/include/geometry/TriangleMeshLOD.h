@@ -0,0 +1,108 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: TriangleMeshLOD.h
+// ========
+// Class definition for triangle mesh levels of detail.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#ifndef __TriangleMeshLOD_h
+#define __TriangleMeshLOD_h
+
+#include "geometry/TriangleMesh.h"
+#include <vector>
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// TriangleMeshLOD: triangle mesh levels of detail class
+// ===============
+/**
+ * @brief Chain of simplified versions of a triangle mesh.
+ *
+ * The level i, i = 1, ..., has about 1/2^i of the triangles of the
+ * mesh and is made by MeshSimplifier and MeshOptimizer. The error
+ * of a level is an estimate, in mesh units, of its distance to the
+ * mesh (see MeshSimplifier::error()).
+ */
+class TriangleMeshLOD: public SharedObject
+{
+public:
+  /// Maximum number of levels.
+  static constexpr int maxLevels = 3;
+  /// Minimum number of triangles of a level.
+  static constexpr int minTriangleCount = 256;
+
+  struct Level
+  {
+    Reference<TriangleMesh> mesh;
+    float error;
+
+  }; // Level
+
+  /// Constructs the levels of detail of \p mesh.
+  TriangleMeshLOD(const TriangleMesh& mesh);
+
+  /// Destructor.
+  ~TriangleMeshLOD();
+
+  /**
+   * @brief Returns the levels of detail of \p mesh.
+   *
+   * The levels are cached in the mesh. If not yet, they are made
+   * from a copy of the mesh by a bounded pool of background
+   * workers, and the object returned has no levels until its job
+   * finishes. The levels must be used by the thread calling get()
+   * only.
+   */
+  static TriangleMeshLOD* get(const TriangleMesh& mesh);
+
+  int levelCount() const;
+  const Level& level(int i) const;
+
+  /// Returns the coarsest level whose error is at most \p maxError,
+  /// or null if none.
+  const TriangleMesh* select(float maxError) const;
+
+private:
+  struct Job;
+
+  mutable std::vector<Level> _levels;
+  mutable Reference<Job> _job;
+
+  TriangleMeshLOD() = default;
+
+  static void make(const TriangleMesh&, std::vector<Level>&);
+
+}; // TriangleMeshLOD
+
+} // end namespace cg
+
+#endif // __TriangleMeshLOD_h
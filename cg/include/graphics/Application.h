@@ -28,11 +28,12 @@
 // Class definition for graphics application.
 //
 // Author: Paulo Pagliosa
-// Last revision: 14/12/2022
+// Last revision: 19/10/2026
 
 #ifndef __Application_h
 #define __Application_h
 
+#include "geometry/TriangleMeshClusters.h"
 #include "graphics/GLWindow.h"
 #include "utils/MeshReader.h"
 
@@ -80,10 +81,22 @@ public:
     p.loadShaders(assetFilePath(vs), assetFilePath(fs));
   }
 
-  /// Loads a mesh from an OBJ file.
+  /**
+   * @brief Loads a mesh from an OBJ, PLY, STL or triangle mesh file.
+   *
+   * The triangles of a large mesh are partitioned into clusters
+   * culled by GLRenderer (see TriangleMeshClusters), unless the mesh
+   * references the pages of a triangle mesh file, whose triangles
+   * and BVH would be copied.
+   */
   static TriangleMesh* loadMesh(const char* filename)
   {
-    return MeshReader::readOBJ(assetFilePath(filename).c_str());
+    auto mesh = MeshReader::read(assetFilePath(filename).c_str());
+
+    if (mesh != nullptr && mesh->source() == nullptr &&
+      mesh->data().triangleCount >= TriangleMeshClusters::minMeshSize)
+      TriangleMeshClusters::make(*mesh);
+    return mesh;
   }
 
 private:
@@ -28,15 +28,19 @@
 // Class definition for assets.
 //
 // Author: Paulo Pagliosa
-// Last revision: 13/07/2022
+// Last revision: 18/10/2026
 
 #ifndef __Assets_h
 #define __Assets_h
 
 #include "graphics/Material.h"
 #include "utils/MeshReader.h"
+#include <functional>
+#include <list>
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace cg
 { // begin namespace cg
@@ -49,6 +53,65 @@ using MaterialMap = std::map<std::string, MaterialRef>;
 using MaterialMapIterator = typename MaterialMap::const_iterator;
 
 
+/////////////////////////////////////////////////////////////////////
+//
+// MeshRequest: asynchronous mesh load request class
+// ===========
+class MeshRequest: public SharedObject
+{
+public:
+  using Callback = std::function<void(TriangleMesh&)>;
+
+  auto name() const
+  {
+    return _mit->first.c_str();
+  }
+
+  /// Returns true if the mesh has been loaded.
+  bool ready() const
+  {
+    return _state == State::Ready;
+  }
+
+  /// Returns true if the mesh could not be loaded.
+  bool failed() const
+  {
+    return _state == State::Failed;
+  }
+
+  /**
+   * @brief Returns the mesh of this request.
+   *
+   * Until ready, it is a placeholder (see Assets::placeholderMesh()).
+   */
+  TriangleMesh* mesh() const;
+
+private:
+  enum class State
+  {
+    Loading,
+    Ready,
+    Failed
+  };
+
+  MeshMapIterator _mit;
+  State _state{State::Loading};
+  MeshRef _mesh;
+  std::vector<Callback> _callbacks;
+
+  MeshRequest(MeshMapIterator mit):
+    _mit{mit}
+  {
+    // do nothing
+  }
+
+  friend class Assets;
+
+}; // MeshRequest
+
+using MeshRequestRef = Reference<MeshRequest>;
+
+
 /////////////////////////////////////////////////////////////////////
 //
 // Assets: assets class
@@ -56,9 +119,21 @@ using MaterialMapIterator = typename MaterialMap::const_iterator;
 class Assets
 {
 public:
-  static constexpr auto dflMaxMeshSize = 1ULL << 20;
+  static constexpr auto dflMeshMemoryBudget = 1ULL << 30;
+  /// Default time budget, in ms, of uploadMeshes().
+  static constexpr auto dflUploadTimeBudget = 2.0;
+
+  /// Mesh cache statistics.
+  struct MeshCacheStatistics
+  {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t evictedBytes;
 
-  static void initialize(size_t = dflMaxMeshSize);
+  }; // MeshCacheStatistics
+
+  static void initialize(size_t = dflMeshMemoryBudget);
 
   static MeshMap& meshes()
   {
@@ -72,6 +147,63 @@ public:
 
   static TriangleMesh* loadMesh(MeshMapIterator);
 
+  static MeshRequestRef loadMeshAsync(const std::string& meshName,
+    MeshRequest::Callback onReady = {})
+  {
+    return loadMeshAsync(_meshes.find(meshName), std::move(onReady));
+  }
+
+  /**
+   * @brief Starts loading a mesh on a background thread.
+   *
+   * The returned request is ready at once if the mesh is cached.
+   * Otherwise, its mesh is the placeholder mesh until a later call
+   * to uploadMeshes() finishes the load, and then \p onReady is
+   * called with the mesh. Requests for a mesh already being loaded
+   * share the same request. Returns null if there is no such mesh.
+   */
+  static MeshRequestRef loadMeshAsync(MeshMapIterator,
+    MeshRequest::Callback onReady = {});
+
+  /**
+   * @brief Finishes the asynchronous loads whose meshes have been
+   * read.
+   *
+   * For each of them, creates the GLMesh of the mesh and calls the
+   * callbacks of its request. Must be called by the GL thread; it
+   * is called by GLWindow once per frame. Returns after \p timeBudget
+   * ms, but finishes at least one load per call.
+   */
+  static void uploadMeshes(double timeBudget = dflUploadTimeBudget);
+
+  /// Returns the number of asynchronous loads not yet finished.
+  static int pendingMeshCount()
+  {
+    return (int)_requests.size();
+  }
+
+  static auto meshMemoryBudget()
+  {
+    return _meshMemoryBudget;
+  }
+
+  static void setMeshMemoryBudget(size_t budget);
+  static size_t meshMemorySize();
+  static size_t memorySize(const TriangleMesh& mesh);
+
+  static const auto& meshCacheStatistics()
+  {
+    return _statistics;
+  }
+
+  static void resetMeshCacheStatistics()
+  {
+    _statistics = {};
+  }
+
+  /// Returns the mesh rendered while an asset mesh is loading.
+  static TriangleMesh* placeholderMesh();
+
   static MaterialMap& materials()
   {
     return _materials;
@@ -85,11 +217,22 @@ public:
   }
 
 private:
+  // Cached meshes from the most to the least recently used
+  using MeshLRU = std::list<MeshMap::iterator>;
+
   static bool _initialized;
   static MeshMap _meshes;
   static MaterialMap _materials;
-  static size_t _maxMeshSize;
-  static size_t _meshSize;
+  static size_t _meshMemoryBudget;
+  static MeshLRU _lru;
+  static std::unordered_map<const TriangleMesh*, MeshLRU::iterator> _lruIndex;
+  static MeshCacheStatistics _statistics;
+  static std::map<std::string, MeshRequestRef> _requests;
+
+  static TriangleMesh* hit(MeshMapIterator);
+  static size_t evict(size_t);
+  static bool reserve(size_t);
+  static TriangleMesh* cacheMesh(MeshMapIterator, TriangleMesh*);
 
 }; // Assets
 
@@ -0,0 +1,77 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: ChunkedTriangleMeshShape.h
+// ========
+// Class definition for chunked triangle mesh shape.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#ifndef __ChunkedTriangleMeshShape_h
+#define __ChunkedTriangleMeshShape_h
+
+#include "geometry/ChunkedTriangleMesh.h"
+#include "graphics/Shape.h"
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// ChunkedTriangleMeshShape: chunked triangle mesh shape class
+// ========================
+/**
+ * @brief Shape of an out-of-core chunked triangle mesh.
+ *
+ * The shape has no tesselation: rays page in the chunks they reach
+ * and GLRenderer draws the chunks in the view frustum.
+ */
+class ChunkedTriangleMeshShape: public Shape
+{
+public:
+  ChunkedTriangleMeshShape(const ChunkedTriangleMesh&);
+
+  bool canIntersect() const override;
+  vec3f normal(const Intersection&) const override;
+  Bounds3f bounds() const override;
+
+  const ChunkedTriangleMesh* mesh() const
+  {
+    return _mesh;
+  }
+
+private:
+  Reference<ChunkedTriangleMesh> _mesh;
+
+  bool localIntersect(const Ray3f&) const final;
+  bool localIntersect(const Ray3f&, Intersection&) const final;
+
+}; // ChunkedTriangleMeshShape
+
+} // end namespace cg
+
+#endif // __ChunkedTriangleMeshShape_h
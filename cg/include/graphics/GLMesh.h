@@ -28,7 +28,7 @@
 // Class definition for OpenGL mesh array object.
 //
 // Author: Paulo Pagliosa
-// Last revision: 28/08/2023
+// Last revision: 19/10/2026
 
 #ifndef __GLMesh_h
 #define __GLMesh_h
@@ -49,8 +49,27 @@ using GLColorBuffer = GLBuffer<Color>;
 class GLMesh: public SharedObject
 {
 public:
+  /**
+   * @brief Vertex buffer layout.
+   *
+   * Separate uploads positions, normals and uv into a buffer each.
+   * Interleaved uploads them into a single buffer with one stride,
+   * so a vertex fetch touches one cache line. InterleavedPacked
+   * also packs normals as GL_INT_2_10_10_10_REV (4 instead of 12
+   * bytes per normal).
+   */
+  enum class Layout
+  {
+    Separate,
+    Interleaved,
+    InterleavedPacked
+  };
+
+  /// Layout of the GLMesh objects created by glMesh().
+  static Layout defaultLayout;
+
   /// Constructs a GLMesh object.
-  GLMesh(const TriangleMesh& mesh);
+  GLMesh(const TriangleMesh& mesh, Layout layout = defaultLayout);
 
   /// Destructor.
   ~GLMesh()
@@ -69,12 +88,55 @@ public:
     return _vertexCount;
   }
 
+  auto layout() const
+  {
+    return _layout;
+  }
+
+  /// Returns GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+  auto indexType() const
+  {
+    return _indexType;
+  }
+
+  auto indexSize() const
+  {
+    return _indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+  }
+
+  /// Returns the size in bytes of the uploaded buffers.
+  auto memorySize() const
+  {
+    return _memorySize;
+  }
+
+  /// Draws count triangles starting at the triangle offset.
+  void drawTriangles(int count, int offset = 0)
+  {
+    bind();
+    glDrawElements(GL_TRIANGLES,
+      count * 3,
+      _indexType,
+      (void*)(indexSize() * 3 * size_t(offset)));
+  }
+
+  /// Draws n ranges of triangles with a single call. The range i
+  /// has counts[i] triangles starting at the triangle offsets[i].
+  void drawTriangles(const int* counts, const int* offsets, int n);
+
   void setColors(GLColorBuffer* colors, int location = 3);
 
 private:
   GLuint _vao;
   GLuint _buffers[4];
   int _vertexCount;
+  Layout _layout;
+  GLenum _indexType;
+  size_t _memorySize;
+
+  void uploadSeparate(const TriangleMesh& mesh);
+  void uploadInterleaved(const TriangleMesh& mesh, bool packNormals);
+  void uploadIndices(const TriangleMesh& mesh);
 
 }; // GLMesh
 
@@ -28,7 +28,7 @@
 // Class definition for OpenGL Renderer.
 //
 // Author: Paulo Pagliosa
-// Last revision: 02/09/2023
+// Last revision: 19/10/2026
 
 #ifndef __GLRenderer_h
 #define __GLRenderer_h
@@ -40,6 +40,9 @@
 namespace cg
 { // begin namespace Graphics
 
+class ChunkedTriangleMesh;
+class TriangleMeshClusters;
+
 
 //////////////////////////////////////////////////////////
 //
@@ -57,6 +60,11 @@ public:
   using GLGraphics3::drawMesh;
   using GLGraphics3::drawSubMesh;
 
+  /// Maximum screen-space error, in pixels, of the level of detail
+  /// of the mesh of a primitive (see TriangleMeshLOD). If zero, the
+  /// meshes are drawn in full detail.
+  float lodTolerance{1};
+
   /// Constructs a GL renderer object.
   GLRenderer(SceneBase& scene, Camera& camera);
 
@@ -76,6 +84,13 @@ public:
     const mat4f& t,
     const mat3f& n);
 
+  /// Draws the chunks of \p mesh in the view frustum, paging them
+  /// in if they are not resident.
+  void drawChunkedMesh(const ChunkedTriangleMesh& mesh,
+    const Material& material,
+    const mat4f& t,
+    const mat3f& n);
+
   void setRenderFunction(RenderFunction f)
   {
     _renderFunction = f;
@@ -97,12 +112,21 @@ protected:
   virtual void renderLights();
 
   void drawAxes(const mat4f&, float);
+  const TriangleMesh* levelOfDetail(const TriangleMesh&,
+    const Primitive&) const;
   void drawMesh(const TriangleMesh&,
     const Material&,
     const mat4f&,
     const mat3f&,
     int,
     int);
+  void drawClusters(const TriangleMesh&,
+    const TriangleMeshClusters&,
+    const Primitive&);
+  GLMesh* prepareMesh(const TriangleMesh&,
+    const Material&,
+    const mat4f&,
+    const mat3f&);
 
 private:
   struct GLData;
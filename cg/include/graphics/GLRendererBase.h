@@ -28,7 +28,7 @@
 // Class definition for OpenGL renderer base.
 //
 // Author: Paulo Pagliosa
-// Last revision: 28/02/2022
+// Last revision: 19/10/2026
 
 #ifndef __GLRendererBase_h
 #define __GLRendererBase_h
@@ -62,7 +62,8 @@ public:
     UseLights = 1,
     UseVertexColors = 2,
     DrawBounds = 4,
-    DrawNormals = 8
+    DrawNormals = 8,
+    CullBackFaces = 16
   };
 
   using RenderFlags = Flags<RenderBits>;
@@ -28,7 +28,7 @@
 // Class definition for primitive BVH.
 //
 // Author: Paulo Pagliosa
-// Last revision: 24/01/2022
+// Last revision: 18/10/2026
 
 #ifndef __PrimitiveBVH_h
 #define __PrimitiveBVH_h
@@ -48,6 +48,7 @@ class PrimitiveBVH final: public Aggregate
 {
 public:
   using PrimitiveArray = typename BVH<Primitive>::PrimitiveArray;
+  using PrimitiveFunction = typename BVH<Primitive>::PrimitiveFunction;
 
   PrimitiveBVH(PrimitiveArray&& primitives):
     _bvh{new BVH<Primitive>{std::move(primitives)}}
@@ -62,6 +63,21 @@ public:
 
   Bounds3f bounds() const override;
 
+  /// Invokes \p f for the primitives whose bounds may intersect
+  /// \p frustum, e.g., for view-frustum culling or rubber-band
+  /// selection, without a linear scan of the primitives.
+  void query(const Frustum& frustum, const PrimitiveFunction& f) const
+  {
+    _bvh->queryPrimitives(frustum, f);
+  }
+
+  /// Invokes \p f for the primitives whose bounds may intersect
+  /// \p box.
+  void query(const Bounds3f& box, const PrimitiveFunction& f) const
+  {
+    _bvh->queryPrimitives(box, f);
+  }
+
 private:
   Reference<BVH<Primitive>> _bvh;
 
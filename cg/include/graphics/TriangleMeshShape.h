@@ -28,13 +28,15 @@
 // Class definition for triangle mesh shape.
 //
 // Author: Paulo Pagliosa
-// Last revision: 21/06/2023
+// Last revision: 19/10/2026
 
 #ifndef __TriangleMeshShape_h
 #define __TriangleMeshShape_h
 
-#include "geometry/TriangleMeshBVH.h"
+#include "geometry/TriangleMeshBVHCache.h"
 #include "graphics/Shape.h"
+#include <atomic>
+#include <mutex>
 
 namespace cg
 { // begin namespace cg
@@ -61,12 +63,34 @@ public:
 
   void setMesh(const TriangleMesh&);
 
+  static TriangleMeshBVHCache& bvhCache();
+
+  /// Returns true if the BVHs of the meshes are built in background.
+  static auto asyncBVHBuild()
+  {
+    return _asyncBVHBuild;
+  }
+
+  static void setAsyncBVHBuild(bool async)
+  {
+    _asyncBVHBuild = async;
+  }
+
 protected:
   TriangleMeshBVH* bvh() const;
 
 private:
   Reference<TriangleMesh> _mesh;
+  // BVH used by the ray queries, either the complete or the coarse
+  // BVH of the mesh. Both are kept until the mesh changes, hence a
+  // query never outlives its BVH.
+  mutable std::atomic<TriangleMeshBVH*> _queryBVH{};
+  mutable std::atomic<bool> _bvhComplete{};
   mutable Reference<TriangleMeshBVH> _bvh;
+  mutable Reference<TriangleMeshBVH> _coarseBVH;
+  mutable std::mutex _bvhLock;
+
+  static bool _asyncBVHBuild;
 
   bool localIntersect(const Ray3f&) const final;
   bool localIntersect(const Ray3f&, Intersection&) const final;
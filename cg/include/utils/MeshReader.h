@@ -28,7 +28,7 @@
 // Class definition for mesh reader.
 //
 // Author: Paulo Pagliosa
-// Last revision: 15/09/2018
+// Last revision: 18/10/2026
 
 #ifndef __MeshReader_h
 #define __MeshReader_h
@@ -46,7 +46,28 @@ namespace cg
 class MeshReader
 {
 public:
-  static TriangleMesh* readOBJ(const char* filename);
+  static TriangleMesh* read(const char* filename);
+
+  /// Reads the Wavefront OBJ file \p filename. The file is memory
+  /// mapped and parsed in parallel, in line-aligned chunks. Returns
+  /// null if the file cannot be read.
+  ///
+  /// If \p attributes is true, the texture coordinates and normals
+  /// of the faces are read, and the face vertices with distinct
+  /// position/texture/normal index triples become distinct mesh
+  /// vertices. Vertex normals are computed only if some face vertex
+  /// has no normal.
+  static TriangleMesh* readOBJ(const char* filename,
+    bool attributes = true);
+
+  /// Reads the vertex positions and faces of the Wavefront OBJ file
+  /// \p filename with two sequential passes of stdio calls. It is
+  /// used when the file cannot be mapped into memory.
+  static TriangleMesh* readOBJSequential(const char* filename);
+
+  static TriangleMesh* readMesh(const char* filename, bool verify = false);
+  static TriangleMesh* readPLY(const char* filename);
+  static TriangleMesh* readSTL(const char* filename);
 
 }; // MeshReader
 
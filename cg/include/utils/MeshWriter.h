@@ -28,7 +28,7 @@
 // Class definition for mesh writer.
 //
 // Author: Paulo Pagliosa
-// Last revision: 29/08/2023
+// Last revision: 19/10/2026
 
 #ifndef __MeshWriter_h
 #define __MeshWriter_h
@@ -38,6 +38,8 @@
 namespace cg
 { // begin namespace cg
 
+class TriangleMeshBVH;
+
 
 /////////////////////////////////////////////////////////////////////
 //
@@ -46,7 +48,20 @@ namespace cg
 class MeshWriter
 {
 public:
-  static bool writeOBJ(const TriangleMesh& mesh, const char* filename);
+  /// Default maximum number of triangles of a chunk of a chunked
+  /// triangle mesh file (see writeChunkedMesh()).
+  static constexpr int dflChunkTriangleCount = 1 << 16;
+
+  static bool writeOBJ(const TriangleMesh& mesh,
+    const char* filename,
+    bool parallel = false);
+  static bool writeMesh(const TriangleMesh& mesh,
+    const char* filename,
+    const TriangleMeshBVH* bvh = nullptr);
+  static bool writeChunkedMesh(const TriangleMesh& mesh,
+    const char* filename,
+    int maxTrianglesPerChunk = dflChunkTriangleCount,
+    uint32_t maxTrianglesPerNode = 20);
 
 }; // MeshWriter
 
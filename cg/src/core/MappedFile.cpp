@@ -0,0 +1,210 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: MappedFile.cpp
+// ========
+// Source file for memory-mapped file.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#include "core/MappedFile.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// MappedFile implementation
+// ==========
+#ifdef _WIN32
+MappedFile*
+MappedFile::open(const char* filename, Access access)
+{
+  auto file = CreateFileA(filename,
+    GENERIC_READ,
+    FILE_SHARE_READ,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_FLAG_SEQUENTIAL_SCAN,
+    nullptr);
+
+  if (file == INVALID_HANDLE_VALUE)
+    return nullptr;
+
+  LARGE_INTEGER size;
+
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+  {
+    CloseHandle(file);
+    return nullptr;
+  }
+
+  auto mapping = CreateFileMappingA(file,
+    nullptr,
+    access == ReadOnly ? PAGE_READONLY : PAGE_WRITECOPY,
+    0,
+    0,
+    nullptr);
+
+  if (mapping == nullptr)
+  {
+    CloseHandle(file);
+    return nullptr;
+  }
+
+  auto data = MapViewOfFile(mapping,
+    access == ReadOnly ? FILE_MAP_READ : FILE_MAP_COPY,
+    0,
+    0,
+    0);
+
+  if (data == nullptr)
+  {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return nullptr;
+  }
+
+  auto mf = new MappedFile;
+
+  mf->_data = static_cast<uint8_t*>(data);
+  mf->_size = (size_t)size.QuadPart;
+  mf->_file = file;
+  mf->_mapping = mapping;
+  return mf;
+}
+
+MappedFile::~MappedFile()
+{
+  UnmapViewOfFile(_data);
+  CloseHandle(_mapping);
+  CloseHandle(_file);
+}
+
+void
+MappedFile::prefetch(size_t offset, size_t size) const
+{
+  if (offset >= _size)
+    return;
+#if _WIN32_WINNT >= 0x0602
+  WIN32_MEMORY_RANGE_ENTRY range{_data + offset,
+    std::min(size, _size - offset)};
+
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+  (void)size;
+#endif // _WIN32_WINNT >= 0x0602
+}
+
+void
+MappedFile::discard(size_t offset, size_t size) const
+{
+  // Unlocking pages not locked removes them from the working set
+  if (offset < _size)
+    VirtualUnlock(_data + offset, std::min(size, _size - offset));
+}
+#else
+MappedFile*
+MappedFile::open(const char* filename, Access access)
+{
+  auto fd = ::open(filename, O_RDONLY);
+
+  if (fd < 0)
+    return nullptr;
+
+  struct stat s;
+
+  if (fstat(fd, &s) != 0 || s.st_size == 0)
+  {
+    close(fd);
+    return nullptr;
+  }
+
+  auto size = (size_t)s.st_size;
+  auto data = access == ReadOnly ?
+    mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) :
+    mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+  // The mapping remains valid after closing the file descriptor.
+  close(fd);
+  if (data == MAP_FAILED)
+    return nullptr;
+
+  auto mf = new MappedFile;
+
+  mf->_data = static_cast<uint8_t*>(data);
+  mf->_size = size;
+  return mf;
+}
+
+MappedFile::~MappedFile()
+{
+  munmap(_data, _size);
+}
+
+void
+MappedFile::prefetch(size_t offset, size_t size) const
+{
+  if (offset < _size)
+    madvise(_data + offset, std::min(size, _size - offset), MADV_WILLNEED);
+}
+
+void
+MappedFile::discard(size_t offset, size_t size) const
+{
+  if (offset < _size)
+    madvise(_data + offset, std::min(size, _size - offset), MADV_DONTNEED);
+}
+#endif // _WIN32
+
+std::string
+MappedFile::tempName(const char* filename)
+{
+  // The random seed distinguishes the processes, and the counter
+  // the threads of a process, writing the same file.
+  static const auto seed = std::random_device{}();
+  static std::atomic<uint32_t> counter;
+  char suffix[24];
+
+  snprintf(suffix, sizeof suffix, ".%08x%08x.tmp", seed, counter++);
+  return std::string{filename} + suffix;
+}
+
+} // end namespace cg
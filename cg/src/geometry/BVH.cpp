@@ -28,12 +28,25 @@
 // Source file for BVH.
 //
 // Author: Paulo Pagliosa
-// Last revision: 22/07/2025
+// Last revision: 19/10/2026
 
+#include "core/Hash.h"
+#include "core/MappedFile.h"
+#include "core/Parallel.h"
 #include "geometry/BVH.h"
 #include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
 #include <stack>
 
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#define BVH_USE_SSE
+#include <immintrin.h>
+#endif
+
 namespace cg
 { // begin namespace cg
 
@@ -90,13 +103,19 @@ BVHBase::Node::iterate(const Node* node, NodeFunction f)
   if (node == nullptr)
     return;
 
-  auto isLeaf = node->isLeaf();
+  // Visit the nodes in depth-first order without recursion.
+  std::vector<const Node*> stack{node};
 
-  f(node);
-  if (!node->isLeaf())
+  while (!stack.empty())
   {
-    iterate(node->_children[0], f);
-    iterate(node->_children[1], f);
+    node = stack.back();
+    stack.pop_back();
+    f(node);
+    if (!node->isLeaf())
+    {
+      stack.push_back(node->child(1));
+      stack.push_back(node->child(0));
+    }
   }
 }
 
@@ -117,7 +136,7 @@ maxDim(const Bounds3f& b)
  * https://github.com/mmp/pbrt-v4.
  * 
  */
-BVHBase::Node*
+uint32_t
 BVHBase::makeNode(const PrimitiveInfoArray& primitiveInfo,
   uint32_t first,
   uint32_t end)
@@ -127,14 +146,13 @@ BVHBase::makeNode(const PrimitiveInfoArray& primitiveInfo,
   // Compute the bounds of all primitives in the node.
   for (auto i = first; i < end; ++i)
     bounds.inflate(primitiveInfo[_primitiveIds[i]].bounds);
-  ++_nodeCount;
 
   auto count = end - first;
 
   // If the number of primitives is less than the maximum number
   // of primitives per node, then create a leaf node.
   if (count <= _maxPrimitivesPerNode)
-    return new Node{bounds, first, count};
+    return makeLeaf(bounds, first, count);
 
   Bounds3f centroidBounds;
 
@@ -147,7 +165,7 @@ BVHBase::makeNode(const PrimitiveInfoArray& primitiveInfo,
   // If all primitive centroids are at the same position (volume
   // of centroid bounds is zero), then create a leaf node.
   if (centroidBounds.max()[dim] == centroidBounds.min()[dim])
-    return new Node{bounds, first, count};
+    return makeLeaf(bounds, first, count);
 
   const auto pidBegin = _primitiveIds.begin();
   auto mid = (first + end) >> 1;
@@ -237,7 +255,7 @@ BVHBase::makeNode(const PrimitiveInfoArray& primitiveInfo,
     // a lower cost than having a node with all primitives, then
     // create a leaf node.
     if (leafCost <= minCost)
-      return new Node{bounds, first, count};
+      return makeLeaf(bounds, first, count);
 
     // Otherwise, partition primitives.
     auto mit = std::partition(pidBegin + first,
@@ -248,77 +266,2252 @@ BVHBase::makeNode(const PrimitiveInfoArray& primitiveInfo,
       });
     mid = uint32_t(mit - pidBegin);
   }
-  // Create an interior node and its two children.
-  return new Node{makeNode(primitiveInfo, first, mid),
-    makeNode(primitiveInfo, mid, end)};
+  // Create an interior node and its two children. The first child
+  // immediately follows the node in the node array.
+  auto index = makeLeaf(bounds, 0, 0);
+
+  makeNode(primitiveInfo, first, mid);
+
+  auto second = makeNode(primitiveInfo, mid, end);
+
+  _nodes[index]._offset = second - index;
+  return index;
 }
 
-BVHBase::~BVHBase()
+inline uint32_t
+BVHBase::makeLeaf(const Bounds3f& bounds, uint32_t first, uint32_t count)
+{
+  auto index = (uint32_t)_nodes.size();
+
+  _nodes.push_back({bounds, first, count});
+  return index;
+}
+
+/**
+ * @brief Split of the primitive references of a node.
+ *
+ * An object split partitions the references by the bin of their
+ * centroids, whereas a spatial split partitions them by the plane
+ * between the bins \p bin and \p bin + 1 of the node bounds. The
+ * cost is the unnormalized SAH cost of the split.
+ */
+struct BVHBase::Split
+{
+  float cost{math::Limits<float>::inf()};
+  int dim{};
+  int bin{};
+  Bounds3f left;
+  Bounds3f right;
+
+}; // BVHBase::Split
+
+namespace
+{ // begin namespace
+
+constexpr int objectBins{12};
+constexpr int spatialBins{16};
+constexpr uint32_t maxSpatialDepth{48};
+// Minimum overlap of the children of an object split, relative
+// to the area of the root bounds, for trying a spatial split.
+constexpr float minOverlap{1e-5f};
+
+inline auto
+binIndex(float s, float d, int n)
+{
+  auto b = int(s * d);
+  return b < 0 ? 0 : (b < n ? b : n - 1);
+}
+
+inline auto
+cost(const Bounds3f& bounds, size_t count)
+{
+  return count == 0 ? 0.f : bounds.area() * count;
+}
+
+inline auto
+clip(const Bounds3f& a, const Bounds3f& b)
+{
+  auto p1 = math::max(a.min(), b.min());
+  auto p2 = math::min(a.max(), b.max());
+
+  if (p1.x > p2.x || p1.y > p2.y || p1.z > p2.z)
+    return Bounds3f{};
+  return Bounds3f{p1, p2};
+}
+
+inline auto
+isEmpty(const Bounds3f& b)
 {
-  delete _root;
+  // A flat box, which is empty() for Bounds3, still bounds a
+  // primitive lying on a coordinate plane.
+  const auto& p1 = b.min();
+  const auto& p2 = b.max();
+
+  return p1.x > p2.x || p1.y > p2.y || p1.z > p2.z;
 }
 
+} // end namespace
+
+/**
+ * @brief Computes the bounds of the parts of the primitive \p index
+ * on each side of the plane perpendicular to the axis \p dim at
+ * \p position.
+ *
+ * Returns false if the primitive cannot be split, in which case
+ * the bounds of a split reference are clipped by the plane. This
+ * is correct for any kind of primitive, but derived classes should
+ * split the primitive itself in order to obtain tighter bounds.
+ */
 bool
-BVHBase::intersect(const Ray3f& ray) const
+BVHBase::splitPrimitive(uint32_t, int, float, Bounds3f&, Bounds3f&) const
 {
-  NodeRay r{ray};
-  std::stack<Node*> stack;
+  return false;
+}
 
-  stack.push(_root);
-  while (!stack.empty())
+void
+BVHBase::splitReference(uint32_t index,
+  int dim,
+  float position,
+  const Bounds3f& bounds,
+  Bounds3f& left,
+  Bounds3f& right) const
+{
+  auto p1 = bounds.max();
+  auto p2 = bounds.min();
+
+  p1[dim] = math::min(p1[dim], position);
+  p2[dim] = math::max(p2[dim], position);
+
+  auto lb = clip(bounds, Bounds3f{bounds.min(), p1});
+  auto rb = clip(bounds, Bounds3f{p2, bounds.max()});
+
+  if (splitPrimitive(index, dim, position, left, right))
   {
-    auto node = stack.top();
+    left = clip(left, lb);
+    right = clip(right, rb);
+  }
+  else
+  {
+    left = lb;
+    right = rb;
+  }
+}
 
-    stack.pop();
-    if (node->intersect(r))
-      if (!node->isLeaf())
+/**
+ * @brief Builds the nodes of this BVH by spatial splits.
+ *
+ * The method is based on "Spatial Splits in Bounding Volume
+ * Hierarchies" by M. Stich, H. Friedrich, and A. Dietrich (HPG
+ * 2009). Every node is split either by the best binned SAH object
+ * split or, if the children of the latter overlap, by the best
+ * binned spatial split, whichever has the lowest cost. A spatial
+ * split may reference a primitive from both children. The number
+ * of references is limited by the duplication budget, which is
+ * the fraction of the number of primitives that can be added by
+ * spatial splits.
+ */
+void
+BVHBase::makeSpatialNodes(const PrimitiveInfoArray& primitiveInfo)
+{
+  auto np = (uint32_t)primitiveInfo.size();
+  PrimitiveInfoArray refs{primitiveInfo};
+  Bounds3f bounds;
+
+  for (const auto& p : primitiveInfo)
+    bounds.inflate(p.bounds);
+  _rootArea = bounds.area();
+  _references = np;
+  _maxReferences = np + uint32_t(np * _duplicationBudget);
+  _primitiveIds.clear();
+  _primitiveIds.reserve(_maxReferences);
+  makeSpatialNode(refs, 0);
+  _primitiveIds.shrink_to_fit();
+}
+
+uint32_t
+BVHBase::makeSpatialNode(PrimitiveInfoArray& refs, uint32_t depth)
+{
+  Bounds3f bounds;
+  Bounds3f centroidBounds;
+
+  for (const auto& r : refs)
+  {
+    bounds.inflate(r.bounds);
+    centroidBounds.inflate(r.centroid);
+  }
+
+  auto count = (uint32_t)refs.size();
+  const auto makeLeaf = [&, this]()
+    {
+      auto first = (uint32_t)_primitiveIds.size();
+
+      for (const auto& r : refs)
+        _primitiveIds.push_back(r.index);
+      return BVHBase::makeLeaf(bounds, first, count);
+    };
+
+  if (count <= _maxPrimitivesPerNode)
+    return makeLeaf();
+
+  auto split = findObjectSplit(refs, centroidBounds);
+  auto spatial = false;
+
+  // Try a spatial split only if the children of the object split
+  // overlap and the duplication budget was not exhausted.
+  if (depth < maxSpatialDepth && _references < _maxReferences)
+  {
+    auto overlap = clip(split.left, split.right);
+
+    if (isEmpty(split.left) ||
+      (!isEmpty(overlap) && overlap.area() > minOverlap * _rootArea))
+    {
+      auto s = findSpatialSplit(refs, bounds);
+
+      if (s.cost < split.cost)
       {
-        stack.push(node->_children[0]);
-        stack.push(node->_children[1]);
+        split = s;
+        spatial = true;
       }
-      else if (intersectLeaf(node->_first, node->_count, ray))
-        return true;
+    }
   }
-  return false;
+
+  const auto leafCost = float(count);
+
+  // If the best split does not have a lower cost than having a
+  // node with all primitive references, then create a leaf node.
+  if (leafCost <= 1.f / 2.f + split.cost / bounds.area())
+    return makeLeaf();
+
+  PrimitiveInfoArray left;
+  PrimitiveInfoArray right;
+
+  if (spatial)
+  {
+    splitReferences(refs, bounds, split, left, right);
+    // A spatial split can move all references to a single side
+    // when they are unsplit. Fall back to the object split.
+    if (left.empty() || right.empty())
+    {
+      left.clear();
+      right.clear();
+      split = findObjectSplit(refs, centroidBounds);
+      if (isEmpty(split.left))
+        return makeLeaf();
+      spatial = false;
+    }
+  }
+  if (!spatial)
+    splitObjects(refs, centroidBounds, split, left, right);
+  PrimitiveInfoArray{}.swap(refs);
+
+  // Create an interior node and its two children. The first child
+  // immediately follows the node in the node array.
+  auto index = BVHBase::makeLeaf(bounds, 0, 0);
+
+  makeSpatialNode(left, depth + 1);
+
+  auto second = makeSpatialNode(right, depth + 1);
+
+  _nodes[index]._offset = second - index;
+  return index;
 }
 
-bool
-BVHBase::intersect(const Ray3f& ray, Intersection& hit) const
+auto
+BVHBase::findObjectSplit(const PrimitiveInfoArray& refs,
+  const Bounds3f& centroidBounds) const -> Split
 {
-  hit.object = nullptr;
-  hit.distance = ray.tMax;
+  Split split;
 
-  NodeRay r{ray};
-  std::stack<Node*> stack;
+  for (int dim = 0; dim < 3; ++dim)
+  {
+    const auto x = centroidBounds.min()[dim];
+    const auto e = centroidBounds.max()[dim] - x;
 
-  stack.push(_root);
-  while (!stack.empty())
+    if (!(e > 0))
+      continue;
+
+    const auto s = objectBins / e;
+    struct
+    {
+      uint32_t count{};
+      Bounds3f bounds;
+
+    } bins[objectBins];
+
+    for (const auto& r : refs)
+    {
+      auto& bin = bins[binIndex(s, r.centroid[dim] - x, objectBins)];
+
+      bin.count++;
+      bin.bounds.inflate(r.bounds);
+    }
+
+    Bounds3f rightBounds[objectBins];
+    uint32_t rightCounts[objectBins];
+    {
+      Bounds3f b;
+      uint32_t c{};
+
+      for (int i = objectBins - 1; i > 0; --i)
+      {
+        b.inflate(bins[i].bounds);
+        c += bins[i].count;
+        rightBounds[i] = b;
+        rightCounts[i] = c;
+      }
+    }
+
+    Bounds3f b;
+    uint32_t c{};
+
+    for (int i = 0; i < objectBins - 1; ++i)
+    {
+      b.inflate(bins[i].bounds);
+      c += bins[i].count;
+
+      auto rc = rightCounts[i + 1];
+
+      if (c == 0 || rc == 0)
+        continue;
+
+      auto sah = cost(b, c) + cost(rightBounds[i + 1], rc);
+
+      if (sah < split.cost)
+        split = {sah, dim, i, b, rightBounds[i + 1]};
+    }
+  }
+  return split;
+}
+
+auto
+BVHBase::findSpatialSplit(const PrimitiveInfoArray& refs,
+  const Bounds3f& bounds) const -> Split
+{
+  Split split;
+
+  for (int dim = 0; dim < 3; ++dim)
   {
-    auto node = stack.top();
+    const auto x = bounds.min()[dim];
+    const auto e = bounds.max()[dim] - x;
 
-    stack.pop();
-    if (node->intersect(r))
-      if (node->isLeaf())
-        intersectLeaf(node->_first, node->_count, ray, hit);
-      else
+    if (!(e > 0))
+      continue;
+
+    const auto s = spatialBins / e;
+    const auto w = e / spatialBins;
+    struct
+    {
+      uint32_t entries{};
+      uint32_t exits{};
+      Bounds3f bounds;
+
+    } bins[spatialBins];
+
+    // Chop each reference into the bins it overlaps.
+    for (const auto& r : refs)
+    {
+      auto b0 = binIndex(s, r.bounds.min()[dim] - x, spatialBins);
+      auto b1 = binIndex(s, r.bounds.max()[dim] - x, spatialBins);
+      auto rb = r.bounds;
+
+      for (auto i = b0; i < b1; ++i)
+      {
+        Bounds3f lb;
+        const auto cb = rb;
+
+        splitReference(r.index, dim, x + w * (i + 1), cb, lb, rb);
+        bins[i].bounds.inflate(lb);
+      }
+      bins[b1].bounds.inflate(rb);
+      bins[b0].entries++;
+      bins[b1].exits++;
+    }
+
+    Bounds3f rightBounds[spatialBins];
+    uint32_t rightCounts[spatialBins];
+    {
+      Bounds3f b;
+      uint32_t c{};
+
+      for (int i = spatialBins - 1; i > 0; --i)
       {
-        stack.push(node->_children[0]);
-        stack.push(node->_children[1]);
+        b.inflate(bins[i].bounds);
+        c += bins[i].exits;
+        rightBounds[i] = b;
+        rightCounts[i] = c;
       }
+    }
+
+    Bounds3f b;
+    uint32_t c{};
+
+    for (int i = 0; i < spatialBins - 1; ++i)
+    {
+      b.inflate(bins[i].bounds);
+      c += bins[i].entries;
+
+      auto rc = rightCounts[i + 1];
+
+      if (c == 0 || rc == 0)
+        continue;
+
+      auto sah = cost(b, c) + cost(rightBounds[i + 1], rc);
+
+      if (sah < split.cost)
+        split = {sah, dim, i, b, rightBounds[i + 1]};
+    }
   }
-  return hit.object != nullptr;
+  return split;
 }
 
-Bounds3f
-BVHBase::bounds() const
+void
+BVHBase::splitObjects(const PrimitiveInfoArray& refs,
+  const Bounds3f& centroidBounds,
+  const Split& split,
+  PrimitiveInfoArray& left,
+  PrimitiveInfoArray& right) const
+{
+  const auto dim = split.dim;
+  const auto x = centroidBounds.min()[dim];
+  const auto s = objectBins / (centroidBounds.max()[dim] - x);
+
+  for (const auto& r : refs)
+    if (binIndex(s, r.centroid[dim] - x, objectBins) <= split.bin)
+      left.push_back(r);
+    else
+      right.push_back(r);
+}
+
+/**
+ * @brief Partitions \p refs by the plane of the spatial split
+ * \p split.
+ *
+ * A reference straddling the plane is split in two, unless moving
+ * it entirely to one of the sides is cheaper ("unsplitting") or
+ * the duplication budget was exhausted.
+ */
+void
+BVHBase::splitReferences(const PrimitiveInfoArray& refs,
+  const Bounds3f& bounds,
+  const Split& split,
+  PrimitiveInfoArray& left,
+  PrimitiveInfoArray& right)
+{
+  const auto dim = split.dim;
+  const auto x = bounds.min()[dim];
+  const auto position = x + (bounds.max()[dim] - x) *
+    (split.bin + 1) / spatialBins;
+  Bounds3f lb;
+  Bounds3f rb;
+  PrimitiveInfoArray straddling;
+
+  for (const auto& r : refs)
+    if (r.bounds.max()[dim] <= position)
+    {
+      left.push_back(r);
+      lb.inflate(r.bounds);
+    }
+    else if (r.bounds.min()[dim] >= position)
+    {
+      right.push_back(r);
+      rb.inflate(r.bounds);
+    }
+    else
+      straddling.push_back(r);
+  for (const auto& r : straddling)
+  {
+    auto nl = left.size();
+    auto nr = right.size();
+    auto c1 = cost(lb + r.bounds, nl + 1) + cost(rb, nr);
+    auto c2 = cost(lb, nl) + cost(rb + r.bounds, nr + 1);
+    Bounds3f b1;
+    Bounds3f b2;
+
+    splitReference(r.index, dim, position, r.bounds, b1, b2);
+
+    auto c = math::Limits<float>::inf();
+
+    if (_references < _maxReferences &&
+      !isEmpty(b1) && !isEmpty(b2))
+      c = cost(lb + b1, nl + 1) + cost(rb + b2, nr + 1);
+    if (c < c1 && c < c2)
+    {
+      left.emplace_back(r.index, b1);
+      right.emplace_back(r.index, b2);
+      lb.inflate(b1);
+      rb.inflate(b2);
+      _references++;
+    }
+    else if (c1 <= c2)
+    {
+      left.push_back(r);
+      lb.inflate(r.bounds);
+    }
+    else
+    {
+      right.push_back(r);
+      rb.inflate(r.bounds);
+    }
+  }
+}
+
+namespace
+{ // begin namespace
+
+//
+// Stack used by the traversal of wide BVHs. Entries are stored
+// in a local buffer unless the capacity required by the tree
+// exceeds its size.
+//
+template <typename T, size_t bufferSize = 128>
+class TraversalStack
+{
+public:
+  explicit TraversalStack(size_t capacity)
+  {
+    if (capacity > bufferSize)
+    {
+      _heap = std::make_unique<T[]>(capacity);
+      _data = _heap.get();
+    }
+  }
+
+  void push(const T& e)
+  {
+    _data[_size++] = e;
+  }
+
+  auto& pop()
+  {
+    return _data[--_size];
+  }
+
+  bool empty() const
+  {
+    return _size == 0;
+  }
+
+private:
+  T _buffer[bufferSize];
+  std::unique_ptr<T[]> _heap;
+  T* _data{_buffer};
+  size_t _size{};
+
+}; // TraversalStack
+
+struct WideStackEntry
+{
+  int32_t child;
+  float tNear;
+
+}; // WideStackEntry
+
+//
+// Ray data used by the slab test of wide nodes.
+//
+struct WideRay
+{
+  float o[3];
+  float invDir[3];
+  bool isNegDir[3];
+  float tMin;
+
+  explicit WideRay(const Ray3f& r):
+    tMin{r.tMin}
+  {
+    const auto d = r.direction.inverse();
+
+    for (int i = 0; i < 3; ++i)
+    {
+      o[i] = r.origin[i];
+      invDir[i] = d[i];
+      isNegDir[i] = r.direction[i] < 0;
+    }
+  }
+
+}; // WideRay
+
+//
+// Scalar slab test of N boxes.
+//
+template <int N>
+inline int
+slabTest(const float* nx,
+  const float* ny,
+  const float* nz,
+  const float* fx,
+  const float* fy,
+  const float* fz,
+  const WideRay& r,
+  float tMax,
+  float* tNear)
+{
+  auto mask = 0;
+
+  for (int i = 0; i < N; ++i)
+  {
+    auto t0 = (nx[i] - r.o[0]) * r.invDir[0];
+    auto t1 = (fx[i] - r.o[0]) * r.invDir[0];
+    auto a0 = (ny[i] - r.o[1]) * r.invDir[1];
+    auto a1 = (fy[i] - r.o[1]) * r.invDir[1];
+
+    t0 = math::max(t0, a0);
+    t1 = math::min(t1, a1);
+    a0 = (nz[i] - r.o[2]) * r.invDir[2];
+    a1 = (fz[i] - r.o[2]) * r.invDir[2];
+    t0 = math::max(math::max(t0, a0), r.tMin);
+    t1 = math::min(math::min(t1, a1), tMax);
+    tNear[i] = t0;
+    mask |= int(t0 <= t1) << i;
+  }
+  return mask;
+}
+
+#ifdef BVH_USE_SSE
+template <>
+inline int
+slabTest<4>(const float* nx,
+  const float* ny,
+  const float* nz,
+  const float* fx,
+  const float* fy,
+  const float* fz,
+  const WideRay& r,
+  float tMax,
+  float* tNear)
+{
+  const auto ox = _mm_set1_ps(r.o[0]);
+  const auto oy = _mm_set1_ps(r.o[1]);
+  const auto oz = _mm_set1_ps(r.o[2]);
+  const auto ix = _mm_set1_ps(r.invDir[0]);
+  const auto iy = _mm_set1_ps(r.invDir[1]);
+  const auto iz = _mm_set1_ps(r.invDir[2]);
+  auto t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(nx), ox), ix);
+  auto t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(fx), ox), ix);
+  auto a0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(ny), oy), iy);
+  auto a1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(fy), oy), iy);
+
+  t0 = _mm_max_ps(t0, a0);
+  t1 = _mm_min_ps(t1, a1);
+  a0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(nz), oz), iz);
+  a1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(fz), oz), iz);
+  t0 = _mm_max_ps(_mm_max_ps(t0, a0), _mm_set1_ps(r.tMin));
+  t1 = _mm_min_ps(_mm_min_ps(t1, a1), _mm_set1_ps(tMax));
+  _mm_storeu_ps(tNear, t0);
+  return _mm_movemask_ps(_mm_cmple_ps(t0, t1));
+}
+
+template <>
+inline int
+slabTest<8>(const float* nx,
+  const float* ny,
+  const float* nz,
+  const float* fx,
+  const float* fy,
+  const float* fz,
+  const WideRay& r,
+  float tMax,
+  float* tNear)
+{
+#ifdef __AVX__
+  const auto ox = _mm256_set1_ps(r.o[0]);
+  const auto oy = _mm256_set1_ps(r.o[1]);
+  const auto oz = _mm256_set1_ps(r.o[2]);
+  const auto ix = _mm256_set1_ps(r.invDir[0]);
+  const auto iy = _mm256_set1_ps(r.invDir[1]);
+  const auto iz = _mm256_set1_ps(r.invDir[2]);
+  auto t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(nx), ox), ix);
+  auto t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(fx), ox), ix);
+  auto a0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(ny), oy), iy);
+  auto a1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(fy), oy), iy);
+
+  t0 = _mm256_max_ps(t0, a0);
+  t1 = _mm256_min_ps(t1, a1);
+  a0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(nz), oz), iz);
+  a1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(fz), oz), iz);
+  t0 = _mm256_max_ps(_mm256_max_ps(t0, a0), _mm256_set1_ps(r.tMin));
+  t1 = _mm256_min_ps(_mm256_min_ps(t1, a1), _mm256_set1_ps(tMax));
+  _mm256_storeu_ps(tNear, t0);
+  return _mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ));
+#else
+  // Without AVX, test the two halves of the node with SSE.
+  auto lo = slabTest<4>(nx, ny, nz, fx, fy, fz, r, tMax, tNear);
+  auto hi = slabTest<4>(nx + 4,
+    ny + 4,
+    nz + 4,
+    fx + 4,
+    fy + 4,
+    fz + 4,
+    r,
+    tMax,
+    tNear + 4);
+
+  return lo | hi << 4;
+#endif // __AVX__
+}
+#endif // BVH_USE_SSE
+
+//
+// Tests the children of a wide node against a ray. Returns the
+// number of children hit, whose entries are pushed onto the stack
+// from the farthest to the nearest.
+//
+template <int N, typename Node, typename Stack>
+inline int
+pushChildren(const Node& node,
+  const WideRay& r,
+  float tMax,
+  Stack& stack)
+{
+  const auto nx = r.isNegDir[0] ? node.maxX : node.minX;
+  const auto fx = r.isNegDir[0] ? node.minX : node.maxX;
+  const auto ny = r.isNegDir[1] ? node.maxY : node.minY;
+  const auto fy = r.isNegDir[1] ? node.minY : node.maxY;
+  const auto nz = r.isNegDir[2] ? node.maxZ : node.minZ;
+  const auto fz = r.isNegDir[2] ? node.minZ : node.maxZ;
+  alignas(32) float tNear[N];
+  auto mask = slabTest<N>(nx, ny, nz, fx, fy, fz, r, tMax, tNear);
+  WideStackEntry hits[N];
+  int n = 0;
+
+  for (; mask != 0; mask &= mask - 1)
+  {
+    int i = std::countr_zero((unsigned)mask);
+    WideStackEntry e{node.children[i], tNear[i]};
+    int j = n++;
+
+    // Keep the hit children sorted in decreasing order of distance.
+    for (; j > 0 && hits[j - 1].tNear < e.tNear; --j)
+      hits[j] = hits[j - 1];
+    hits[j] = e;
+  }
+  for (int i = 0; i < n; ++i)
+    stack.push(hits[i]);
+  return n;
+}
+
+struct QuantizedStackEntry
 {
-  return _root == nullptr ? Bounds3f{} : _root->_bounds;
+  uint32_t index;
+  float tNear;
+  vec3f p1;
+  vec3f p2;
+
+};
+
+inline bool
+intersectBounds(const vec3f& p1,
+  const vec3f& p2,
+  const WideRay& r,
+  float tMax,
+  float& tNear)
+{
+  float n[3];
+  float f[3];
+
+  for (int k = 0; k < 3; ++k)
+  {
+    n[k] = r.isNegDir[k] ? p2[k] : p1[k];
+    f[k] = r.isNegDir[k] ? p1[k] : p2[k];
+  }
+  return slabTest<1>(n, n + 1, n + 2, f, f + 1, f + 2, r, tMax, &tNear);
+}
+
+//
+// Decodes the bounds of the children of an interior node of a
+// quantized BVH and tests them against a ray. The entries of the
+// children hit are pushed onto the stack from the farthest to the
+// nearest.
+//
+template <typename Node, typename Stack>
+inline void
+pushQuantizedChildren(const Node* nodes,
+  const QuantizedStackEntry& e,
+  const WideRay& r,
+  float tMax,
+  Stack& stack)
+{
+  uint32_t children[2]{e.index + 1, e.index + nodes[e.index].offset};
+  vec3f p1[2];
+  vec3f p2[2];
+  float n[3][2];
+  float f[3][2];
+
+  for (int i = 0; i < 2; ++i)
+  {
+    nodes[children[i]].decode(e.p1, e.p2, p1[i], p2[i]);
+    for (int k = 0; k < 3; ++k)
+    {
+      n[k][i] = r.isNegDir[k] ? p2[i][k] : p1[i][k];
+      f[k][i] = r.isNegDir[k] ? p1[i][k] : p2[i][k];
+    }
+  }
+
+  float tNear[2];
+  auto mask = slabTest<2>(n[0], n[1], n[2], f[0], f[1], f[2], r, tMax, tNear);
+
+  if (mask == 3)
+  {
+    int i = tNear[1] < tNear[0];
+    int j = 1 - i;
+
+    stack.push({children[j], tNear[j], p1[j], p2[j]});
+    stack.push({children[i], tNear[i], p1[i], p2[i]});
+  }
+  else if (mask != 0)
+  {
+    int i = mask >> 1;
+
+    stack.push({children[i], tNear[i], p1[i], p2[i]});
+  }
+}
+
+//
+// Returns the lattice coordinates of the bounds [c1, c2] in the
+// bounds [p1, p2] of the parent, rounded outwards.
+//
+template <typename Node>
+void
+quantize(float p1, float p2, float c1, float c2, int& q1, int& q2)
+{
+  constexpr auto maxQ = Node::maxQ;
+  auto s = Node::scale(p1, p2);
+
+  q1 = 0;
+  q2 = int(maxQ);
+  if (!(s > 0))
+    return;
+  q1 = int(std::clamp(std::floor((c1 - p1) / s), 0.f, maxQ));
+  q2 = int(std::clamp(std::ceil(maxQ - (p2 - c2) / s), 0.f, maxQ));
+  // Correct the rounding errors of the divisions above.
+  while (q1 > 0 && Node::decodeMin(p1, s, q1) > c1)
+    --q1;
+  while (q2 < int(maxQ) && Node::decodeMax(p2, s, q2) < c2)
+    ++q2;
+}
+
+} // end namespace
+
+/**
+ * @brief Makes the nodes of the layout of this BVH from its binary
+ * nodes.
+ */
+void
+BVHBase::makeLayout()
+{
+  if (_layout == NodeLayout::Wide4 || _layout == NodeLayout::Wide8)
+    collapse();
+  else if (_layout == NodeLayout::Quantized8)
+    quantize(_quantized8);
+  else if (_layout == NodeLayout::Quantized16)
+    quantize(_quantized16);
+}
+
+/**
+ * @brief Invokes \p f(first, count) for every leaf of this BVH, in
+ * increasing order of first.
+ *
+ * Unlike iterate(), it works with any node layout.
+ */
+void
+BVHBase::iterateLeaves(const LeafFunction& f) const
+{
+  if (_layout == NodeLayout::Quantized8)
+  {
+    for (const auto& node : _quantized8)
+      if (node.isLeaf())
+        f(node.offset, node.count);
+  }
+  else if (_layout == NodeLayout::Quantized16)
+  {
+    for (const auto& node : _quantized16)
+      if (node.isLeaf())
+        f(node.offset, node.count);
+  }
+  else
+    for (uint32_t i = 0; i < _nodeCount; ++i)
+      if (_root[i].isLeaf())
+        f(_root[i]._offset, _root[i]._count);
+}
+
+void
+BVHBase::collapse()
+{
+  _wideLeaves.clear();
+  _wideDepth = 0;
+  if (_root == nullptr)
+    return;
+  if (_layout == NodeLayout::Wide4)
+  {
+    _wide4.clear();
+    collapse(_wide4, root(), 1);
+  }
+  else
+  {
+    _wide8.clear();
+    collapse(_wide8, root(), 1);
+  }
+}
+
+/**
+ * @brief Collapses the subtree of the binary BVH rooted at
+ * \p node into a wide node.
+ *
+ * The children of the wide node are chosen by repeatedly opening
+ * the interior child with the largest surface area until there are
+ * N children or all of them are leaves.
+ */
+template <int N>
+int32_t
+BVHBase::collapse(std::vector<WideNode<N>>& nodes,
+  const NodeView& node,
+  uint32_t depth)
+{
+  NodeView children[N];
+  int n = 0;
+
+  if (node.isLeaf())
+    children[n++] = node;
+  else
+  {
+    children[n++] = node.child(0);
+    children[n++] = node.child(1);
+    while (n < N)
+    {
+      auto best = -1;
+      auto maxArea = -1.f;
+
+      for (int i = 0; i < n; ++i)
+        if (!children[i].isLeaf())
+          if (auto a = children[i].bounds().area(); a > maxArea)
+          {
+            maxArea = a;
+            best = i;
+          }
+      if (best < 0)
+        break;
+
+      auto c = children[best];
+
+      children[best] = c.child(0);
+      children[n++] = c.child(1);
+    }
+  }
+  if (depth > _wideDepth)
+    _wideDepth = depth;
+
+  auto index = (int32_t)nodes.size();
+
+  nodes.emplace_back();
+  for (int i = 0; i < n; ++i)
+  {
+    const auto& c = children[i];
+    int32_t child;
+
+    if (c.isLeaf())
+    {
+      child = ~(int32_t)_wideLeaves.size();
+      _wideLeaves.push_back({c.first(), c.count()});
+    }
+    else
+      child = collapse(nodes, c, depth + 1);
+    // Note that nodes may have been reallocated by the recursion.
+    nodes[index].set(i, c.bounds(), child);
+  }
+  return index;
+}
+
+template <int N>
+bool
+BVHBase::intersectWide(const std::vector<WideNode<N>>& nodes,
+  const Ray3f& ray) const
+{
+  WideRay r{ray};
+  TraversalStack<WideStackEntry> stack{_wideDepth * (N - 1) + 1};
+
+  pushChildren<N>(nodes[0], r, ray.tMax, stack);
+  while (!stack.empty())
+  {
+    auto child = stack.pop().child;
+
+    if (child >= 0)
+      pushChildren<N>(nodes[child], r, ray.tMax, stack);
+    else
+    {
+      const auto& leaf = _wideLeaves[~child];
+
+      if (intersectLeaf(leaf.first, leaf.count, ray))
+        return true;
+    }
+  }
+  return false;
+}
+
+template <int N>
+bool
+BVHBase::intersectWide(const std::vector<WideNode<N>>& nodes,
+  const Ray3f& ray,
+  Intersection& hit) const
+{
+  WideRay r{ray};
+  TraversalStack<WideStackEntry> stack{_wideDepth * (N - 1) + 1};
+
+  pushChildren<N>(nodes[0], r, hit.distance, stack);
+  while (!stack.empty())
+  {
+    auto e = stack.pop();
+
+    // Skip the subtrees farther than the closest hit found so far.
+    if (e.tNear > hit.distance)
+      continue;
+    if (e.child >= 0)
+      pushChildren<N>(nodes[e.child], r, hit.distance, stack);
+    else
+    {
+      const auto& leaf = _wideLeaves[~e.child];
+
+      intersectLeaf(leaf.first, leaf.count, ray, hit);
+    }
+  }
+  return hit.object != nullptr;
+}
+
+/**
+ * @brief Replaces the binary nodes of this BVH by quantized nodes.
+ */
+template <typename Q>
+void
+BVHBase::quantize(std::vector<QuantizedNode<Q>>& nodes)
+{
+  _quantizedDepth = 0;
+  if (_root == nullptr)
+    return;
+  nodes.resize(_nodeCount);
+  nodes.shrink_to_fit();
+  quantize(nodes, _root, _bounds.min(), _bounds.max(), 1);
+  std::vector<Node>{}.swap(_nodes);
+  _root = nullptr;
+  _decodedNodes.clear();
+}
+
+template <typename Q>
+void
+BVHBase::quantize(std::vector<QuantizedNode<Q>>& nodes,
+  const Node* node,
+  const vec3f& p1,
+  const vec3f& p2,
+  uint32_t depth)
+{
+  auto& q = nodes[node - _root];
+  const auto& c1 = node->_bounds.min();
+  const auto& c2 = node->_bounds.max();
+
+  for (int i = 0; i < 3; ++i)
+  {
+    int q1;
+    int q2;
+
+    ::cg::quantize<QuantizedNode<Q>>(p1[i], p2[i], c1[i], c2[i], q1, q2);
+    q.min[i] = Q(q1);
+    q.max[i] = Q(q2);
+  }
+  q.offset = node->_offset;
+  q.count = node->_count;
+  if (depth > _quantizedDepth)
+    _quantizedDepth = depth;
+  if (node->isLeaf())
+    return;
+
+  // The children are quantized in the decoded bounds of the node,
+  // which are the bounds used by the traversal.
+  vec3f q1;
+  vec3f q2;
+
+  q.decode(p1, p2, q1, q2);
+  quantize(nodes, node->child(0), q1, q2, depth + 1);
+  quantize(nodes, node->child(1), q1, q2, depth + 1);
+}
+
+/**
+ * @brief Decodes the bounds of the quantized nodes \p nodes into
+ * binary nodes.
+ *
+ * The bounds of a node are decoded from the decoded bounds of its
+ * parent, as in the traversal.
+ */
+template <typename Q>
+void
+BVHBase::decode(const std::vector<QuantizedNode<Q>>& nodes) const
+{
+  struct Entry
+  {
+    uint32_t index;
+    vec3f p1;
+    vec3f p2;
+
+  }; // Entry
+
+  std::vector<Entry> stack{{0, _bounds.min(), _bounds.max()}};
+
+  _decodedNodes.resize(nodes.size());
+  while (!stack.empty())
+  {
+    auto e = stack.back();
+    const auto& q = nodes[e.index];
+    vec3f q1;
+    vec3f q2;
+
+    stack.pop_back();
+    q.decode(e.p1, e.p2, q1, q2);
+    _decodedNodes[e.index] = Node{Bounds3f{q1, q2}, q.offset, q.count};
+    if (!q.isLeaf())
+    {
+      stack.push_back({e.index + q.offset, q1, q2});
+      stack.push_back({e.index + 1, q1, q2});
+    }
+  }
+}
+
+/**
+ * @brief Returns the binary nodes of this BVH.
+ *
+ * The nodes of a quantized BVH are decoded the first time they are
+ * requested.
+ */
+auto
+BVHBase::nodes() const -> const Node*
+{
+  if (_root != nullptr || _nodeCount == 0)
+    return _root;
+
+  std::lock_guard lock{_decodeLock};
+
+  if (_decodedNodes.empty())
+  {
+    if (_layout == NodeLayout::Quantized8)
+      decode(_quantized8);
+    else
+      decode(_quantized16);
+  }
+  return _decodedNodes.data();
+}
+
+template <typename Q>
+bool
+BVHBase::intersectQuantized(const std::vector<QuantizedNode<Q>>& nodes,
+  const Ray3f& ray) const
+{
+  WideRay r{ray};
+  TraversalStack<QuantizedStackEntry> stack{_quantizedDepth + 1};
+  const auto& p1 = _bounds.min();
+  const auto& p2 = _bounds.max();
+
+  float tNear;
+
+  // The decoded bounds of the root are the bounds of the BVH.
+  if (!intersectBounds(p1, p2, r, ray.tMax, tNear))
+    return false;
+  stack.push({0, tNear, p1, p2});
+  while (!stack.empty())
+  {
+    auto e = stack.pop();
+    const auto& node = nodes[e.index];
+
+    if (!node.isLeaf())
+      pushQuantizedChildren(nodes.data(), e, r, ray.tMax, stack);
+    else if (intersectLeaf(node.offset, node.count, ray))
+      return true;
+  }
+  return false;
+}
+
+template <typename Q>
+bool
+BVHBase::intersectQuantized(const std::vector<QuantizedNode<Q>>& nodes,
+  const Ray3f& ray,
+  Intersection& hit) const
+{
+  WideRay r{ray};
+  TraversalStack<QuantizedStackEntry> stack{_quantizedDepth + 1};
+  const auto& p1 = _bounds.min();
+  const auto& p2 = _bounds.max();
+  float tNear;
+
+  if (!intersectBounds(p1, p2, r, hit.distance, tNear))
+    return false;
+  stack.push({0, tNear, p1, p2});
+  while (!stack.empty())
+  {
+    auto e = stack.pop();
+
+    // Skip the subtrees farther than the closest hit found so far.
+    if (e.tNear > hit.distance)
+      continue;
+
+    const auto& node = nodes[e.index];
+
+    if (!node.isLeaf())
+      pushQuantizedChildren(nodes.data(), e, r, hit.distance, stack);
+    else
+      intersectLeaf(node.offset, node.count, ray, hit);
+  }
+  return hit.object != nullptr;
+}
+
+BVHBase::~BVHBase()
+{
+  // do nothing
+}
+
+bool
+BVHBase::intersect(const Ray3f& ray) const
+{
+  if (_nodeCount == 0)
+    return false;
+  if (_layout == NodeLayout::Wide4)
+    return intersectWide(_wide4, ray);
+  if (_layout == NodeLayout::Wide8)
+    return intersectWide(_wide8, ray);
+  if (_layout == NodeLayout::Quantized8)
+    return intersectQuantized(_quantized8, ray);
+  if (_layout == NodeLayout::Quantized16)
+    return intersectQuantized(_quantized16, ray);
+
+  NodeRay r{ray};
+  std::stack<const Node*> stack;
+
+  stack.push(_root);
+  while (!stack.empty())
+  {
+    auto node = stack.top();
+
+    stack.pop();
+    if (node->intersect(r))
+      if (!node->isLeaf())
+      {
+        stack.push(node->child(0));
+        stack.push(node->child(1));
+      }
+      else if (intersectLeaf(node->_offset, node->_count, ray))
+        return true;
+  }
+  return false;
+}
+
+bool
+BVHBase::intersect(const Ray3f& ray, Intersection& hit) const
+{
+  hit.object = nullptr;
+  hit.distance = ray.tMax;
+  if (_nodeCount == 0)
+    return false;
+  if (_layout == NodeLayout::Wide4)
+    return intersectWide(_wide4, ray, hit);
+  if (_layout == NodeLayout::Wide8)
+    return intersectWide(_wide8, ray, hit);
+  if (_layout == NodeLayout::Quantized8)
+    return intersectQuantized(_quantized8, ray, hit);
+  if (_layout == NodeLayout::Quantized16)
+    return intersectQuantized(_quantized16, ray, hit);
+
+  NodeRay r{ray};
+  std::stack<const Node*> stack;
+
+  stack.push(_root);
+  while (!stack.empty())
+  {
+    auto node = stack.top();
+
+    stack.pop();
+    if (node->intersect(r))
+      if (node->isLeaf())
+        intersectLeaf(node->_offset, node->_count, ray, hit);
+      else
+      {
+        stack.push(node->child(0));
+        stack.push(node->child(1));
+      }
+  }
+  return hit.object != nullptr;
+}
+
+/**
+ * @brief Intersects every ray in \p rays with this BVH and sets
+ * the corresponding element of \p occluded to true if the ray
+ * intersects any primitive.
+ *
+ * See intersect(std::span<const Ray3f>, std::span<Intersection>,
+ * bool).
+ */
+void
+BVHBase::intersect(std::span<const Ray3f> rays,
+  std::span<bool> occluded,
+  bool sort) const
+{
+  assert(occluded.size() >= rays.size());
+  intersectBatch(rays, nullptr, occluded.data(), sort);
+}
+
+/**
+ * @brief Computes the closest intersection of every ray in \p rays
+ * with this BVH.
+ *
+ * The rays are traced in parallel in packets of consecutive rays.
+ * The rays of a packet traverse the binary nodes together, and
+ * intersectLeaf(uint32_t, uint32_t, const RayPacket&) is invoked
+ * once for all the rays of the packet that reach a leaf. If
+ * \p sort is true, the rays are grouped by direction octant and by
+ * the Morton codes of their origins and directions before making
+ * packets, which improves the coherence of random rays. In a wide
+ * BVH, every ray traverses the wide nodes by itself.
+ */
+void
+BVHBase::intersect(std::span<const Ray3f> rays,
+  std::span<Intersection> hits,
+  bool sort) const
+{
+  assert(hits.size() >= rays.size());
+  intersectBatch(rays, hits.data(), nullptr, sort);
+}
+
+namespace
+{ // begin namespace
+
+constexpr uint32_t packetSize{64};
+constexpr size_t batchGrainSize{16 * packetSize};
+constexpr size_t closestPointGrainSize{256};
+
+inline uint64_t
+spreadBits(uint32_t x)
+{
+  uint64_t b = x & 0x3ff;
+
+  b = (b | b << 16) & 0x30000ff;
+  b = (b | b << 8) & 0x300f00f;
+  b = (b | b << 4) & 0x30c30c3;
+  b = (b | b << 2) & 0x9249249;
+  return b;
+}
+
+inline uint64_t
+morton(const vec3f& p, float scale)
+{
+  const auto q = [scale](float x)
+    {
+      return uint32_t(std::clamp(x, 0.f, 1.f) * scale);
+    };
+
+  return spreadBits(q(p.x)) | spreadBits(q(p.y)) << 1 |
+    spreadBits(q(p.z)) << 2;
+}
+
+//
+// Returns the sort key of a ray: the octant of its direction in
+// the highest bits, followed by the 30-bit Morton code of its
+// origin in the bounds of the BVH and the 18-bit Morton code of
+// its direction.
+//
+uint64_t
+rayKey(const Ray3f& ray, const Bounds3f& bounds)
+{
+  const auto& d = ray.direction;
+  uint64_t octant = (d.x < 0) | (d.y < 0) << 1 | (d.z < 0) << 2;
+  auto o = ray.origin - bounds.min();
+  auto s = bounds.size();
+
+  for (int i = 0; i < 3; ++i)
+    o[i] = s[i] > 0 ? o[i] / s[i] : 0;
+
+  auto u = d * (0.5f / math::max(d.length(), 1e-20f)) + vec3f{0.5f};
+
+  return octant << 48 | morton(o, 1023) << 18 | morton(u, 63);
+}
+
+} // end namespace
+
+void
+BVHBase::intersectBatch(std::span<const Ray3f> rays,
+  Intersection* hits,
+  bool* occluded,
+  bool sort) const
+{
+  auto n = (uint32_t)rays.size();
+
+  for (uint32_t i = 0; i < n; ++i)
+    if (hits == nullptr)
+      occluded[i] = false;
+    else
+    {
+      hits[i].object = nullptr;
+      hits[i].distance = rays[i].tMax;
+    }
+  if (_nodeCount == 0 || n == 0)
+    return;
+  if (_layout != NodeLayout::Binary)
+  {
+    parallelFor(n, batchGrainSize, [&, this](size_t begin, size_t end)
+      {
+        for (auto i = begin; i < end; ++i)
+          if (hits == nullptr)
+            occluded[i] = intersect(rays[i]);
+          else
+            intersect(rays[i], hits[i]);
+      });
+    return;
+  }
+
+  std::vector<uint32_t> order(n);
+
+  for (uint32_t i = 0; i < n; ++i)
+    order[i] = i;
+  if (sort)
+  {
+    std::vector<uint64_t> keys(n);
+    auto bounds = _bounds;
+
+    parallelFor(n, batchGrainSize, [&](size_t begin, size_t end)
+      {
+        for (auto i = begin; i < end; ++i)
+          keys[i] = rayKey(rays[i], bounds);
+      });
+    std::sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b)
+      {
+        return keys[a] < keys[b];
+      });
+  }
+  parallelFor(n, batchGrainSize, [&, this](size_t begin, size_t end)
+    {
+      for (auto i = begin; i < end; i += packetSize)
+      {
+        auto size = (uint32_t)std::min<size_t>(packetSize, end - i);
+
+        intersectStream(rays.data(), hits, occluded, &order[i], size);
+      }
+    });
+}
+
+/**
+ * @brief Traces the packet of rays \p rays[\p ids[i]], i in [0,
+ * \p n), through the binary nodes of this BVH.
+ *
+ * Each entry of the traversal stack holds a node and the range of
+ * the rays of the packet that hit the bounds of its parent. The
+ * rays hitting the bounds of the node are appended to the lane
+ * array, whose tail is discarded when the subtree of the node was
+ * traversed.
+ */
+void
+BVHBase::intersectStream(const Ray3f* rays,
+  Intersection* hits,
+  bool* occluded,
+  const uint32_t* ids,
+  uint32_t n) const
+{
+  struct Entry
+  {
+    const Node* node;
+    uint32_t begin;
+    uint32_t count;
+
+  };
+
+  thread_local std::vector<NodeRay> nodeRays;
+  thread_local std::vector<Entry> stack;
+  thread_local std::vector<uint32_t> lanes;
+  thread_local std::vector<uint32_t> indices;
+
+  nodeRays.clear();
+  lanes.clear();
+  for (uint32_t i = 0; i < n; ++i)
+  {
+    nodeRays.emplace_back(rays[ids[i]]);
+    lanes.push_back(i);
+  }
+  stack.push_back({_root, 0, n});
+  while (!stack.empty())
+  {
+    auto [node, begin, count] = stack.back();
+
+    stack.pop_back();
+    lanes.resize(begin + count);
+
+    auto first = begin + count;
+
+    for (auto i = begin; i < first; ++i)
+    {
+      auto lane = lanes[i];
+
+      if (occluded != nullptr && occluded[ids[lane]])
+        continue;
+      if (node->intersect(nodeRays[lane]))
+        lanes.push_back(lane);
+    }
+
+    auto size = (uint32_t)lanes.size() - first;
+
+    if (size == 0)
+      continue;
+    if (node->isLeaf())
+    {
+      indices.clear();
+      for (auto i = first; i < first + size; ++i)
+        indices.push_back(ids[lanes[i]]);
+      intersectLeaf(node->_offset,
+        node->_count,
+        RayPacket{rays, hits, occluded, indices.data(), size});
+      // Shorten the rays of a closest-hit query to the closest
+      // intersections found so far.
+      if (hits != nullptr)
+        for (auto i = first; i < first + size; ++i)
+        {
+          auto lane = lanes[i];
+
+          nodeRays[lane].tMax = hits[ids[lane]].distance;
+        }
+      continue;
+    }
+
+    // Visit first the child nearest to the origin of the first ray.
+    auto c0 = node->child(0);
+    auto c1 = node->child(1);
+    auto d = c1->_bounds.center() - c0->_bounds.center();
+
+    if (d.dot(nodeRays[lanes[first]].direction) < 0)
+      std::swap(c0, c1);
+    stack.push_back({c1, first, size});
+    stack.push_back({c0, first, size});
+  }
+}
+
+/**
+ * @brief Intersects the rays of \p packet with the primitives of
+ * the leaf [\p first, \p first + \p count).
+ *
+ * The default implementation invokes the single ray variants of
+ * intersectLeaf() for each ray of the packet. Derived classes can
+ * override it in order to amortize the cost of fetching the
+ * primitives over the rays.
+ */
+void
+BVHBase::intersectLeaf(uint32_t first,
+  uint32_t count,
+  const RayPacket& packet) const
+{
+  for (uint32_t i = 0; i < packet.size; ++i)
+  {
+    auto r = packet.indices[i];
+
+    if (!packet.isOcclusion())
+      intersectLeaf(first, count, packet.rays[r], packet.hits[r]);
+    else if (intersectLeaf(first, count, packet.rays[r]))
+      packet.occluded[r] = true;
+  }
+}
+
+namespace
+{ // begin namespace
+
+//
+// Returns the squared distance from p to the bounds [p1, p2], or
+// zero if p is inside the bounds.
+//
+inline float
+squaredDistance(const vec3f& p, const vec3f& p1, const vec3f& p2)
+{
+  auto d2 = 0.f;
+
+  for (int i = 0; i < 3; ++i)
+  {
+    auto d = math::max(p1[i] - p[i], 0.f) + math::max(p[i] - p2[i], 0.f);
+
+    d2 += d * d;
+  }
+  return d2;
+}
+
+//
+// Order of the entries of the priority queues used by closest
+// point queries: the nearest entry is on the top of the heap.
+//
+constexpr auto farther = [](const auto& a, const auto& b)
+  {
+    return a.d2 > b.d2;
+  };
+
+} // end namespace
+
+/**
+ * @brief Finds the point of the primitives of the leaf [\p first,
+ * \p first + \p count) closest to \p p.
+ *
+ * The closest point replaces the one in \p result if it is closer
+ * to \p p than result.distance. The default implementation does
+ * nothing; derived classes supporting closest point queries must
+ * override it.
+ */
+void
+BVHBase::closestPointLeaf(uint32_t, uint32_t, const vec3f&, ClosestPoint&)
+  const
+{
+  // do nothing
+}
+
+template <typename Q>
+bool
+BVHBase::closestPointQuantized(const std::vector<QuantizedNode<Q>>& nodes,
+  const vec3f& p,
+  ClosestPoint& result) const
+{
+  struct Entry
+  {
+    float d2;
+    uint32_t index;
+    vec3f p1;
+    vec3f p2;
+
+  };
+
+  std::vector<Entry> heap;
+  const auto& p1 = _bounds.min();
+  const auto& p2 = _bounds.max();
+
+  heap.reserve(2 * _quantizedDepth + 2);
+  heap.push_back({squaredDistance(p, p1, p2), 0, p1, p2});
+  while (!heap.empty())
+  {
+    std::pop_heap(heap.begin(), heap.end(), farther);
+
+    auto e = heap.back();
+
+    heap.pop_back();
+    // Every node left in the queue is at least as far as this one.
+    if (e.d2 > math::sqr(result.distance))
+      break;
+
+    const auto& node = nodes[e.index];
+
+    if (node.isLeaf())
+    {
+      closestPointLeaf(node.offset, node.count, p, result);
+      continue;
+    }
+
+    uint32_t children[2]{e.index + 1, e.index + node.offset};
+
+    for (auto child : children)
+    {
+      vec3f q1;
+      vec3f q2;
+
+      nodes[child].decode(e.p1, e.p2, q1, q2);
+
+      auto d2 = squaredDistance(p, q1, q2);
+
+      if (d2 <= math::sqr(result.distance))
+      {
+        heap.push_back({d2, child, q1, q2});
+        std::push_heap(heap.begin(), heap.end(), farther);
+      }
+    }
+  }
+  return result.object != nullptr;
+}
+
+/**
+ * @brief Finds the point of the primitives of this BVH closest to
+ * \p p within the distance \p maxDistance.
+ *
+ * The nodes are visited in increasing order of the distance from
+ * \p p to their bounds, taken from a priority queue. The query
+ * stops as soon as the nearest node in the queue is farther than
+ * the closest point found so far, and the children farther than it
+ * are never queued. closestPointLeaf() is invoked for the leaves
+ * visited. Wide BVHs are traversed by their binary nodes.
+ *
+ * @return True if a point was found, false otherwise. In the latter
+ * case, result.object is null and result.distance is \p maxDistance.
+ */
+bool
+BVHBase::closestPoint(const vec3f& p,
+  ClosestPoint& result,
+  float maxDistance) const
+{
+  result.object = nullptr;
+  result.distance = maxDistance;
+  if (_nodeCount == 0)
+    return false;
+  if (_layout == NodeLayout::Quantized8)
+    return closestPointQuantized(_quantized8, p, result);
+  if (_layout == NodeLayout::Quantized16)
+    return closestPointQuantized(_quantized16, p, result);
+
+  struct Entry
+  {
+    float d2;
+    const Node* node;
+
+  };
+
+  std::vector<Entry> heap;
+
+  heap.reserve(64);
+  heap.push_back({squaredDistance(p, _bounds.min(), _bounds.max()), _root});
+  while (!heap.empty())
+  {
+    std::pop_heap(heap.begin(), heap.end(), farther);
+
+    auto e = heap.back();
+
+    heap.pop_back();
+    if (e.d2 > math::sqr(result.distance))
+      break;
+    if (e.node->isLeaf())
+    {
+      closestPointLeaf(e.node->_offset, e.node->_count, p, result);
+      continue;
+    }
+    for (int i = 0; i < 2; ++i)
+    {
+      auto child = e.node->child(i);
+      const auto& b = child->_bounds;
+      auto d2 = squaredDistance(p, b.min(), b.max());
+
+      if (d2 <= math::sqr(result.distance))
+      {
+        heap.push_back({d2, child});
+        std::push_heap(heap.begin(), heap.end(), farther);
+      }
+    }
+  }
+  return result.object != nullptr;
+}
+
+/**
+ * @brief Finds the closest point of every point in \p points in
+ * parallel.
+ *
+ * See closestPoint(const vec3f&, ClosestPoint&, float).
+ */
+void
+BVHBase::closestPoint(std::span<const vec3f> points,
+  std::span<ClosestPoint> results,
+  float maxDistance) const
+{
+  assert(results.size() >= points.size());
+  parallelFor(points.size(), closestPointGrainSize,
+    [&, this](size_t begin, size_t end)
+    {
+      for (auto i = begin; i < end; ++i)
+        closestPoint(points[i], results[i], maxDistance);
+    });
+}
+
+/**
+ * @brief Returns the distance from \p p to the primitives of this
+ * BVH, or \p maxDistance if no primitive is closer than it.
+ */
+float
+BVHBase::distance(const vec3f& p, float maxDistance) const
+{
+  ClosestPoint result;
+
+  closestPoint(p, result, maxDistance);
+  return result.distance;
+}
+
+namespace
+{ // begin namespace
+
+using Containment = Frustum::Containment;
+
+inline auto
+classify(const Frustum& frustum, const Bounds3f& bounds)
+{
+  return frustum.classify(bounds);
+}
+
+inline auto
+classify(const Bounds3f& box, const Bounds3f& bounds)
+{
+  const auto& p1 = box.min();
+  const auto& p2 = box.max();
+  const auto& q1 = bounds.min();
+  const auto& q2 = bounds.max();
+  auto result = Containment::Inside;
+
+  for (int i = 0; i < 3; ++i)
+  {
+    if (q2[i] < p1[i] || q1[i] > p2[i])
+      return Containment::Outside;
+    if (q1[i] < p1[i] || q2[i] > p2[i])
+      result = Containment::Intersecting;
+  }
+  return result;
+}
+
+} // end namespace
+
+template <typename Volume>
+void
+BVHBase::queryNodes(const Volume& volume, const QueryFunction& f) const
+{
+  std::vector<const Node*> stack;
+
+  stack.reserve(64);
+  stack.push_back(_root);
+  while (!stack.empty())
+  {
+    auto node = stack.back();
+
+    stack.pop_back();
+
+    auto c = classify(volume, node->_bounds);
+
+    if (c == Containment::Outside)
+      continue;
+    if (node->isLeaf())
+      f(node->_offset, node->_count, c == Containment::Inside);
+    else if (c == Containment::Intersecting)
+    {
+      stack.push_back(node->child(1));
+      stack.push_back(node->child(0));
+    }
+    else
+    {
+      // The primitive ids of the leaves of a subtree are contiguous
+      // and in the order of the leaves.
+      auto first = node;
+      auto last = node;
+
+      while (!first->isLeaf())
+        first = first->child(0);
+      while (!last->isLeaf())
+        last = last->child(1);
+      f(first->_offset, last->_offset + last->_count - first->_offset, true);
+    }
+  }
+}
+
+template <typename Q, typename Volume>
+void
+BVHBase::queryQuantized(const std::vector<QuantizedNode<Q>>& nodes,
+  const Volume& volume,
+  const QueryFunction& f) const
+{
+  struct Entry
+  {
+    uint32_t index;
+    vec3f p1;
+    vec3f p2;
+
+  };
+
+  std::vector<Entry> stack;
+
+  stack.reserve(2 * _quantizedDepth + 2);
+  stack.push_back({0, _bounds.min(), _bounds.max()});
+  while (!stack.empty())
+  {
+    auto e = stack.back();
+
+    stack.pop_back();
+
+    auto c = classify(volume, Bounds3f{e.p1, e.p2});
+    const auto& node = nodes[e.index];
+
+    if (c == Containment::Outside)
+      continue;
+    if (node.isLeaf())
+      f(node.offset, node.count, c == Containment::Inside);
+    else if (c == Containment::Intersecting)
+    {
+      uint32_t children[2]{e.index + node.offset, e.index + 1};
+
+      for (auto child : children)
+      {
+        vec3f q1;
+        vec3f q2;
+
+        nodes[child].decode(e.p1, e.p2, q1, q2);
+        stack.push_back({child, q1, q2});
+      }
+    }
+    else
+    {
+      auto first = e.index;
+      auto last = e.index;
+
+      while (!nodes[first].isLeaf())
+        ++first;
+      while (!nodes[last].isLeaf())
+        last += nodes[last].offset;
+
+      const auto& n1 = nodes[first];
+      const auto& n2 = nodes[last];
+
+      f(n1.offset, n2.offset + n2.count - n1.offset, true);
+    }
+  }
+}
+
+/**
+ * @brief Finds the primitives of this BVH whose bounds may intersect
+ * \p frustum.
+ *
+ * The nodes are classified against the frustum from the root down.
+ * The subtrees outside the frustum are skipped, and the primitive
+ * ids of a subtree inside the frustum are passed to \p f at once as
+ * a contained range, hence the caller can skip testing them. Leaves
+ * intersecting the frustum are passed as ranges to be tested.
+ * Wide BVHs are traversed by their binary nodes.
+ *
+ * In a BVH built by spatial splits, a primitive referenced by more
+ * than one leaf can be passed to \p f more than once, and the bounds
+ * of a node enclose only the parts of the split primitives it
+ * references: a contained range then guarantees that its primitives
+ * intersect the frustum, but not that they are inside it.
+ */
+void
+BVHBase::query(const Frustum& frustum, const QueryFunction& f) const
+{
+  if (_nodeCount == 0)
+    return;
+  if (_layout == NodeLayout::Quantized8)
+    queryQuantized(_quantized8, frustum, f);
+  else if (_layout == NodeLayout::Quantized16)
+    queryQuantized(_quantized16, frustum, f);
+  else
+    queryNodes(frustum, f);
+}
+
+/**
+ * @brief Finds the primitives of this BVH whose bounds may intersect
+ * \p box.
+ *
+ * See query(const Frustum&, const QueryFunction&).
+ */
+void
+BVHBase::query(const Bounds3f& box, const QueryFunction& f) const
+{
+  if (_nodeCount == 0)
+    return;
+  if (_layout == NodeLayout::Quantized8)
+    queryQuantized(_quantized8, box, f);
+  else if (_layout == NodeLayout::Quantized16)
+    queryQuantized(_quantized16, box, f);
+  else
+    queryNodes(box, f);
+}
+
+namespace
+{ // begin namespace
+
+//
+// Header of a BVH file. The header is followed by the node array
+// and by the primitive id array. The key identifies the data from
+// which the BVH was built and the checksum is the hash of the node
+// and primitive id arrays.
+//
+struct BVHFileHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint32_t nodeSize;
+  uint32_t nodeCount;
+  uint32_t idCount;
+  uint32_t maxPrimitivesPerNode;
+  uint64_t checksum;
+
+}; // BVHFileHeader
+
+constexpr char bvhFileMagic[4]{'C', 'G', 'B', 'V'};
+constexpr uint32_t bvhFileVersion{1};
+
+} // end namespace
+
+/**
+ * @brief Writes the nodes and primitive ids of this BVH to the
+ * file \p filename.
+ *
+ * The data are first written to a temporary file, which is then
+ * renamed, so readers never see a partially written file. The
+ * binary nodes are required, hence the BVH must be written before
+ * making a quantized layout.
+ */
+bool
+BVHBase::write(const char* filename, uint64_t key) const
+{
+  if (_root == nullptr)
+    return false;
+
+  namespace fs = std::filesystem;
+
+  const fs::path path{filename};
+  const fs::path temp{MappedFile::tempName(filename)};
+
+  auto file = fopen(temp.string().c_str(), "wb");
+
+  if (file == nullptr)
+    return false;
+
+  auto ok = write(file, key);
+
+  ok &= fclose(file) == 0;
+
+  std::error_code ec;
+
+  if (ok)
+    fs::rename(temp, path, ec);
+  if (!ok || ec)
+  {
+    fs::remove(temp, ec);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Writes the nodes and primitive ids of this BVH, preceded
+ * by a header with \p key and the build parameters, at the current
+ * position of \p file.
+ *
+ * The data written can be adopted by a BVH with the same build
+ * parameters (see read()). Returns false if this BVH has no binary
+ * nodes or the data cannot be written.
+ */
+bool
+BVHBase::write(FILE* file, uint64_t key) const
+{
+  if (_root == nullptr)
+    return false;
+
+  const auto nodeBytes = sizeof(Node) * _nodeCount;
+  const auto idBytes = sizeof(uint32_t) * _idCount;
+  BVHFileHeader header;
+
+  memcpy(header.magic, bvhFileMagic, sizeof bvhFileMagic);
+  header.version = bvhFileVersion;
+  header.key = hashCombine(key, _maxPrimitivesPerNode);
+  header.key = hashCombine(header.key, _splitMethod);
+  if (_splitMethod == SplitMethod::Spatial)
+    header.key = hashCombine(header.key, _duplicationBudget);
+  header.nodeSize = sizeof(Node);
+  header.nodeCount = _nodeCount;
+  header.idCount = _idCount;
+  header.maxPrimitivesPerNode = _maxPrimitivesPerNode;
+  header.checksum = hash64(_ids, idBytes, hash64(_root, nodeBytes));
+  return fwrite(&header, sizeof header, 1, file) == 1 &&
+    fwrite(_root, nodeBytes, 1, file) == 1 &&
+    fwrite(_ids, idBytes, 1, file) == 1;
+}
+
+/**
+ * @brief Returns the number of bytes written by write(FILE*,
+ * uint64_t).
+ */
+size_t
+BVHBase::writeSize() const
+{
+  if (_root == nullptr)
+    return 0;
+  return sizeof(BVHFileHeader) +
+    sizeof(Node) * _nodeCount +
+    sizeof(uint32_t) * _idCount;
+}
+
+/**
+ * @brief Adopts the nodes and primitive ids stored in the file
+ * \p filename.
+ *
+ * The file is mapped into memory and the BVH references its pages
+ * directly, without copying or rebuilding the nodes. Returns false
+ * if the file does not exist, was written by an incompatible
+ * version, does not match \p key and the build parameters of this
+ * BVH, is corrupted, or its nodes do not form a valid tree over
+ * \p primitiveCount primitives.
+ */
+bool
+BVHBase::read(const char* filename, uint64_t key, uint32_t primitiveCount)
+{
+  Reference<MappedFile> file{MappedFile::open(filename)};
+
+  return file != nullptr &&
+    read(*file, 0, file->size(), key, primitiveCount);
+}
+
+/**
+ * @brief Adopts the nodes and primitive ids written by write(FILE*,
+ * uint64_t) in the \p size bytes at \p offset of the mapped file
+ * \p file.
+ *
+ * See read(const char*, uint64_t, uint32_t).
+ */
+bool
+BVHBase::read(MappedFile& file,
+  size_t offset,
+  size_t size,
+  uint64_t key,
+  uint32_t primitiveCount)
+{
+  if (offset > file.size() ||
+    size > file.size() - offset ||
+    size < sizeof(BVHFileHeader))
+    return false;
+
+  const auto& header = *file.as<const BVHFileHeader>(offset);
+
+  key = hashCombine(key, _maxPrimitivesPerNode);
+  key = hashCombine(key, _splitMethod);
+  if (_splitMethod == SplitMethod::Spatial)
+    key = hashCombine(key, _duplicationBudget);
+  if (memcmp(header.magic, bvhFileMagic, sizeof bvhFileMagic) != 0 ||
+    header.version != bvhFileVersion ||
+    header.key != key ||
+    header.nodeSize != sizeof(Node) ||
+    header.nodeCount == 0 ||
+    header.maxPrimitivesPerNode != _maxPrimitivesPerNode)
+    return false;
+  // Only spatial splits reference a primitive from more than one
+  // leaf.
+  if (_splitMethod == SplitMethod::Spatial ?
+    header.idCount < primitiveCount :
+    header.idCount != primitiveCount)
+    return false;
+
+  const auto nodeBytes = sizeof(Node) * header.nodeCount;
+  const auto idBytes = sizeof(uint32_t) * header.idCount;
+
+  if (size != sizeof header + nodeBytes + idBytes)
+    return false;
+
+  auto nodes = file.as<const Node>(offset + sizeof header);
+  auto ids = file.as<const uint32_t>(offset + sizeof header + nodeBytes);
+
+  if (hash64(ids, idBytes, hash64(nodes, nodeBytes)) != header.checksum)
+    return false;
+  // The checksum only detects corrupted data. A file of a mesh with
+  // the same key but written by another build, or a file whose key
+  // collides with that of another mesh, could still index past the
+  // nodes or primitives.
+  if (!isValid(nodes, header.nodeCount, ids, header.idCount, primitiveCount))
+    return false;
+  _nodes.clear();
+  _primitiveIds.clear();
+  _root = nodes;
+  _nodeCount = header.nodeCount;
+  _ids = ids;
+  _idCount = header.idCount;
+  _storage = &file;
+  _bounds = nodes->_bounds;
+  makeLayout();
+  return true;
+}
+
+/**
+ * @brief Returns true if the \p nodeCount nodes in \p nodes form a
+ * binary tree in depth-first order whose leaves reference ranges of
+ * the \p idCount primitive ids in \p ids, and every id is the index
+ * of one of \p primitiveCount primitives.
+ *
+ * The first child of an interior node is the next node, hence the
+ * second child must follow the last leaf of the subtree of the
+ * first one. The nodes are visited in order, keeping a stack of the
+ * second children to be visited.
+ */
+bool
+BVHBase::isValid(const Node* nodes,
+  uint32_t nodeCount,
+  const uint32_t* ids,
+  uint32_t idCount,
+  uint32_t primitiveCount)
+{
+  for (uint32_t i = 0; i < idCount; ++i)
+    if (ids[i] >= primitiveCount)
+      return false;
+
+  std::vector<uint32_t> stack;
+
+  for (uint32_t i = 0;;)
+  {
+    const auto& node = nodes[i];
+
+    if (!node.isLeaf())
+    {
+      if (node._offset < 2 || node._offset >= nodeCount - i)
+        return false;
+      stack.push_back(i + node._offset);
+      ++i;
+    }
+    else if (node._offset > idCount || node._count > idCount - node._offset)
+      return false;
+    else if (stack.empty())
+      return i + 1 == nodeCount;
+    else if (stack.back() != ++i)
+      return false;
+    else
+      stack.pop_back();
+  }
+}
+
+/**
+ * @brief Returns the SAH cost of this BVH.
+ *
+ * The cost is the expected cost of finding the closest intersection
+ * of a random ray hitting the root bounds, assuming the cost of
+ * traversing an interior node is half the cost of intersecting a
+ * primitive, as in the builder.
+ */
+float
+BVHBase::sahCost() const
+{
+  auto root = nodes();
+
+  if (root == nullptr)
+    return 0;
+
+  auto sah = 0.f;
+
+  for (uint32_t i = 0; i < _nodeCount; ++i)
+  {
+    const auto& node = root[i];
+    auto area = node._bounds.area();
+
+    sah += node.isLeaf() ? area * node._count : area / 2;
+  }
+  return sah / root->_bounds.area();
+}
+
+Bounds3f
+BVHBase::bounds() const
+{
+  return _bounds;
+}
+
+/**
+ * @brief Returns the number of bytes of the nodes and primitive ids
+ * used by the traversal of this BVH, whether allocated or mapped
+ * from a cache file.
+ */
+size_t
+BVHBase::memorySize() const
+{
+  auto size = sizeof(uint32_t) * _idCount;
+
+  if (_root != nullptr)
+    size += sizeof(Node) * _nodeCount;
+  size += sizeof(WideNode<4>) * _wide4.size();
+  size += sizeof(WideNode<8>) * _wide8.size();
+  size += sizeof(WideLeaf) * _wideLeaves.size();
+  size += sizeof(QuantizedNode<uint8_t>) * _quantized8.size();
+  size += sizeof(QuantizedNode<uint16_t>) * _quantized16.size();
+  return size;
 }
 
 void
 BVHBase::iterate(NodeFunction f) const
 {
-  Node::iterate(_root, f);
+  Node::iterate(nodes(), f);
 }
 
 } // end namespace cg
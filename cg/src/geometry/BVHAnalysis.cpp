@@ -0,0 +1,321 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: BVHAnalysis.cpp
+// ========
+// Source file for BVH analysis.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#include "geometry/BVHAnalysis.h"
+#include <algorithm>
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// BVHAnalysis implementation
+// ===========
+struct BVHAnalysis::Entry
+{
+  BVHBase::NodeView node;
+  uint32_t depth;
+  uint32_t children[2];
+  // Range of the primitive references of the subtree of the node.
+  uint32_t first;
+  uint32_t end;
+
+}; // BVHAnalysis::Entry
+
+namespace
+{ // begin namespace
+
+inline auto
+isEmpty(const Bounds3f& b)
+{
+  return b.min().x > b.max().x;
+}
+
+inline auto
+intersection(const Bounds3f& a, const Bounds3f& b)
+{
+  auto p1 = math::max(a.min(), b.min());
+  auto p2 = math::min(a.max(), b.max());
+
+  if (p1.x > p2.x || p1.y > p2.y || p1.z > p2.z)
+    return Bounds3f{};
+  return Bounds3f{p1, p2};
+}
+
+} // end namespace
+
+auto
+BVHAnalysis::triangleAreaFunction(const TriangleMeshBVH& bvh) -> AreaFunction
+{
+  return [mesh = bvh.mesh()](uint32_t i, const Bounds3f& box)
+    {
+      const auto& m = mesh->data();
+      auto v = m.triangles[i].v;
+
+      return triangleArea(m.vertices[v[0]],
+        m.vertices[v[1]],
+        m.vertices[v[2]],
+        box);
+    };
+}
+
+/**
+ * @brief Analyzes the binary nodes of \p bvh.
+ *
+ * If \p area is not empty, the end-point overlap (EPO) of the BVH
+ * is also computed. The nodes of a quantized BVH are analyzed with
+ * their decoded bounds (see BVHBase::root()).
+ */
+BVHAnalysis::BVHAnalysis(const BVHBase& bvh, const AreaFunction& area)
+{
+  if (bvh.empty())
+    return;
+
+  auto root = bvh.root();
+  std::vector<Entry> nodes;
+  std::vector<uint32_t> stack;
+
+  assert(root != BVHBase::NodeView{});
+  // Collect the nodes in depth-first order.
+  nodes.push_back({root, 0, {}, 0, 0});
+  stack.push_back(0);
+  while (!stack.empty())
+  {
+    auto index = stack.back();
+
+    stack.pop_back();
+
+    auto node = nodes[index].node;
+    auto depth = nodes[index].depth;
+
+    if (node.isLeaf())
+    {
+      auto count = node.count();
+
+      nodes[index].first = node.first();
+      nodes[index].end = node.first() + count;
+      if (depthHistogram.size() <= depth)
+        depthHistogram.resize(depth + 1);
+      depthHistogram[depth]++;
+      if (leafSizeHistogram.size() <= count)
+        leafSizeHistogram.resize(count + 1);
+      leafSizeHistogram[count]++;
+      leafCount++;
+      referenceCount += count;
+      averageLeafDepth += depth;
+      maxDepth = std::max(maxDepth, depth);
+      continue;
+    }
+
+    auto c0 = node.child(0);
+    auto c1 = node.child(1);
+    auto overlap = intersection(c0.bounds(), c1.bounds());
+
+    if (!isEmpty(overlap))
+      siblingOverlap += overlap.area();
+    for (int i = 1; i >= 0; --i)
+    {
+      nodes[index].children[i] = (uint32_t)nodes.size();
+      nodes.push_back({node.child(i), depth + 1, {}, 0, 0});
+    }
+    stack.push_back(nodes[index].children[1]);
+    stack.push_back(nodes[index].children[0]);
+  }
+  // Compute the reference ranges of the interior nodes bottom-up.
+  for (auto i = nodes.size(); i-- > 0;)
+    if (auto& e = nodes[i]; !e.node.isLeaf())
+    {
+      e.first = std::min(nodes[e.children[0]].first,
+        nodes[e.children[1]].first);
+      e.end = std::max(nodes[e.children[0]].end,
+        nodes[e.children[1]].end);
+    }
+  nodeCount = (uint32_t)nodes.size();
+  averageLeafDepth /= leafCount;
+  siblingOverlap /= root.bounds().area();
+  sahCost = bvh.sahCost();
+  if (area)
+    computeEPO(bvh, nodes, area);
+}
+
+/**
+ * @brief Analyzes \p bvh and, if \p epo is true, computes its EPO
+ * from the areas of the triangles of the mesh.
+ */
+BVHAnalysis::BVHAnalysis(const TriangleMeshBVH& bvh, bool epo):
+  BVHAnalysis{bvh, epo ? triangleAreaFunction(bvh) : AreaFunction{}}
+{
+  // do nothing
+}
+
+/**
+ * @brief Computes the end-point overlap of a BVH.
+ *
+ * The metric is based on "On Quality Metrics of Bounding Volume
+ * Hierarchies" by T. Aila, T. Karras, and S. Laine (HPG 2013). For
+ * every node, the area of the primitive references outside of its
+ * subtree inside its bounds is weighted by the SAH cost of the
+ * node (1/2 for an interior node and the number of references for
+ * a leaf). The sum is divided by the total area of the references.
+ * The part of a reference is taken as the part of its primitive
+ * inside the bounds of its leaf, hence references duplicated by
+ * spatial splits are not counted twice.
+ */
+void
+BVHAnalysis::computeEPO(const BVHBase& bvh,
+  const std::vector<Entry>& nodes,
+  const AreaFunction& area)
+{
+  const auto leafArea = [&](const Entry& leaf, const Bounds3f& box)
+    {
+      auto b = intersection(box, leaf.node.bounds());
+      auto a = 0.f;
+
+      if (!isEmpty(b))
+        for (auto i = leaf.first; i < leaf.end; ++i)
+          a += area(bvh.primitiveId(i), b);
+      return a;
+    };
+  auto total = 0.;
+
+  for (const auto& e : nodes)
+    if (e.node.isLeaf())
+      total += leafArea(e, e.node.bounds());
+  epo = 0;
+  if (!(total > 0))
+    return;
+
+  auto sum = 0.;
+  std::vector<uint32_t> stack;
+
+  for (const auto& n : nodes)
+  {
+    const auto& box = n.node.bounds();
+    auto outside = 0.;
+
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+      const auto& e = nodes[stack.back()];
+
+      stack.pop_back();
+      // Skip the subtree of n and the nodes not overlapping it.
+      if (&e == &n || !e.node.bounds().overlap(box))
+        continue;
+      if (e.node.isLeaf())
+        outside += leafArea(e, box);
+      else
+      {
+        stack.push_back(e.children[1]);
+        stack.push_back(e.children[0]);
+      }
+    }
+    sum += outside * (n.node.isLeaf() ? n.node.count() : 0.5);
+  }
+  epo = float(sum / total);
+}
+
+float
+BVHAnalysis::triangleArea(const vec3f& p0,
+  const vec3f& p1,
+  const vec3f& p2,
+  const Bounds3f& box)
+{
+  // Clip the triangle against the six planes of the box.
+  vec3f buffers[2][9]{{p0, p1, p2}};
+  auto polygon = buffers[0];
+  auto n = 3;
+
+  for (int k = 0; k < 3 && n > 0; ++k)
+    for (int side = 0; side < 2 && n > 0; ++side)
+    {
+      auto clipped = polygon == buffers[0] ? buffers[1] : buffers[0];
+      auto c = box[side][k];
+      auto m = 0;
+      const auto inside = [side, c, k](const vec3f& p)
+        {
+          return side == 0 ? p[k] >= c : p[k] <= c;
+        };
+
+      for (int i = 0; i < n; ++i)
+      {
+        const auto& a = polygon[i];
+        const auto& b = polygon[i + 1 == n ? 0 : i + 1];
+        auto ia = inside(a);
+
+        if (ia)
+          clipped[m++] = a;
+        if (ia != inside(b))
+        {
+          auto p = a + (b - a) * ((c - a[k]) / (b[k] - a[k]));
+
+          p[k] = c;
+          clipped[m++] = p;
+        }
+      }
+      polygon = clipped;
+      n = m;
+    }
+
+  vec3f s{0, 0, 0};
+
+  for (int i = 2; i < n; ++i)
+    s += (polygon[i - 1] - polygon[0]).cross(polygon[i] - polygon[0]);
+  return s.length() * 0.5f;
+}
+
+void
+BVHAnalysis::print(FILE* f) const
+{
+  fprintf(f, "Nodes: %u (%u leaves)\n", nodeCount, leafCount);
+  fprintf(f, "Primitive references: %u\n", referenceCount);
+  fprintf(f,
+    "Depth: %u (average leaf depth %.2f)\n",
+    maxDepth,
+    averageLeafDepth);
+  fprintf(f, "SAH cost: %.3f\n", sahCost);
+  fprintf(f, "Sibling overlap: %.3f\n", siblingOverlap);
+  if (epo >= 0)
+    fprintf(f, "EPO: %.4f\n", epo);
+  fprintf(f, "Leaf depths:");
+  for (size_t i = 0; i < depthHistogram.size(); ++i)
+    if (depthHistogram[i] != 0)
+      fprintf(f, " %zu:%u", i, depthHistogram[i]);
+  fprintf(f, "\nLeaf sizes:");
+  for (size_t i = 0; i < leafSizeHistogram.size(); ++i)
+    if (leafSizeHistogram[i] != 0)
+      fprintf(f, " %zu:%u", i, leafSizeHistogram[i]);
+  fputc('\n', f);
+}
+
+} // end namespace cg
@@ -0,0 +1,522 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: ChunkedTriangleMesh.cpp
+// ========
+// Source file for out-of-core chunked triangle mesh.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#include "geometry/ChunkedTriangleMesh.h"
+#include "geometry/ChunkedTriangleMeshFile.h"
+#include <algorithm>
+#include <cassert>
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// ChunkedTriangleMesh::Chunk: chunk class
+// ==========================
+class ChunkedTriangleMesh::Chunk: public SharedObject
+{
+public:
+  enum class State
+  {
+    NotResident,
+    PagingIn,
+    Resident,
+    PagingOut
+  };
+
+  const ChunkedTriangleMesh* owner;
+  const ChunkedTriangleMeshFileHeader::Chunk* data;
+  int index;
+  Bounds3f box;
+  // Region of the file with the sections of this chunk
+  size_t offset;
+  size_t size;
+  // Bytes of this chunk when resident
+  size_t bytes;
+  State state{State::NotResident};
+  // Null if this chunk is not resident. Accessed without the lock
+  // only by the thread paging this chunk in or out.
+  Reference<TriangleMeshBVH> bvh;
+  ChunkLRU::iterator lruPosition;
+
+  Chunk(const ChunkedTriangleMesh& owner,
+    const ChunkedTriangleMeshFileHeader::Chunk& data,
+    int index);
+
+  const auto& bounds() const
+  {
+    return box;
+  }
+
+  bool intersect(const Ray3f& ray) const
+  {
+    return owner->chunkBVH(index)->intersect(ray);
+  }
+
+  bool intersect(const Ray3f& ray, Intersection& hit) const
+  {
+    if (!owner->chunkBVH(index)->intersect(ray, hit))
+      return false;
+    hit.object = owner;
+    hit.triangleIndex += data->firstTriangle;
+    return true;
+  }
+
+}; // ChunkedTriangleMesh::Chunk
+
+ChunkedTriangleMesh::Chunk::Chunk(const ChunkedTriangleMesh& owner,
+  const ChunkedTriangleMeshFileHeader::Chunk& data,
+  int index):
+  owner{&owner},
+  data{&data},
+  index{index},
+  offset{~size_t(0)},
+  size{},
+  bytes{}
+{
+  auto b = data.bounds;
+
+  box.set(vec3f{b[0], b[1], b[2]}, vec3f{b[3], b[4], b[5]});
+  for (const auto& section : data.sections)
+    if (section.size > 0)
+    {
+      offset = std::min(offset, size_t(section.offset));
+      size = std::max(size, size_t(section.offset + section.size));
+      bytes += section.size;
+    }
+  size -= offset;
+  // Normals not stored are computed when the chunk is paged in
+  if (data.sections[TriangleMeshFileHeader::Normals].size == 0)
+    bytes += sizeof(vec3f) * data.vertexCount;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// ChunkedTriangleMesh implementation
+// ===================
+ChunkedTriangleMesh::ChunkedTriangleMesh(MappedFile& file):
+  _file{&file}
+{
+  auto header = ChunkedTriangleMeshFileHeader::get(file);
+
+  assert(header != nullptr);
+
+  auto b = header->bounds;
+
+  _bounds.set(vec3f{b[0], b[1], b[2]}, vec3f{b[3], b[4], b[5]});
+  _vertexCount = header->vertexCount;
+  _triangleCount = header->triangleCount;
+  _maxTrianglesPerNode = header->maxTrianglesPerNode;
+
+  auto chunks = header->chunks(file);
+  auto nc = header->chunkCount;
+
+  _chunks.reserve(nc);
+  for (int i = 0; i < nc; ++i)
+    _chunks.push_back(new Chunk{*this, chunks[i], i});
+  // One chunk per leaf, hence rays page in only the chunks whose
+  // bounds they hit, from the nearest to the farthest
+  _bvh = new BVH<Chunk>{BVH<Chunk>::PrimitiveArray{_chunks}, 1};
+}
+
+ChunkedTriangleMesh::~ChunkedTriangleMesh()
+{
+  // do nothing
+}
+
+/**
+ * @brief Opens the chunked triangle mesh file \p filename.
+ *
+ * The file is mapped into memory with copy-on-write access, as the
+ * files read by MeshReader::readMesh(), and only the pages of the
+ * header and the chunk table are touched.
+ */
+ChunkedTriangleMesh*
+ChunkedTriangleMesh::open(const char* filename)
+{
+  using Header = ChunkedTriangleMeshFileHeader;
+
+  Reference<MappedFile> file{MappedFile::open(filename,
+    MappedFile::CopyOnWrite)};
+
+  if (file == nullptr)
+    return nullptr;
+
+  auto header = Header::get(*file);
+  auto valid = header != nullptr;
+
+  if (valid)
+  {
+    auto chunk = header->chunks(*file);
+    const size_t elementSizes[]
+    {
+      sizeof(vec3f),
+      sizeof(vec3f),
+      sizeof(vec2f),
+      sizeof(TriangleMesh::Triangle)
+    };
+
+    for (auto e = chunk + header->chunkCount; valid && chunk != e; ++chunk)
+      for (int i = 0; valid && i < TriangleMeshFileHeader::BVH; ++i)
+      {
+        auto size = chunk->sections[i].size;
+        auto count = i == TriangleMeshFileHeader::Triangles ?
+          chunk->triangleCount :
+          chunk->vertexCount;
+
+        // Normals and uv are optional
+        valid = size == elementSizes[i] * count ||
+          (size == 0 && i != TriangleMeshFileHeader::Vertices &&
+          i != TriangleMeshFileHeader::Triangles);
+      }
+  }
+  if (!valid)
+  {
+    fprintf(stderr, "Invalid chunked mesh file %s\n", filename);
+    return nullptr;
+  }
+  return new ChunkedTriangleMesh{*file};
+}
+
+const Bounds3f&
+ChunkedTriangleMesh::chunkBounds(int i) const
+{
+  assert(i >= 0 && i < chunkCount());
+  return _chunks[i]->box;
+}
+
+int
+ChunkedTriangleMesh::chunkTriangleCount(int i) const
+{
+  assert(i >= 0 && i < chunkCount());
+  return _chunks[i]->data->triangleCount;
+}
+
+int
+ChunkedTriangleMesh::chunkFirstTriangle(int i) const
+{
+  assert(i >= 0 && i < chunkCount());
+  return _chunks[i]->data->firstTriangle;
+}
+
+int
+ChunkedTriangleMesh::findChunk(int index) const
+{
+  assert(index >= 0 && index < _triangleCount);
+
+  auto it = std::upper_bound(_chunks.begin(),
+    _chunks.end(),
+    index,
+    [](int index, const Reference<Chunk>& chunk)
+    {
+      return index < chunk->data->firstTriangle;
+    });
+
+  return int(it - _chunks.begin()) - 1;
+}
+
+Reference<TriangleMesh>
+ChunkedTriangleMesh::chunkMesh(int i) const
+{
+  return chunkBVH(i)->mesh();
+}
+
+Reference<TriangleMeshBVH>
+ChunkedTriangleMesh::chunkBVH(int i) const
+{
+  assert(i >= 0 && i < chunkCount());
+
+  using State = Chunk::State;
+
+  auto& chunk = *_chunks[i];
+  std::unique_lock lock{_lock};
+
+  // Wait for another thread paging the chunk in or out
+  _paged.wait(lock, [&chunk]()
+    {
+      return chunk.state == State::NotResident ||
+        chunk.state == State::Resident;
+    });
+  if (chunk.state == State::Resident)
+  {
+    ++_statistics.hits;
+    _lru.splice(_lru.begin(), _lru, chunk.lruPosition);
+    return chunk.bvh;
+  }
+  // The bytes of the chunk are counted before it is paged in, hence
+  // concurrent page-ins do not exceed the budget together.
+  chunk.state = State::PagingIn;
+
+  auto chunks = evict(chunk.bytes);
+
+  _residentBytes += chunk.bytes;
+  ++_statistics.pageIns;
+  _statistics.peakResidentBytes = std::max(_statistics.peakResidentBytes,
+    _residentBytes);
+  lock.unlock();
+  pageOut(chunks);
+
+  Reference<TriangleMeshBVH> bvh;
+
+  try
+  {
+    bvh = pageIn(chunk);
+  }
+  catch (...)
+  {
+    lock.lock();
+    chunk.state = State::NotResident;
+    _residentBytes -= chunk.bytes;
+    _paged.notify_all();
+    throw;
+  }
+  lock.lock();
+  chunk.bvh = bvh;
+  chunk.state = State::Resident;
+  _lru.push_front(&chunk);
+  chunk.lruPosition = _lru.begin();
+  _paged.notify_all();
+  return bvh;
+}
+
+bool
+ChunkedTriangleMesh::isResident(int i) const
+{
+  assert(i >= 0 && i < chunkCount());
+
+  std::lock_guard lock{_lock};
+  return _chunks[i]->state == Chunk::State::Resident;
+}
+
+/**
+ * @brief Makes the mesh and the BVH of \p chunk, which is being
+ * paged in.
+ *
+ * The arrays of the chunk mesh reference the pages of the file,
+ * which are read on demand, and the nodes of its BVH are adopted
+ * from the file. Invoked without the lock held, since no other
+ * thread accesses a chunk being paged in.
+ */
+Reference<TriangleMeshBVH>
+ChunkedTriangleMesh::pageIn(Chunk& chunk) const
+{
+  using Header = TriangleMeshFileHeader;
+
+  _file->prefetch(chunk.offset, chunk.size);
+
+  const auto& c = *chunk.data;
+  auto array = [this, &c](int i) -> void*
+    {
+      const auto& section = c.sections[i];
+      return section.size > 0 ? _file->data() + section.offset : nullptr;
+    };
+  TriangleMesh::Data data;
+
+  data.vertexCount = c.vertexCount;
+  data.triangleCount = c.triangleCount;
+  data.vertices = (vec3f*)array(Header::Vertices);
+  data.vertexNormals = (vec3f*)array(Header::Normals);
+  data.uv = (vec2f*)array(Header::UV);
+  data.triangles = (TriangleMesh::Triangle*)array(Header::Triangles);
+
+  Reference<TriangleMesh> mesh{new TriangleMesh{data, _file, chunk.box}};
+
+  if (!mesh->hasVertexNormals())
+    mesh->computeNormals();
+
+  const auto& bvh = c.sections[Header::BVH];
+
+  return TriangleMeshBVH::make(*mesh,
+    *_file,
+    bvh.offset,
+    bvh.size,
+    c.checksum,
+    _maxTrianglesPerNode);
+}
+
+/**
+ * @brief Pages out \p chunks, taken by evict(), and releases their
+ * pages. Must be invoked without the lock held.
+ */
+void
+ChunkedTriangleMesh::pageOut(const ChunkList& chunks) const
+{
+  if (chunks.empty())
+    return;
+
+  std::vector<Reference<TriangleMesh>> meshes;
+
+  for (auto chunk : chunks)
+  {
+    Reference<TriangleMesh> mesh{chunk->bvh->mesh()};
+
+    chunk->bvh = nullptr;
+    if (mesh->userData != nullptr)
+      meshes.push_back(mesh);
+    _file->discard(chunk->offset, chunk->size);
+  }
+
+  std::lock_guard lock{_lock};
+
+  for (auto chunk : chunks)
+    chunk->state = Chunk::State::NotResident;
+  _pagedOut.insert(_pagedOut.end(), meshes.begin(), meshes.end());
+  _paged.notify_all();
+}
+
+/**
+ * @brief Takes the least recently used chunks to be paged out until
+ * \p size bytes can be paged in within the residency budget.
+ *
+ * A chunk is not taken if its BVH or mesh is referenced outside
+ * this mesh, hence the resident bytes can exceed the budget. The
+ * chunks taken are no longer resident, and must be passed to
+ * pageOut() once the lock, which must be held, is released.
+ */
+ChunkedTriangleMesh::ChunkList
+ChunkedTriangleMesh::evict(size_t size) const
+{
+  ChunkList chunks;
+
+  for (auto it = _lru.end();
+    _residentBytes + size > _residencyBudget && it != _lru.begin();)
+  {
+    auto chunk = *--it;
+    const auto& bvh = chunk->bvh;
+
+    if (bvh->SharedObject::referenceCount() > 1 ||
+      bvh->mesh()->referenceCount() > 1)
+      continue;
+    chunk->state = Chunk::State::PagingOut;
+    _residentBytes -= chunk->bytes;
+    ++_statistics.pageOuts;
+    chunks.push_back(chunk);
+    it = _lru.erase(it);
+  }
+  return chunks;
+}
+
+bool
+ChunkedTriangleMesh::intersect(const Ray3f& ray) const
+{
+  return _bvh->intersect(ray);
+}
+
+bool
+ChunkedTriangleMesh::intersect(const Ray3f& ray, Intersection& hit) const
+{
+  return _bvh->intersect(ray, hit);
+}
+
+vec3f
+ChunkedTriangleMesh::normal(const Intersection& hit) const
+{
+  auto i = findChunk(hit.triangleIndex);
+  auto bvh = chunkBVH(i);
+  const auto& m = bvh->mesh()->data();
+  auto v = m.triangles[hit.triangleIndex - chunkFirstTriangle(i)].v;
+  const auto& N0 = m.vertexNormals[v[0]];
+  const auto& N1 = m.vertexNormals[v[1]];
+  const auto& N2 = m.vertexNormals[v[2]];
+
+  return triangle::interpolate(hit.p, N0, N1, N2).versor();
+}
+
+void
+ChunkedTriangleMesh::queryChunks(const Frustum& frustum,
+  const ChunkFunction& f) const
+{
+  _bvh->queryPrimitives(frustum, [&](Chunk* chunk, bool contained)
+    {
+      if (contained || frustum.classify(chunk->box) != Frustum::Outside)
+        f(chunk->index);
+    });
+}
+
+void
+ChunkedTriangleMesh::setResidencyBudget(size_t budget)
+{
+  ChunkList chunks;
+
+  {
+    std::lock_guard lock{_lock};
+
+    _residencyBudget = budget;
+    chunks = evict(0);
+  }
+  pageOut(chunks);
+}
+
+size_t
+ChunkedTriangleMesh::residentBytes() const
+{
+  std::lock_guard lock{_lock};
+  return _residentBytes;
+}
+
+int
+ChunkedTriangleMesh::residentChunkCount() const
+{
+  std::lock_guard lock{_lock};
+  return (int)_lru.size();
+}
+
+ChunkedTriangleMesh::Statistics
+ChunkedTriangleMesh::statistics() const
+{
+  std::lock_guard lock{_lock};
+  return _statistics;
+}
+
+void
+ChunkedTriangleMesh::resetStatistics()
+{
+  std::lock_guard lock{_lock};
+
+  _statistics = {};
+  _statistics.peakResidentBytes = _residentBytes;
+}
+
+void
+ChunkedTriangleMesh::releasePagedOut() const
+{
+  std::vector<Reference<TriangleMesh>> meshes;
+
+  {
+    std::lock_guard lock{_lock};
+    meshes.swap(_pagedOut);
+  }
+}
+
+} // end namespace cg
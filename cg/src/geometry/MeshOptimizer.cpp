@@ -0,0 +1,273 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: MeshOptimizer.cpp
+// ========
+// Source file for mesh optimizer.
+//
+// Author: Paulo Pagliosa
+// Last revision: 18/10/2026
+
+#include "geometry/MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace cg
+{ // begin namespace cg
+
+namespace
+{ // begin namespace
+
+constexpr auto cacheSize = MeshOptimizer::cacheSize;
+constexpr auto maxValence = 32;
+
+//
+// Vertex scores of Forsyth's linear-speed vertex cache optimization.
+// The score of a vertex grows with its proximity to the front of the
+// cache and decreases with the number of triangles still using it;
+// position cacheSize means out of cache.
+//
+struct VertexScore
+{
+  float cache[cacheSize + 1];
+  float valence[maxValence + 1];
+
+  VertexScore()
+  {
+    for (int i = 0; i < cacheSize; ++i)
+      cache[i] = i < 3 ?
+        0.75f :
+        std::pow(1 - float(i - 3) / (cacheSize - 3), 1.5f);
+    cache[cacheSize] = 0;
+    valence[0] = 0;
+    for (int i = 1; i <= maxValence; ++i)
+      valence[i] = 2 / std::sqrt(float(i));
+  }
+
+  float operator ()(int position, int valence) const
+  {
+    // A vertex without triangles left does not score at all
+    if (valence == 0)
+      return 0;
+    return cache[position] + this->valence[std::min(valence, maxValence)];
+  }
+
+}; // VertexScore
+
+} // end namespace
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// MeshOptimizer implementation
+// =============
+MeshOptimizer::VertexCacheStatistics
+MeshOptimizer::analyzeVertexCache(const TriangleMesh& mesh, int fifoSize)
+{
+  const auto& data = mesh.data();
+  // The time of a vertex is the miss count when it entered the FIFO;
+  // negative times are of vertices never transformed
+  std::vector<int> time(data.vertexCount, -fifoSize - 1);
+  int misses{};
+  int vertexCount{};
+
+  for (int i = 0; i < data.triangleCount; ++i)
+    for (auto v : data.triangles[i].v)
+      if (misses - time[v] >= fifoSize)
+      {
+        if (time[v] < 0)
+          ++vertexCount;
+        time[v] = misses++;
+      }
+
+  VertexCacheStatistics s{misses, 0, 0};
+
+  if (data.triangleCount > 0)
+    s.acmr = float(misses) / data.triangleCount;
+  if (vertexCount > 0)
+    s.atvr = float(misses) / vertexCount;
+  return s;
+}
+
+/**
+ * @brief Reorders the triangles of a mesh for the post-transform
+ * vertex cache.
+ *
+ * The triangles are greedily emitted by Forsyth's algorithm for an
+ * LRU cache of cacheSize entries. Each step emits the triangle of
+ * highest score among the ones using the vertices of the simulated
+ * cache and then updates the scores of these vertices only, so the
+ * optimization runs in time linear in the number of triangles.
+ */
+void
+MeshOptimizer::optimizeVertexCache(TriangleMesh& mesh)
+{
+  const auto& data = mesh.data();
+  auto nv = data.vertexCount;
+  auto nt = data.triangleCount;
+
+  if (nt == 0)
+    return;
+
+  auto triangles = data.triangles;
+  // The triangles not emitted yet of a vertex v are
+  // adjacency[offset[v]], ..., adjacency[offset[v] + valence[v] - 1]
+  std::vector<int> valence(nv);
+  std::vector<int> offset(nv + 1);
+  std::vector<int> adjacency(3 * size_t(nt));
+
+  for (int i = 0; i < nt; ++i)
+    for (auto v : triangles[i].v)
+      ++valence[v];
+  for (int v = 0; v < nv; ++v)
+    offset[v + 1] = offset[v] + valence[v];
+  {
+    std::vector<int> next(offset.begin(), offset.end() - 1);
+
+    for (int i = 0; i < nt; ++i)
+      for (auto v : triangles[i].v)
+        adjacency[next[v]++] = i;
+  }
+
+  static const VertexScore score;
+  std::vector<int> position(nv, cacheSize);
+  std::vector<float> vertexScore(nv);
+
+  for (int v = 0; v < nv; ++v)
+    vertexScore[v] = score(cacheSize, valence[v]);
+
+  auto triangleScore = [&](int i)
+    {
+      const auto& t = triangles[i].v;
+
+      return vertexScore[t[0]] + vertexScore[t[1]] + vertexScore[t[2]];
+    };
+
+  std::vector<char> emitted(nt);
+  int best{};
+  float bestScore{triangleScore(0)};
+
+  for (int i = 1; i < nt; ++i)
+    if (auto s = triangleScore(i); s > bestScore)
+    {
+      bestScore = s;
+      best = i;
+    }
+
+  std::vector<int> order;
+  int cache[cacheSize + 3];
+  int cacheCount{};
+  int cursor{};
+
+  order.reserve(nt);
+  for (;;)
+  {
+    if (best < 0)
+    {
+      // No triangle uses a cached vertex: restart from the first
+      // triangle not emitted yet
+      while (cursor < nt && emitted[cursor])
+        ++cursor;
+      if (cursor == nt)
+        break;
+      best = cursor;
+    }
+    order.push_back(best);
+    emitted[best] = true;
+
+    const auto& t = triangles[best].v;
+    int newCache[cacheSize + 3];
+    int n{};
+
+    for (auto v : t)
+    {
+      // Remove the triangle from the adjacency of its vertices
+      auto a = adjacency.data() + offset[v];
+      auto last = --valence[v];
+
+      *std::find(a, a + last, best) = a[last];
+      if (std::find(newCache, newCache + n, v) == newCache + n)
+        newCache[n++] = v;
+    }
+    for (int i = 0; i < cacheCount; ++i)
+      if (auto v = cache[i]; v != t[0] && v != t[1] && v != t[2])
+        newCache[n++] = v;
+    // The vertices pushed beyond cacheSize leave the cache
+    for (int i = 0; i < n; ++i)
+    {
+      auto v = newCache[i];
+
+      position[v] = std::min(i, cacheSize);
+      vertexScore[v] = score(position[v], valence[v]);
+    }
+    cacheCount = std::min(n, cacheSize);
+    std::copy_n(newCache, cacheCount, cache);
+
+    best = -1;
+    bestScore = -1;
+    for (int i = 0; i < n; ++i)
+    {
+      auto v = newCache[i];
+      auto a = adjacency.data() + offset[v];
+
+      for (auto e = a + valence[v]; a != e; ++a)
+        if (auto s = triangleScore(*a); s > bestScore)
+        {
+          bestScore = s;
+          best = *a;
+        }
+    }
+  }
+  mesh.reorderTriangles(order.data());
+}
+
+/**
+ * @brief Renumbers the vertices of a mesh in the order they are
+ * first used by its triangles.
+ *
+ * Consecutive triangles then fetch vertex attributes that are close
+ * in memory, both on the GPU and in the leaves of a BVH. Unused
+ * vertices are moved to the end in their relative order.
+ */
+void
+MeshOptimizer::optimizeVertexFetch(TriangleMesh& mesh)
+{
+  const auto& data = mesh.data();
+  auto nv = data.vertexCount;
+  std::vector<int> remap(nv, -1);
+  int next{};
+
+  for (int i = 0; i < data.triangleCount; ++i)
+    for (auto v : data.triangles[i].v)
+      if (remap[v] < 0)
+        remap[v] = next++;
+  for (int v = 0; v < nv; ++v)
+    if (remap[v] < 0)
+      remap[v] = next++;
+  mesh.remapVertices(remap.data());
+}
+
+} // end namespace cg
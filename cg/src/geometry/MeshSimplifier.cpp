@@ -0,0 +1,572 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: MeshSimplifier.cpp
+// ========
+// Source file for quadric error mesh simplifier.
+//
+// Author: Paulo Pagliosa
+// Last revision: 18/10/2026
+
+#include "core/Parallel.h"
+#include "geometry/MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace cg
+{ // begin namespace cg
+
+namespace
+{ // begin namespace
+
+// Weight of the planes perpendicular to the boundary edges
+constexpr auto boundaryWeight = 10.0;
+
+//
+// Quadric error of a point: symmetric 4x4 matrix of the sum of the
+// squared distances to a set of planes.
+//
+struct Quadric
+{
+  double a00, a01, a02, a03;
+  double a11, a12, a13;
+  double a22, a23;
+  double a33;
+
+  static Quadric plane(const vec3d& n, double d, double w = 1)
+  {
+    return {w * n.x * n.x, w * n.x * n.y, w * n.x * n.z, w * n.x * d,
+      w * n.y * n.y, w * n.y * n.z, w * n.y * d,
+      w * n.z * n.z, w * n.z * d,
+      w * d * d};
+  }
+
+  Quadric& operator +=(const Quadric& q)
+  {
+    a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+    a11 += q.a11; a12 += q.a12; a13 += q.a13;
+    a22 += q.a22; a23 += q.a23;
+    a33 += q.a33;
+    return *this;
+  }
+
+  Quadric operator +(const Quadric& q) const
+  {
+    return Quadric{*this} += q;
+  }
+
+  double error(const vec3d& p) const
+  {
+    auto x = p.x;
+    auto y = p.y;
+    auto z = p.z;
+
+    return x * (a00 * x + 2 * (a01 * y + a02 * z + a03)) +
+      y * (a11 * y + 2 * (a12 * z + a13)) +
+      z * (a22 * z + 2 * a23) +
+      a33;
+  }
+
+  // Computes the point of minimum error, if the system is not
+  // (nearly) singular
+  bool minimum(vec3d& p) const
+  {
+    auto c00 = a11 * a22 - a12 * a12;
+    auto c01 = a02 * a12 - a01 * a22;
+    auto c02 = a01 * a12 - a02 * a11;
+    auto det = a00 * c00 + a01 * c01 + a02 * c02;
+    auto t = a00 + a11 + a22;
+
+    if (std::abs(det) <= 1e-6 * t * t * t)
+      return false;
+
+    auto c11 = a00 * a22 - a02 * a02;
+    auto c12 = a01 * a02 - a00 * a12;
+    auto c22 = a00 * a11 - a01 * a01;
+    auto s = -1 / det;
+
+    p.x = s * (c00 * a03 + c01 * a13 + c02 * a23);
+    p.y = s * (c01 * a03 + c11 * a13 + c12 * a23);
+    p.z = s * (c02 * a03 + c12 * a13 + c22 * a23);
+    return true;
+  }
+
+}; // Quadric
+
+struct Collapse
+{
+  double cost;
+  int v0;
+  int v1;
+
+  bool operator <(const Collapse& other) const
+  {
+    return cost < other.cost;
+  }
+
+}; // Collapse
+
+inline vec3d
+normal(const vec3d& p0, const vec3d& p1, const vec3d& p2)
+{
+  return (p1 - p0).cross(p2 - p0);
+}
+
+} // end namespace
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// MeshSimplifier implementation
+// ==============
+struct MeshSimplifier::Data
+{
+  using Triangle = TriangleMesh::Triangle;
+
+  std::vector<vec3d> positions;
+  std::vector<vec2f> uv;
+  std::vector<Quadric> quadrics;
+  std::vector<char> removed;
+  std::vector<std::vector<int>> vertexTriangles;
+  std::vector<Triangle> triangles;
+  std::vector<char> deleted;
+  int triangleCount{};
+  double maxCost{};
+  // Scratch vertex lists
+  mutable std::vector<int> n0;
+  mutable std::vector<int> n1;
+  mutable std::vector<int> common;
+
+  Data(const TriangleMesh&);
+
+  bool live(int t) const
+  {
+    return !deleted[t];
+  }
+
+  double cost(int, int, vec3d&) const;
+  bool canCollapse(int, int, const vec3d&) const;
+  void collapse(int, int, const vec3d&, double);
+
+}; // MeshSimplifier::Data
+
+MeshSimplifier::Data::Data(const TriangleMesh& mesh)
+{
+  const auto& data = mesh.data();
+  auto nv = data.vertexCount;
+  // Weld the vertices by position
+  std::vector<int> order(nv);
+  std::vector<int> weld(nv);
+
+  for (int i = 0; i < nv; ++i)
+    order[i] = i;
+
+  auto v = data.vertices;
+
+  std::sort(order.begin(), order.end(), [v](int i, int j)
+    {
+      const auto& a = v[i];
+      const auto& b = v[j];
+
+      if (a.x != b.x)
+        return a.x < b.x;
+      if (a.y != b.y)
+        return a.y < b.y;
+      return a.z < b.z;
+    });
+  for (int i = 0; i < nv; ++i)
+  {
+    auto k = order[i];
+
+    if (i == 0 || v[k] != v[order[i - 1]])
+    {
+      positions.emplace_back(v[k]);
+      if (mesh.hasUV())
+        uv.push_back(data.uv[k]);
+    }
+    weld[k] = int(positions.size()) - 1;
+  }
+  nv = int(positions.size());
+  quadrics.resize(nv);
+  removed.resize(nv);
+  vertexTriangles.resize(nv);
+  for (int i = 0; i < data.triangleCount; ++i)
+  {
+    auto s = data.triangles[i].v;
+    Triangle t{weld[s[0]], weld[s[1]], weld[s[2]]};
+
+    if (t.v[0] == t.v[1] || t.v[1] == t.v[2] || t.v[2] == t.v[0])
+      continue;
+
+    auto n = normal(positions[t.v[0]],
+      positions[t.v[1]],
+      positions[t.v[2]]).versor();
+
+    if (n.isNull())
+      continue;
+
+    auto q = Quadric::plane(n, -n.dot(positions[t.v[0]]));
+    int k = int(triangles.size());
+
+    for (auto w : t.v)
+    {
+      quadrics[w] += q;
+      vertexTriangles[w].push_back(k);
+    }
+    triangles.push_back(t);
+  }
+  triangleCount = int(triangles.size());
+  deleted.resize(triangleCount);
+
+  // Each edge is a key with its vertices and a triangle using it.
+  // A plane perpendicular to a boundary edge keeps the boundary
+  struct Edge
+  {
+    uint64_t key;
+    int triangle;
+
+  };
+
+  std::vector<Edge> edges;
+
+  edges.reserve(3 * size_t(triangleCount));
+  for (int i = 0; i < triangleCount; ++i)
+    for (int k = 0; k < 3; ++k)
+    {
+      auto a = uint32_t(triangles[i].v[k]);
+      auto b = uint32_t(triangles[i].v[(k + 1) % 3]);
+
+      edges.push_back({uint64_t(std::min(a, b)) << 32 | std::max(a, b), i});
+    }
+  std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b)
+    {
+      return a.key < b.key;
+    });
+  for (size_t i = 0, j; i < edges.size(); i = j)
+  {
+    for (j = i + 1; j < edges.size() && edges[j].key == edges[i].key;)
+      ++j;
+    if (j - i == 1)
+    {
+      auto a = int(edges[i].key >> 32);
+      auto b = int(edges[i].key & 0xffffffff);
+      auto& t = triangles[edges[i].triangle].v;
+      auto n = normal(positions[t[0]], positions[t[1]], positions[t[2]]);
+      auto e = positions[b] - positions[a];
+      auto m = e.cross(n).versor();
+      auto q = Quadric::plane(m, -m.dot(positions[a]), boundaryWeight);
+
+      quadrics[a] += q;
+      quadrics[b] += q;
+    }
+  }
+}
+
+// Returns the error of the collapse of the edge (v0, v1) and
+// computes in p the position of the remaining vertex
+double
+MeshSimplifier::Data::cost(int v0, int v1, vec3d& p) const
+{
+  auto q = quadrics[v0] + quadrics[v1];
+  const auto& p0 = positions[v0];
+  const auto& p1 = positions[v1];
+  auto m = (p0 + p1) * 0.5;
+
+  // The minimum is rejected if far from the edge, which happens
+  // in nearly flat regions
+  if (!q.minimum(p) || (p - m).squaredNorm() > (p1 - p0).squaredNorm())
+  {
+    auto e0 = q.error(p0);
+    auto e1 = q.error(p1);
+    auto em = q.error(m);
+
+    if (em <= e0 && em <= e1)
+      p = m;
+    else
+      p = e0 <= e1 ? p0 : p1;
+  }
+  return std::max(q.error(p), 0.0);
+}
+
+// Returns true if the collapse of the edge (v0, v1) into p neither
+// makes the mesh non-manifold nor flips a triangle
+bool
+MeshSimplifier::Data::canCollapse(int v0, int v1, const vec3d& p) const
+{
+  int shared{};
+  auto neighbors = [this](int v, std::vector<int>& n)
+    {
+      n.clear();
+      for (auto t : vertexTriangles[v])
+        if (live(t))
+          for (auto w : triangles[t].v)
+            if (w != v)
+              n.push_back(w);
+      std::sort(n.begin(), n.end());
+      n.erase(std::unique(n.begin(), n.end()), n.end());
+    };
+
+  for (auto t : vertexTriangles[v0])
+    if (live(t))
+    {
+      auto& s = triangles[t].v;
+
+      shared += s[0] == v1 || s[1] == v1 || s[2] == v1;
+    }
+  neighbors(v0, n0);
+  neighbors(v1, n1);
+
+  // The vertices adjacent to both v0 and v1 must be the ones
+  // opposite to the edge in the triangles sharing it
+  common.clear();
+  std::set_intersection(n0.begin(), n0.end(),
+    n1.begin(), n1.end(),
+    std::back_inserter(common));
+  if (shared == 0 || int(common.size()) != shared)
+    return false;
+  for (auto v : {v0, v1})
+    for (auto t : vertexTriangles[v])
+    {
+      if (!live(t))
+        continue;
+
+      auto& s = triangles[t].v;
+      vec3d q[3];
+      int moved{};
+
+      for (int k = 0; k < 3; ++k)
+      {
+        q[k] = positions[s[k]];
+        if (s[k] == v0 || s[k] == v1)
+          ++moved;
+      }
+      // Triangles sharing the edge are deleted by the collapse
+      if (moved > 1)
+        continue;
+
+      auto n = normal(q[0], q[1], q[2]);
+
+      for (int k = 0; k < 3; ++k)
+        if (s[k] == v)
+          q[k] = p;
+
+      auto m = normal(q[0], q[1], q[2]);
+
+      if (m.dot(n) <= 0.2 * std::sqrt(m.squaredNorm() * n.squaredNorm()))
+        return false;
+    }
+  return true;
+}
+
+// Collapses the edge (v0, v1) into the vertex v0 at p
+void
+MeshSimplifier::Data::collapse(int v0, int v1, const vec3d& p, double c)
+{
+  if (!uv.empty() &&
+    (p - positions[v1]).squaredNorm() < (p - positions[v0]).squaredNorm())
+    uv[v0] = uv[v1];
+  positions[v0] = p;
+  quadrics[v0] += quadrics[v1];
+  removed[v1] = true;
+  maxCost = std::max(maxCost, c);
+
+  auto& a0 = vertexTriangles[v0];
+
+  for (auto t : vertexTriangles[v1])
+  {
+    if (!live(t))
+      continue;
+
+    auto& s = triangles[t].v;
+
+    if (s[0] == v0 || s[1] == v0 || s[2] == v0)
+    {
+      deleted[t] = true;
+      --triangleCount;
+      continue;
+    }
+    for (auto& w : s)
+      if (w == v1)
+        w = v0;
+    a0.push_back(t);
+  }
+  std::vector<int>{}.swap(vertexTriangles[v1]);
+  a0.erase(std::remove_if(a0.begin(), a0.end(), [this](int t)
+    {
+      return !live(t);
+    }), a0.end());
+}
+
+MeshSimplifier::MeshSimplifier(const TriangleMesh& mesh):
+  _data{new Data{mesh}}
+{
+  // do nothing
+}
+
+MeshSimplifier::~MeshSimplifier()
+{
+  delete _data;
+}
+
+/**
+ * @brief Collapses edges until the number of triangles is at most
+ * \p triangleCount, if possible.
+ *
+ * Instead of keeping the collapses in a priority queue, each pass
+ * sorts the cheapest collapses of the current edges and performs
+ * them in order. Edges of a vertex moved by a collapse are skipped
+ * until the next pass, since their costs are out of date. The
+ * passes work on contiguous arrays and are much faster than the
+ * queue updates for meshes with millions of edges.
+ */
+int
+MeshSimplifier::simplify(int triangleCount)
+{
+  auto& d = *_data;
+  std::vector<Collapse> collapses;
+  std::vector<char> moved;
+
+  while (d.triangleCount > triangleCount)
+  {
+    // An interior edge is taken twice, which is harmless. The edges
+    // of deleted triangles cost infinity
+    collapses.resize(3 * d.triangles.size());
+    parallelFor(d.triangles.size(), 1 << 14, [&](size_t begin, size_t end)
+      {
+        for (auto i = begin; i < end; ++i)
+          for (int k = 0; k < 3; ++k)
+          {
+            auto& c = collapses[3 * i + k];
+
+            if (!d.live(int(i)))
+            {
+              c = {std::numeric_limits<double>::infinity(), -1, -1};
+              continue;
+            }
+
+            auto a = d.triangles[i].v[k];
+            auto b = d.triangles[i].v[k < 2 ? k + 1 : 0];
+            vec3d p;
+
+            if (a > b)
+              std::swap(a, b);
+            c = {d.cost(a, b, p), a, b};
+          }
+      });
+
+    // Each collapse deletes about two triangles; a margin is taken
+    // for the collapses skipped or rejected
+    auto n = std::min(collapses.size(),
+      size_t(std::max(3 * (d.triangleCount - triangleCount), 64)));
+    auto end = collapses.begin() + n;
+    int count{};
+
+    std::nth_element(collapses.begin(), end, collapses.end());
+    std::sort(collapses.begin(), end);
+    moved.assign(d.positions.size(), false);
+    for (auto c = collapses.begin(); c != end; ++c)
+    {
+      if (d.triangleCount <= triangleCount || c->v0 < 0)
+        break;
+      if (d.removed[c->v0] || d.removed[c->v1] ||
+        moved[c->v0] || moved[c->v1])
+        continue;
+
+      vec3d p;
+
+      d.cost(c->v0, c->v1, p);
+      if (d.canCollapse(c->v0, c->v1, p))
+      {
+        d.collapse(c->v0, c->v1, p, c->cost);
+        moved[c->v0] = true;
+        ++count;
+      }
+    }
+    if (count == 0)
+      break;
+  }
+  return d.triangleCount;
+}
+
+int
+MeshSimplifier::triangleCount() const
+{
+  return _data->triangleCount;
+}
+
+float
+MeshSimplifier::error() const
+{
+  return float(std::sqrt(_data->maxCost));
+}
+
+TriangleMesh*
+MeshSimplifier::mesh() const
+{
+  const auto& d = *_data;
+  std::vector<int> remap(d.positions.size(), -1);
+  int nv{};
+
+  for (size_t i = 0; i < d.triangles.size(); ++i)
+    if (d.live(int(i)))
+      for (auto v : d.triangles[i].v)
+        if (remap[v] < 0)
+          remap[v] = nv++;
+
+  TriangleMesh::Data m;
+
+  m.vertexCount = nv;
+  m.triangleCount = d.triangleCount;
+  m.vertices = new vec3f[nv];
+  m.vertexNormals = nullptr;
+  m.uv = d.uv.empty() ? nullptr : new vec2f[nv];
+  m.triangles = new TriangleMesh::Triangle[d.triangleCount];
+  for (size_t i = 0; i < remap.size(); ++i)
+    if (auto v = remap[i]; v >= 0)
+    {
+      m.vertices[v] = vec3f{d.positions[i]};
+      if (m.uv != nullptr)
+        m.uv[v] = d.uv[i];
+    }
+
+  auto t = m.triangles;
+
+  for (size_t i = 0; i < d.triangles.size(); ++i)
+    if (d.live(int(i)))
+    {
+      auto s = d.triangles[i].v;
+
+      (t++)->setVertices(remap[s[0]], remap[s[1]], remap[s[2]]);
+    }
+
+  auto mesh = new TriangleMesh{std::move(m)};
+
+  mesh->computeNormals();
+  return mesh;
+}
+
+} // end namespace cg
@@ -28,9 +28,12 @@
 // Source file for mesh sweeper.
 //
 // Author: Paulo Pagliosa
-// Last revision: 11/08/2023
+// Last revision: 18/10/2026
 
 #include "geometry/MeshSweeper.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 #include <vector>
 
 namespace cg
@@ -88,6 +91,21 @@ setBoxTriangles(TriangleMesh::Triangle* t)
   t[10].setVertices(20, 21, 22); t[11].setVertices(22, 23, 20);
 }
 
+// Cached meshes by shape and level (see MeshSweeper::mesh())
+std::mutex cacheLock;
+Reference<TriangleMesh> cache[3][MeshSweeper::levelCount];
+
+inline int
+level(int ns)
+{
+  constexpr auto maxLevel = MeshSweeper::levelCount - 1;
+  int l = 0;
+
+  while (l < maxLevel && MeshSweeper::minResolution << l < ns)
+    ++l;
+  return l;
+}
+
 } // end namespace internal
 
 
@@ -257,21 +275,30 @@ MeshSweeper::makeSphere(int ns)
     constexpr auto pi = math::pi<float>;
     const auto mStep = pi / ns * 2;
     const auto pStep = pi / nl;
-    auto pAngle = pi / 2;
+    // Cosine and sine of the meridian angles. The last meridian is
+    // the first one, hence the seam vertices are equal.
+    std::vector<vec2f> meridians(np);
+
+    for (int m = 0; m < ns; ++m)
+      meridians[m] = {cosf(m * mStep), sinf(m * mStep)};
+    meridians[ns] = meridians[0];
+
     auto vertex = data.vertices;
     auto normal = data.vertexNormals;
     auto uv = data.uv;
 
-    for (int p = 0; p <= nl; ++p, pAngle -= pStep)
+    for (int p = 0; p <= nl; ++p)
     {
+      auto pAngle = pi / 2 - p * pStep;
       auto t = cosf(pAngle);
       auto y = sinf(pAngle);
       auto v = 1 - (float)p / nl;
-      auto mAngle = 0.0f;
 
-      for (int m = 0; m <= ns; ++m, mAngle += mStep)
+      for (int m = 0; m <= ns; ++m)
       {
-        *vertex++ = *normal++ = {t * cosf(mAngle), y, t * sinf(mAngle)};
+        const auto& c = meridians[m];
+
+        *vertex++ = *normal++ = {t * c.x, y, t * c.y};
         *uv++ = {1 - (float)m / ns, v};
       }
     }
@@ -297,4 +324,59 @@ MeshSweeper::makeSphere(int ns)
   return new TriangleMesh{std::move(data)};
 }
 
+TriangleMesh*
+MeshSweeper::mesh(Shape shape, int ns)
+{
+  auto l = internal::level(ns);
+  std::lock_guard lock{internal::cacheLock};
+  auto& m = internal::cache[(int)shape][l];
+
+  if (m == nullptr)
+  {
+    ns = minResolution << l;
+    switch (shape)
+    {
+      case Shape::Cone:
+        m = makeCone(ns);
+        break;
+      case Shape::Cylinder:
+        m = makeCylinder(ns);
+        break;
+      default:
+        m = makeSphere(ns);
+    }
+  }
+  return m;
+}
+
+int
+MeshSweeper::resolution(float radius, float tolerance)
+{
+  if (radius <= tolerance)
+    return minResolution;
+
+  // The distance of an n-gon inscribed in a circle of radius r to
+  // the circle is r(1 - cos(pi / n))
+  auto n = math::pi<float> / acosf(1 - tolerance / radius);
+
+  if (n >= maxResolution)
+    return maxResolution;
+  return std::max(minResolution, (int)ceilf(n));
+}
+
+bool
+MeshSweeper::isCached(const TriangleMesh& mesh, Shape& shape)
+{
+  std::lock_guard lock{internal::cacheLock};
+
+  for (int i = 0; i < 3; ++i)
+    for (const auto& m : internal::cache[i])
+      if (m == &mesh)
+      {
+        shape = Shape(i);
+        return true;
+      }
+  return false;
+}
+
 } // end namespace cg
@@ -28,20 +28,237 @@
 // Source file for simple triangle mesh.
 //
 // Author: Paulo Pagliosa
-// Last revision: 30/07/2023
+// Last revision: 19/10/2026
 
+#include "core/Hash.h"
+#include "core/Parallel.h"
 #include "geometry/MeshSweeper.h"
+#include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#define MESH_USE_SSE
+#include <immintrin.h>
+#endif
 
 namespace cg
 { // begin namespace cg
 
 
+namespace
+{ // begin namespace
+
+// Meshes with fewer vertices or triangles are processed serially
+constexpr size_t parallelThreshold = 1 << 16;
+constexpr size_t grainSize = 1 << 14;
+// Maximum number of partial sums of vertex normals
+constexpr size_t maxPartialSums = 8;
+
+// Calls f(begin, end) for ranges of [0, n) in parallel, if n is
+// large enough, or for [0, n) otherwise.
+template <typename F>
+inline void
+forEachRange(size_t n, F&& f)
+{
+  if (n < parallelThreshold)
+    f(size_t(0), n);
+  else
+    parallelFor(n, grainSize, f);
+}
+
+#ifdef MESH_USE_SSE
+//
+// Loads four consecutive vectors as their x, y and z lanes.
+//
+inline void
+load4(const vec3f* v, __m128& x, __m128& y, __m128& z)
+{
+  // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+  auto p = (const float*)v;
+  auto a = _mm_loadu_ps(p);
+  auto b = _mm_loadu_ps(p + 4);
+  auto c = _mm_loadu_ps(p + 8);
+  auto u = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+
+  x = _mm_shuffle_ps(a, u, _MM_SHUFFLE(2, 0, 3, 0));
+  y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+    _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+    _MM_SHUFFLE(2, 0, 2, 0));
+  z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+    _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),
+    _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+//
+// Stores x, y and z lanes as four consecutive vectors.
+//
+inline void
+store4(vec3f* v, __m128 x, __m128 y, __m128 z)
+{
+  auto p = (float*)v;
+  auto xy = _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0));
+  auto zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));
+  auto yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1));
+  auto xy2 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2));
+  auto zx3 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));
+  auto yz3 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));
+
+  _mm_storeu_ps(p, _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0)));
+  _mm_storeu_ps(p + 4, _mm_shuffle_ps(yz, xy2, _MM_SHUFFLE(2, 0, 2, 0)));
+  _mm_storeu_ps(p + 8, _mm_shuffle_ps(zx3, yz3, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+// Returns a * x + b * y + c * z, in the order of Matrix3x3::transform()
+inline auto
+combine(__m128 a, __m128 x, __m128 b, __m128 y, __m128 c, __m128 z)
+{
+  return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, x), _mm_mul_ps(b, y)),
+    _mm_mul_ps(c, z));
+}
+#endif // MESH_USE_SSE
+
+//
+// Transforms the points v[begin, end) by the affine transform m.
+// Four points at a time are transformed with the same operations,
+// in the same order, of Matrix4x4::transform3x4().
+//
+void
+transformPoints(vec3f* v, size_t begin, size_t end, const mat4f& m)
+{
+  auto i = begin;
+
+#ifdef MESH_USE_SSE
+  __m128 c[4][3];
+
+  for (int j = 0; j < 4; ++j)
+    for (int k = 0; k < 3; ++k)
+      c[j][k] = _mm_set1_ps(m[j][k]);
+  for (; i + 4 <= end; i += 4)
+  {
+    __m128 x, y, z;
+
+    load4(v + i, x, y, z);
+
+    auto tx = _mm_add_ps(combine(c[0][0], x, c[1][0], y, c[2][0], z),
+      c[3][0]);
+    auto ty = _mm_add_ps(combine(c[0][1], x, c[1][1], y, c[2][1], z),
+      c[3][1]);
+    auto tz = _mm_add_ps(combine(c[0][2], x, c[1][2], y, c[2][2], z),
+      c[3][2]);
+
+    store4(v + i, tx, ty, tz);
+  }
+#endif // MESH_USE_SSE
+  for (; i < end; ++i)
+    v[i] = m.transform3x4(v[i]);
+}
+
+//
+// Transforms the normals n[begin, end) by r and normalizes them, as
+// (r * n[i]).versor() does.
+//
+void
+transformNormals(vec3f* n, size_t begin, size_t end, const mat3f& r)
+{
+  auto i = begin;
+
+#ifdef MESH_USE_SSE
+  __m128 c[3][3];
+
+  for (int j = 0; j < 3; ++j)
+    for (int k = 0; k < 3; ++k)
+      c[j][k] = _mm_set1_ps(r[j][k]);
+
+  const auto one = _mm_set1_ps(1);
+  const auto eps = _mm_set1_ps(math::Limits<float>::eps());
+
+  for (; i + 4 <= end; i += 4)
+  {
+    __m128 x, y, z;
+
+    load4(n + i, x, y, z);
+
+    auto tx = combine(c[0][0], x, c[1][0], y, c[2][0], z);
+    auto ty = combine(c[0][1], x, c[1][1], y, c[2][1], z);
+    auto tz = combine(c[0][2], x, c[1][2], y, c[2][2], z);
+    auto len = _mm_sqrt_ps(combine(tx, tx, ty, ty, tz, tz));
+    // Vectors whose length is (nearly) zero are not normalized
+    auto mask = _mm_cmpgt_ps(len, eps);
+    auto s = _mm_or_ps(_mm_and_ps(mask, _mm_div_ps(one, len)),
+      _mm_andnot_ps(mask, one));
+
+    store4(n + i, _mm_mul_ps(tx, s), _mm_mul_ps(ty, s), _mm_mul_ps(tz, s));
+  }
+#endif // MESH_USE_SSE
+  for (; i < end; ++i)
+    n[i] = (r * n[i]).versor();
+}
+
+//
+// Returns the bounds of the points v[begin, end).
+//
+Bounds3f
+pointBounds(const vec3f* v, size_t begin, size_t end)
+{
+  Bounds3f b;
+  auto i = begin;
+
+#ifdef MESH_USE_SSE
+  if (i + 4 <= end)
+  {
+    __m128 x0, y0, z0;
+
+    load4(v + i, x0, y0, z0);
+
+    auto x1 = x0;
+    auto y1 = y0;
+    auto z1 = z0;
+
+    for (i += 4; i + 4 <= end; i += 4)
+    {
+      __m128 x, y, z;
+
+      load4(v + i, x, y, z);
+      x0 = _mm_min_ps(x0, x);
+      y0 = _mm_min_ps(y0, y);
+      z0 = _mm_min_ps(z0, z);
+      x1 = _mm_max_ps(x1, x);
+      y1 = _mm_max_ps(y1, y);
+      z1 = _mm_max_ps(z1, z);
+    }
+
+    alignas(16) float p0[3][4];
+    alignas(16) float p1[3][4];
+
+    _mm_store_ps(p0[0], x0);
+    _mm_store_ps(p0[1], y0);
+    _mm_store_ps(p0[2], z0);
+    _mm_store_ps(p1[0], x1);
+    _mm_store_ps(p1[1], y1);
+    _mm_store_ps(p1[2], z1);
+    for (int k = 0; k < 4; ++k)
+    {
+      b.inflate(p0[0][k], p0[1][k], p0[2][k]);
+      b.inflate(p1[0][k], p1[1][k], p1[2][k]);
+    }
+  }
+#endif // MESH_USE_SSE
+  for (; i < end; ++i)
+    b.inflate(v[i]);
+  return b;
+}
+
+} // end namespace
+
+
 /////////////////////////////////////////////////////////////////////
 //
 // TriangleMesh implementation
 // ============
-static uint32_t nextMeshId;
+// Meshes are made in worker threads too
+static std::atomic<uint32_t> nextMeshId;
 
 TriangleMesh::TriangleMesh(Data&& data):
   id{++nextMeshId},
@@ -50,23 +267,82 @@ TriangleMesh::TriangleMesh(Data&& data):
   memset(&data, 0, sizeof(Data));
 }
 
+TriangleMesh::TriangleMesh(const Data& data,
+  MappedFile* file,
+  const Bounds3f& bounds):
+  id{++nextMeshId},
+  _data{data},
+  _bounds{bounds},
+  _file{file},
+  _source{file}
+{
+  // do nothing
+}
+
 TriangleMesh::~TriangleMesh()
 {
-  delete []_data.vertices;
-  delete []_data.vertexNormals;
-  delete []_data.uv;
-  delete []_data.triangles;
+  // Arrays in the pages of the mapped file are not deleted
+  auto owns = [this](const void* p)
+    {
+      if (_file == nullptr)
+        return true;
+
+      auto data = _file->data();
+
+      return p < data || p >= data + _file->size();
+    };
+
+  if (owns(_data.vertices))
+    delete []_data.vertices;
+  if (owns(_data.vertexNormals))
+    delete []_data.vertexNormals;
+  if (owns(_data.uv))
+    delete []_data.uv;
+  if (owns(_data.triangles))
+    delete []_data.triangles;
 }
 
 const Bounds3f&
 TriangleMesh::bounds() const
 {
-  if (_bounds.empty())
-    for (int i = 0; i < _data.vertexCount; i++)
-      _bounds.inflate(_data.vertices[i]);
+  if (!_bounds.empty())
+    return _bounds;
+
+  // Parallel min/max reduction of the bounds of vertex ranges
+  auto nv = size_t(_data.vertexCount);
+  std::vector<Bounds3f> bounds((nv + grainSize - 1) / grainSize);
+
+  forEachRange(nv, [this, &bounds](size_t begin, size_t end)
+    {
+      bounds[begin / grainSize] = pointBounds(_data.vertices, begin, end);
+    });
+  for (const auto& b : bounds)
+    _bounds.inflate(b);
   return _bounds;
 }
 
+/// Returns the hash of the vertices and triangles of this mesh.
+uint64_t
+TriangleMesh::hash() const
+{
+  auto h = hash64(_data.vertices, sizeof(vec3f) * _data.vertexCount);
+
+  return hash64(_data.triangles,
+    sizeof(Triangle) * _data.triangleCount,
+    h);
+}
+
+/**
+ * @brief Computes the vertex normals of this mesh as the normalized
+ * sums of the normals of the triangles using the vertices.
+ *
+ * For large meshes, the triangles are split into (at most)
+ * maxPartialSums ranges, one per thread, whose normals are summed
+ * in parallel, each range into its own array. The arrays are then
+ * reduced in range order, in parallel over the vertices. The sums
+ * depend on the number of threads only, but they may differ from
+ * the ones of the serial loop in the last bits.
+ */
 void
 TriangleMesh::computeNormals()
 {
@@ -75,6 +351,51 @@ TriangleMesh::computeNormals()
   if (_data.vertexNormals == nullptr)
     _data.vertexNormals = new vec3f[nv];
 
+  auto nt = _data.triangleCount;
+
+  if (size_t(nt) >= parallelThreshold)
+  {
+    auto n = std::min<size_t>(parallelThreadCount(), maxPartialSums);
+    auto range = (size_t(nt) + n - 1) / n;
+    // The first range is summed into the vertex normals
+    std::vector<std::vector<vec3f>> sums(n - 1);
+
+    parallelFor(nt, range, [&, this](size_t begin, size_t end)
+      {
+        auto r = begin / range;
+        auto s = _data.vertexNormals;
+
+        if (r > 0)
+        {
+          sums[r - 1].assign(nv, vec3f::null());
+          s = sums[r - 1].data();
+        }
+        else
+          std::fill(s, s + nv, vec3f::null());
+        for (auto i = begin; i < end; ++i)
+        {
+          auto t = _data.triangles[i].v;
+          auto normal = triangle::normal(_data.vertices, t[0], t[1], t[2]);
+
+          s[t[0]] += normal;
+          s[t[1]] += normal;
+          s[t[2]] += normal;
+        }
+      });
+    forEachRange(nv, [&, this](size_t begin, size_t end)
+      {
+        for (auto v = begin; v < end; ++v)
+        {
+          auto& normal = _data.vertexNormals[v];
+
+          for (const auto& s : sums)
+            normal += s[v];
+          normal.normalize();
+        }
+      });
+    return;
+  }
+
   auto t = _data.triangles;
 
   memset(_data.vertexNormals, 0, nv * sizeof(vec3f));
@@ -96,18 +417,20 @@ TriangleMesh::computeNormals()
 void
 TriangleMesh::TRS(const mat4f& trs)
 {
-  auto nv = _data.vertexCount;
-
-  for (int i = 0; i < nv; ++i)
-    _data.vertices[i] = trs.transform3x4(_data.vertices[i]);
-  _bounds.setEmpty();
-  if (_data.vertexNormals == nullptr)
-    return;
-
   auto r = normalTRS(trs);
+  auto normals = _data.vertexNormals;
 
-  for (int i = 0; i < nv; ++i)
-    _data.vertexNormals[i] = (r * _data.vertexNormals[i]).versor();
+  // The vertices are transformed in batches, in parallel
+  forEachRange(_data.vertexCount, [&, this](size_t begin, size_t end)
+    {
+      transformPoints(_data.vertices, begin, end, trs);
+      if (normals != nullptr)
+        transformNormals(normals, begin, end, r);
+    });
+  _bounds.setEmpty();
+  _source = nullptr;
+  lod = nullptr;
+  clusters = nullptr;
 }
 
 void
@@ -123,6 +446,69 @@ TriangleMesh::normalize()
     *v = (*v - c) * m;
   s *= m * 0.5f;
   _bounds.set(-s, s);
+  _source = nullptr;
+  lod = nullptr;
+  clusters = nullptr;
+}
+
+namespace
+{ // begin namespace
+
+// Permutes the n elements of a such that a[i] = old a[order[i]].
+// The elements are permuted in place in the storage of a, which can
+// be in the pages of a mapped file.
+template <typename T>
+void
+gather(T* a, const int* order, int n)
+{
+  if (a == nullptr)
+    return;
+
+  std::vector<T> t(a, a + n);
+
+  for (int i = 0; i < n; ++i)
+    a[i] = t[order[i]];
+}
+
+// Permutes the n elements of a such that a[remap[i]] = old a[i].
+template <typename T>
+void
+scatter(T* a, const int* remap, int n)
+{
+  if (a == nullptr)
+    return;
+
+  std::vector<T> t(a, a + n);
+
+  for (int i = 0; i < n; ++i)
+    a[remap[i]] = t[i];
+}
+
+} // end namespace
+
+void
+TriangleMesh::reorderTriangles(const int* order)
+{
+  gather(_data.triangles, order, _data.triangleCount);
+  _source = nullptr;
+  clusters = nullptr;
+}
+
+void
+TriangleMesh::remapVertices(const int* remap)
+{
+  auto nv = _data.vertexCount;
+
+  scatter(_data.vertices, remap, nv);
+  scatter(_data.vertexNormals, remap, nv);
+  scatter(_data.uv, remap, nv);
+
+  auto t = _data.triangles;
+
+  for (int i = 0; i < _data.triangleCount; ++i, ++t)
+    t->setVertices(remap[t->v[0]], remap[t->v[1]], remap[t->v[2]]);
+  _source = nullptr;
+  clusters = nullptr;
 }
 
 static inline void
@@ -0,0 +1,234 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: TriangleMeshAdjacency.cpp
+// ========
+// Source file for triangle mesh half-edge adjacency.
+//
+// Author: Paulo Pagliosa
+// Last revision: 18/10/2026
+
+#include "geometry/TriangleMeshAdjacency.h"
+#include "core/Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+namespace cg
+{ // begin namespace cg
+
+namespace
+{ // begin namespace
+
+constexpr size_t triangleGrainSize = 1 << 14;
+constexpr size_t vertexGrainSize = 1 << 12;
+
+inline auto
+atomic(int& x)
+{
+  return std::atomic_ref<int>{x};
+}
+
+// Calls f(h, v0, v1) for the half-edges h from v0 to v1 of the
+// triangles in parallel
+template <typename F>
+void
+forEachHalfEdge(const TriangleMesh::Data& data, F&& f)
+{
+  parallelFor(data.triangleCount, triangleGrainSize,
+    [&](size_t begin, size_t end)
+    {
+      for (auto t = begin; t < end; ++t)
+      {
+        const auto& v = data.triangles[t].v;
+        auto h = int(3 * t);
+
+        f(h, v[0], v[1]);
+        f(h + 1, v[1], v[2]);
+        f(h + 2, v[2], v[0]);
+      }
+    });
+}
+
+// Calls f(begin, end) for the runs of keys with the same upper
+// 32 bits in [begin, end)
+template <typename F>
+void
+forEachRun(const uint64_t* begin, const uint64_t* end, F&& f)
+{
+  while (begin < end)
+  {
+    auto last = begin + 1;
+
+    while (last < end && (*last >> 32) == (*begin >> 32))
+      ++last;
+    f(begin, last);
+    begin = last;
+  }
+}
+
+} // end namespace
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// TriangleMeshAdjacency implementation
+// =====================
+TriangleMeshAdjacency::TriangleMeshAdjacency(const TriangleMesh::Data& data):
+  _halfEdges{data.triangleCount * 3},
+  _vertexHalfEdges{data.vertexCount}
+{
+  const auto nh = data.triangleCount * 3;
+  const auto nv = data.vertexCount;
+  auto origins = _halfEdges.data<0>();
+  auto twins = _halfEdges.data<1>();
+  auto edges = _halfEdges.data<2>();
+
+  // Bucket the half-edges by their smaller end vertex
+  std::vector<int> offsets(nv + 1);
+
+  forEachHalfEdge(data, [&](int h, int v0, int v1)
+    {
+      origins[h] = v0;
+      atomic(offsets[std::min(v0, v1) + 1]).fetch_add(1,
+        std::memory_order_relaxed);
+    });
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+  // The key of a half-edge is its greater end vertex and its index
+  std::unique_ptr<uint64_t[]> keys{new uint64_t[nh]};
+  std::vector<int> counts(offsets.begin(), offsets.end());
+
+  forEachHalfEdge(data, [&](int h, int v0, int v1)
+    {
+      auto [lo, hi] = std::minmax(v0, v1);
+      auto i = atomic(counts[lo]).fetch_add(1, std::memory_order_relaxed);
+
+      keys[i] = uint64_t(hi) << 32 | uint32_t(h);
+    });
+
+  // Sort the buckets and count their edges. Sorting by half-edge
+  // index within an edge makes the result deterministic
+  auto bucket = [&](int v)
+  {
+    return std::pair{keys.get() + offsets[v], keys.get() + offsets[v + 1]};
+  };
+
+  parallelFor(nv, vertexGrainSize, [&](size_t begin, size_t end)
+    {
+      for (auto v = int(begin); v < int(end); ++v)
+      {
+        auto [first, last] = bucket(v);
+        int n{};
+
+        std::sort(first, last);
+        forEachRun(first, last, [&](auto, auto) { ++n; });
+        counts[v] = n;
+      }
+    });
+  counts[nv] = 0;
+  std::exclusive_scan(counts.begin(), counts.end(), counts.begin(), 0);
+  _edges.reallocate(counts[nv]);
+
+  // Number the edges and match the half-edges of each one
+  auto edgeHalfEdges = _edges.data<0>();
+  auto valences = _edges.data<1>();
+  std::atomic<int> boundaryEdgeCount{0};
+  std::atomic<int> nonManifoldEdgeCount{0};
+
+  parallelFor(nv, vertexGrainSize, [&](size_t begin, size_t end)
+    {
+      int nb{};
+      int nn{};
+
+      for (auto v = int(begin); v < int(end); ++v)
+      {
+        auto [first, last] = bucket(v);
+        auto e = counts[v];
+
+        forEachRun(first, last, [&](auto i, auto j)
+          {
+            auto n = int(j - i);
+
+            edgeHalfEdges[e] = int(uint32_t(*i));
+            valences[e] = n;
+            for (auto k = i; k < j; ++k)
+            {
+              auto h = int(uint32_t(*k));
+
+              edges[h] = e;
+              twins[h] = n == 2 ? int(uint32_t(i[k == i])) : none;
+            }
+            nb += n == 1;
+            nn += n > 2;
+            ++e;
+          });
+      }
+      boundaryEdgeCount += nb;
+      nonManifoldEdgeCount += nn;
+    });
+  _boundaryEdgeCount = boundaryEdgeCount;
+  _nonManifoldEdgeCount = nonManifoldEdgeCount;
+
+  // Pick the smallest outgoing half-edge of each vertex, preferring
+  // one without twin
+  auto vertexHalfEdges = _vertexHalfEdges.data<0>();
+
+  std::fill_n(vertexHalfEdges, nv, INT_MAX);
+  parallelFor(nh, triangleGrainSize, [&](size_t begin, size_t end)
+    {
+      for (auto h = int(begin); h < int(end); ++h)
+      {
+        auto key = twins[h] == none ? h : h + nh;
+        auto x = atomic(vertexHalfEdges[origins[h]]);
+        auto current = x.load(std::memory_order_relaxed);
+
+        while (key < current && !x.compare_exchange_weak(current, key))
+          ;
+      }
+    });
+  parallelFor(nv, vertexGrainSize, [&](size_t begin, size_t end)
+    {
+      for (auto v = begin; v < end; ++v)
+      {
+        auto& h = vertexHalfEdges[v];
+
+        h = h == INT_MAX ? none : h >= nh ? h - nh : h;
+      }
+    });
+}
+
+size_t
+TriangleMeshAdjacency::memorySize() const
+{
+  return sizeof(int) *
+    (3 * size_t(halfEdgeCount()) + 2 * size_t(edgeCount()) + vertexCount());
+}
+
+} // end namespace cg
@@ -28,29 +28,243 @@
 // Source file for triangle mesh BVH.
 //
 // Author: Paulo Pagliosa
-// Last revision: 22/07/2025
+// Last revision: 19/10/2026
 
+#include "core/Hash.h"
+#include "core/Parallel.h"
 #include "geometry/TriangleMeshBVH.h"
+#include "geometry/TriangleMeshFile.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#define BVH_USE_SSE
+#include <immintrin.h>
+#endif
 
 namespace cg
 { // begin namespace cg
 
 
+namespace
+{ // begin namespace
+
+#ifdef BVH_USE_SSE
+//
+// SIMD operations on N float lanes used by the intersection of
+// packed triangles.
+//
+template <int N> struct Lanes;
+
+template <>
+struct Lanes<4>
+{
+  using type = __m128;
+
+  static auto load(const float* p) { return _mm_load_ps(p); }
+  static auto set1(float x) { return _mm_set1_ps(x); }
+  static auto add(type a, type b) { return _mm_add_ps(a, b); }
+  static auto sub(type a, type b) { return _mm_sub_ps(a, b); }
+  static auto mul(type a, type b) { return _mm_mul_ps(a, b); }
+  static auto div(type a, type b) { return _mm_div_ps(a, b); }
+  static auto lt(type a, type b) { return _mm_cmplt_ps(a, b); }
+  static auto gt(type a, type b) { return _mm_cmpgt_ps(a, b); }
+  static auto le(type a, type b) { return _mm_cmple_ps(a, b); }
+  static auto bitOr(type a, type b) { return _mm_or_ps(a, b); }
+  static auto andNot(type a, type b) { return _mm_andnot_ps(a, b); }
+  static auto mask(type a) { return _mm_movemask_ps(a); }
+  static void store(float* p, type a) { _mm_storeu_ps(p, a); }
+
+}; // Lanes<4>
+
+#ifdef __AVX__
+template <>
+struct Lanes<8>
+{
+  using type = __m256;
+
+  static auto load(const float* p) { return _mm256_load_ps(p); }
+  static auto set1(float x) { return _mm256_set1_ps(x); }
+  static auto add(type a, type b) { return _mm256_add_ps(a, b); }
+  static auto sub(type a, type b) { return _mm256_sub_ps(a, b); }
+  static auto mul(type a, type b) { return _mm256_mul_ps(a, b); }
+  static auto div(type a, type b) { return _mm256_div_ps(a, b); }
+  static auto lt(type a, type b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static auto gt(type a, type b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+  static auto le(type a, type b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+  static auto bitOr(type a, type b) { return _mm256_or_ps(a, b); }
+  static auto andNot(type a, type b) { return _mm256_andnot_ps(a, b); }
+  static auto mask(type a) { return _mm256_movemask_ps(a); }
+  static void store(float* p, type a) { _mm256_storeu_ps(p, a); }
+
+}; // Lanes<8>
+#endif // __AVX__
+
+//
+// Intersects a ray with N packed triangles. g points to the first
+// lane of the vertex p0 of a triangle group, whose rows are the
+// components of p0, e1 and e2. The operations are the ones of
+// triangle::intersectEdges(), in the same order, hence the results
+// are the same. Returns the mask of the triangles hit.
+//
+template <int N>
+inline int
+intersectLanes(const float* g,
+  int stride,
+  const Ray3f& ray,
+  float* t,
+  float* b1,
+  float* b2)
+{
+  using L = Lanes<N>;
+
+  auto row = [g, stride](int i) { return L::load(g + i * stride); };
+  const auto dx = L::set1(ray.direction.x);
+  const auto dy = L::set1(ray.direction.y);
+  const auto dz = L::set1(ray.direction.z);
+  const auto e1x = row(3);
+  const auto e1y = row(4);
+  const auto e1z = row(5);
+  const auto e2x = row(6);
+  const auto e2y = row(7);
+  const auto e2z = row(8);
+  const auto zero = L::set1(0);
+  const auto one = L::set1(1);
+
+  // s1 = d x e2
+  auto s1x = L::sub(L::mul(dy, e2z), L::mul(dz, e2y));
+  auto s1y = L::sub(L::mul(dz, e2x), L::mul(dx, e2z));
+  auto s1z = L::sub(L::mul(dx, e2y), L::mul(dy, e2x));
+  auto det = L::add(L::add(L::mul(s1x, e1x), L::mul(s1y, e1y)),
+    L::mul(s1z, e1z));
+  auto invalid = L::le(L::andNot(L::set1(-0.f), det),
+    L::set1(math::Limits<float>::eps()));
+  auto invDet = L::div(one, det);
+
+  // First barycentric coordinate
+  auto sx = L::sub(L::set1(ray.origin.x), row(0));
+  auto sy = L::sub(L::set1(ray.origin.y), row(1));
+  auto sz = L::sub(L::set1(ray.origin.z), row(2));
+  auto u = L::mul(L::add(L::add(L::mul(sx, s1x), L::mul(sy, s1y)),
+    L::mul(sz, s1z)), invDet);
+
+  invalid = L::bitOr(invalid, L::bitOr(L::lt(u, zero), L::gt(u, one)));
+
+  // Second barycentric coordinate; s2 = s x e1
+  auto s2x = L::sub(L::mul(sy, e1z), L::mul(sz, e1y));
+  auto s2y = L::sub(L::mul(sz, e1x), L::mul(sx, e1z));
+  auto s2z = L::sub(L::mul(sx, e1y), L::mul(sy, e1x));
+  auto v = L::mul(L::add(L::add(L::mul(dx, s2x), L::mul(dy, s2y)),
+    L::mul(dz, s2z)), invDet);
+
+  invalid = L::bitOr(invalid,
+    L::bitOr(L::lt(v, zero), L::gt(L::add(u, v), one)));
+
+  // Distance to the intersection point
+  auto d = L::mul(L::add(L::add(L::mul(e2x, s2x), L::mul(e2y, s2y)),
+    L::mul(e2z, s2z)), invDet);
+
+  invalid = L::bitOr(invalid, L::bitOr(L::lt(d, L::set1(ray.tMin)),
+    L::gt(d, L::set1(ray.tMax))));
+  L::store(t, d);
+  L::store(b1, u);
+  L::store(b2, v);
+  return ~L::mask(invalid) & ((1 << N) - 1);
+}
+#endif // BVH_USE_SSE
+
+//
+// Intersects a ray with the 8 triangles of a group. See
+// intersectLanes().
+//
+inline int
+intersectGroup(const float* g,
+  const int32_t* ids,
+  const Ray3f& ray,
+  float* t,
+  float* b1,
+  float* b2)
+{
+  constexpr int n = 8;
+
+#if defined(__AVX__)
+  (void)ids;
+  return intersectLanes<8>(g, n, ray, t, b1, b2);
+#elif defined(BVH_USE_SSE)
+  (void)ids;
+
+  auto lo = intersectLanes<4>(g, n, ray, t, b1, b2);
+  auto hi = intersectLanes<4>(g + 4, n, ray, t + 4, b1 + 4, b2 + 4);
+
+  return lo | hi << 4;
+#else
+  auto mask = 0;
+
+  for (int i = 0; i < n; ++i)
+  {
+    auto row = [g, i](int r) { return g[r * n + i]; };
+    vec3f p0{row(0), row(1), row(2)};
+    vec3f e1{row(3), row(4), row(5)};
+    vec3f e2{row(6), row(7), row(8)};
+    vec3f b;
+
+    if (ids[i] >= 0 && triangle::intersectEdges(ray, p0, e1, e2, b, t[i]))
+    {
+      b1[i] = b.y;
+      b2[i] = b.z;
+      mask |= 1 << i;
+    }
+  }
+  return mask;
+#endif
+}
+
+} // end namespace
+
+
 /////////////////////////////////////////////////////////////////////
 //
 // TriangleMeshBVH implementation
 // ===============
+std::string TriangleMeshBVH::_cacheDirectory;
+
 TriangleMeshBVH::TriangleMeshBVH(const TriangleMesh& mesh,
   uint32_t maxTrianglesPerNode,
-  SplitMethod splitMethod):
-  BVHBase{maxTrianglesPerNode, splitMethod},
+  SplitMethod splitMethod,
+  NodeLayout layout,
+  float duplicationBudget):
+  TriangleMeshBVH{mesh,
+    maxTrianglesPerNode,
+    splitMethod,
+    layout,
+    duplicationBudget,
+    0}
+{
+  buildNodes();
+}
+
+TriangleMeshBVH::TriangleMeshBVH(const TriangleMesh& mesh,
+  uint32_t maxTrianglesPerNode,
+  SplitMethod splitMethod,
+  NodeLayout layout,
+  float duplicationBudget,
+  int):
+  BVHBase{maxTrianglesPerNode, splitMethod, layout, duplicationBudget},
   _mesh{&mesh}
+{
+  assert(mesh.data().triangleCount > 0);
+}
+
+void
+TriangleMeshBVH::buildNodes(bool layout)
 {
   const auto& m = _mesh->data();
   auto nt = (uint32_t)m.triangleCount;
-
-  assert(nt > 0);
-
   PrimitiveInfoArray primitiveInfo(nt);
 
   for (uint32_t i = 0; i < nt; ++i)
@@ -63,7 +277,7 @@ TriangleMeshBVH::TriangleMeshBVH(const TriangleMesh& mesh,
     b.inflate(m.vertices[t->v[2]]);
     primitiveInfo[i] = {i, b};
   }
-  build(primitiveInfo);
+  BVHBase::build(primitiveInfo, layout);
 #ifdef _DEBUG
   if (true)
   {
@@ -71,6 +285,9 @@ TriangleMeshBVH::TriangleMeshBVH(const TriangleMesh& mesh,
     printf("Mesh triangles: %d\n", nt);
     bounds().print("BVH bounds:");
     printf("BVH nodes: %zd\n", size());
+    printf("BVH triangle references: %u\n", referenceCount());
+    printf("BVH SAH cost: %g\n", sahCost());
+    printf("BVH memory: %zu bytes\n", memorySize());
     /*
     iterate([this](const BVHNodeInfo& node)
     {
@@ -85,11 +302,290 @@ TriangleMeshBVH::TriangleMeshBVH(const TriangleMesh& mesh,
 #endif // _DEBUG
 }
 
+/**
+ * @brief Makes a BVH for \p mesh.
+ *
+ * If the BVH cache is enabled, the nodes of the BVH are adopted
+ * from the cache file keyed by the hash of the vertices and
+ * triangles of the mesh and the build parameters. A missing,
+ * stale or corrupted cache file is replaced by the nodes of a
+ * newly built BVH.
+ */
+TriangleMeshBVH*
+TriangleMeshBVH::make(const TriangleMesh& mesh,
+  uint32_t maxTrianglesPerNode,
+  SplitMethod splitMethod,
+  NodeLayout layout,
+  float duplicationBudget)
+{
+  std::unique_ptr<TriangleMeshBVH> bvh{new TriangleMeshBVH{mesh,
+    maxTrianglesPerNode,
+    splitMethod,
+    layout,
+    duplicationBudget,
+    0}};
+
+  bvh->makeNodes();
+  return bvh.release();
+}
+
+TriangleMeshBVH*
+TriangleMeshBVH::make(const TriangleMesh& mesh,
+  MappedFile& file,
+  size_t offset,
+  size_t size,
+  uint64_t key,
+  uint32_t maxTrianglesPerNode,
+  SplitMethod splitMethod,
+  NodeLayout layout,
+  float duplicationBudget)
+{
+  std::unique_ptr<TriangleMeshBVH> bvh{new TriangleMeshBVH{mesh,
+    maxTrianglesPerNode,
+    splitMethod,
+    layout,
+    duplicationBudget,
+    0}};
+
+  if (!bvh->read(file, offset, size, key, mesh.data().triangleCount))
+    bvh->buildNodes();
+  return bvh.release();
+}
+
+/**
+ * @brief Builds the nodes of this BVH or reads them from the BVH
+ * cache. See make().
+ *
+ * If the mesh was read from a triangle mesh file with a BVH built
+ * with the same parameters, the nodes of the file are adopted.
+ */
+void
+TriangleMeshBVH::makeNodes()
+{
+  if (auto file = _mesh->source())
+    if (auto header = TriangleMeshFileHeader::get(*file))
+    {
+      const auto& bvh = header->sections[TriangleMeshFileHeader::BVH];
+
+      if (bvh.size > 0 && read(*file,
+        bvh.offset,
+        bvh.size,
+        header->checksum,
+        _mesh->data().triangleCount))
+        return;
+    }
+  if (_cacheDirectory.empty())
+  {
+    buildNodes();
+    return;
+  }
+
+  namespace fs = std::filesystem;
+
+  auto key = _mesh->hash();
+  char name[24];
+
+  // The file name also depends on the build parameters, hence
+  // BVHs of the same mesh built differently do not replace each
+  // other in the cache.
+  {
+    auto h = hashCombine(key, maxPrimitivesPerNode());
+
+    h = hashCombine(h, splitMethod());
+    if (splitMethod() == Spatial)
+      h = hashCombine(h, duplicationBudget());
+    snprintf(name, sizeof name, "%016llx.bvh", (unsigned long long)h);
+  }
+
+  auto filename = (fs::path{_cacheDirectory} / name).string();
+
+  if (read(filename.c_str(), key, _mesh->data().triangleCount))
+  {
+#ifdef _DEBUG
+    printf("**BVH for mesh %d read from %s\n", _mesh->id, filename.c_str());
+#endif // _DEBUG
+    return;
+  }
+  // The cache file stores the binary nodes, which are replaced by
+  // the nodes of a quantized layout.
+  buildNodes(false);
+
+  std::error_code ec;
+
+  fs::create_directories(_cacheDirectory, ec);
+  if (!write(filename.c_str(), key))
+    fprintf(stderr, "Unable to write BVH cache file %s\n", filename.c_str());
+  makeLayout();
+}
+
+/**
+ * @brief Computes the bounds of the parts of the triangle \p index
+ * on each side of the plane perpendicular to the axis \p dim at
+ * \p position by clipping the triangle edges against the plane.
+ */
+bool
+TriangleMeshBVH::splitPrimitive(uint32_t index,
+  int dim,
+  float position,
+  Bounds3f& left,
+  Bounds3f& right) const
+{
+  const auto& m = _mesh->data();
+  auto v = m.triangles[index].v;
+
+  left.setEmpty();
+  right.setEmpty();
+  for (int i = 0; i < 3; ++i)
+  {
+    const auto& p = m.vertices[v[i]];
+    const auto& q = m.vertices[v[i == 2 ? 0 : i + 1]];
+    auto a = p[dim];
+    auto b = q[dim];
+
+    if (a <= position)
+      left.inflate(p);
+    if (a >= position)
+      right.inflate(p);
+    if ((a < position && b > position) || (a > position && b < position))
+    {
+      auto c = p + (q - p) * ((position - a) / (b - a));
+
+      c[dim] = position;
+      left.inflate(c);
+      right.inflate(c);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Packs the triangles of each leaf of this BVH in groups of
+ * TriangleGroup::size triangles stored in SoA form, along with
+ * their first vertices and edges, if \p packed is true; otherwise,
+ * releases the groups.
+ *
+ * A leaf whose triangles are packed is intersected by a ray with
+ * one SIMD test (AVX or two SSE tests) per group, which avoids the
+ * indirections through the triangle and vertex arrays of the mesh.
+ * The results are the same as the ones of the unpacked triangles.
+ * See packedTriangleMemorySize() for the memory cost.
+ */
+void
+TriangleMeshBVH::setPackedTriangles(bool packed)
+{
+  constexpr auto n = TriangleGroup::size;
+
+  std::vector<TriangleGroup>{}.swap(_groups);
+  std::vector<uint32_t>{}.swap(_firstGroup);
+  if (!packed || empty())
+    return;
+
+  const auto& m = _mesh->data();
+
+  _firstGroup.resize(referenceCount());
+  iterateLeaves([&, this](uint32_t first, uint32_t count)
+    {
+      _firstGroup[first] = (uint32_t)_groups.size();
+      for (uint32_t i = 0; i < count; i += n)
+      {
+        auto& g = _groups.emplace_back();
+
+        std::memset(&g, 0, sizeof g);
+        for (uint32_t k = 0; k < n; ++k)
+        {
+          if (i + k >= count)
+          {
+            g.ids[k] = -1;
+            continue;
+          }
+
+          auto tid = primitiveId(first + i + k);
+          auto v = m.triangles[tid].v;
+          const auto& p0 = m.vertices[v[0]];
+          auto e1 = m.vertices[v[1]] - p0;
+          auto e2 = m.vertices[v[2]] - p0;
+
+          for (int j = 0; j < 3; ++j)
+          {
+            g.p0[j][k] = p0[j];
+            g.e1[j][k] = e1[j];
+            g.e2[j][k] = e2[j];
+          }
+          g.ids[k] = (int32_t)tid;
+        }
+      }
+    });
+}
+
+/// Returns the number of bytes used by the packed triangles.
+size_t
+TriangleMeshBVH::packedTriangleMemorySize() const
+{
+  return _groups.size() * sizeof(TriangleGroup) +
+    _firstGroup.size() * sizeof(uint32_t);
+}
+
+bool
+TriangleMeshBVH::intersectGroups(uint32_t first,
+  uint32_t count,
+  const Ray3f& ray) const
+{
+  constexpr auto n = TriangleGroup::size;
+  auto g = _groups.data() + _firstGroup[first];
+  alignas(32) float t[n];
+  alignas(32) float b1[n];
+  alignas(32) float b2[n];
+
+  for (auto e = g + (count + n - 1) / n; g < e; ++g)
+    if (intersectGroup(&g->p0[0][0], g->ids, ray, t, b1, b2) != 0)
+      return true;
+  return false;
+}
+
+void
+TriangleMeshBVH::intersectGroups(uint32_t first,
+  uint32_t count,
+  const Ray3f& ray,
+  Intersection& hit) const
+{
+  constexpr auto n = TriangleGroup::size;
+  auto g = _groups.data() + _firstGroup[first];
+  alignas(32) float t[n];
+  alignas(32) float b1[n];
+  alignas(32) float b2[n];
+  auto hitCount = 0;
+
+  for (auto e = g + (count + n - 1) / n; g < e; ++g)
+  {
+    auto mask = intersectGroup(&g->p0[0][0], g->ids, ray, t, b1, b2);
+
+    // Visit the triangles hit in the order of the leaf, as the
+    // unpacked test does.
+    for (; mask != 0; mask &= mask - 1)
+    {
+      auto i = std::countr_zero((unsigned)mask);
+
+      if (t[i] < hit.distance)
+      {
+        hit.triangleIndex = g->ids[i];
+        hit.distance = t[i];
+        hit.p.set(1 - b1[i] - b2[i], b1[i], b2[i]);
+        hitCount++;
+      }
+    }
+  }
+  if (hitCount > 0)
+    hit.object = _mesh;
+}
+
 bool
 TriangleMeshBVH::intersectLeaf(uint32_t first,
   uint32_t count,
   const Ray3f& ray) const
 {
+  if (packedTriangles())
+    return intersectGroups(first, count, ray);
+
   const auto& m = _mesh->data();
 
   for (auto i = first, e = i + count; i < e; ++i)
@@ -114,6 +610,12 @@ TriangleMeshBVH::intersectLeaf(uint32_t first,
   const Ray3f& ray,
   Intersection& hit) const
 {
+  if (packedTriangles())
+  {
+    intersectGroups(first, count, ray, hit);
+    return;
+  }
+
   const auto& m = _mesh->data();
   auto hitCount = 0;
 
@@ -139,4 +641,231 @@ TriangleMeshBVH::intersectLeaf(uint32_t first,
     hit.object = _mesh;
 }
 
+void
+TriangleMeshBVH::intersectLeaf(uint32_t first,
+  uint32_t count,
+  const RayPacket& packet) const
+{
+  if (packedTriangles())
+  {
+    BVHBase::intersectLeaf(first, count, packet);
+    return;
+  }
+
+  const auto& m = _mesh->data();
+
+  // Fetch each triangle once and intersect it with all rays.
+  for (auto i = first, e = i + count; i < e; ++i)
+  {
+    auto tid = primitiveId(i);
+    auto v = m.triangles[tid].v;
+    const auto& p0 = m.vertices[v[0]];
+    const auto& p1 = m.vertices[v[1]];
+    const auto& p2 = m.vertices[v[2]];
+
+    for (uint32_t k = 0; k < packet.size; ++k)
+    {
+      auto r = packet.indices[k];
+      vec3f b;
+      float t;
+
+      if (packet.isOcclusion())
+      {
+        if (!packet.occluded[r] &&
+          triangle::intersect(packet.rays[r], p0, p1, p2, b, t))
+          packet.occluded[r] = true;
+      }
+      else if (triangle::intersect(packet.rays[r], p0, p1, p2, b, t))
+      {
+        auto& hit = packet.hits[r];
+
+        if (t < hit.distance)
+        {
+          hit.object = _mesh;
+          hit.triangleIndex = tid;
+          hit.distance = t;
+          hit.p = b;
+        }
+      }
+    }
+  }
+}
+
+void
+TriangleMeshBVH::closestPointLeaf(uint32_t first,
+  uint32_t count,
+  const vec3f& p,
+  ClosestPoint& result) const
+{
+  const auto& m = _mesh->data();
+  auto d2Min = math::sqr(result.distance);
+
+  for (auto i = first, e = i + count; i < e; ++i)
+  {
+    auto tid = primitiveId(i);
+    auto v = m.triangles[tid].v;
+    const auto& p0 = m.vertices[v[0]];
+    const auto& p1 = m.vertices[v[1]];
+    const auto& p2 = m.vertices[v[2]];
+    vec3f b;
+    auto q = triangle::closestPoint(p, p0, p1, p2, b);
+    auto d2 = (q - p).squaredNorm();
+
+    if (d2 < d2Min)
+    {
+      d2Min = d2;
+      result.object = _mesh;
+      result.triangleIndex = tid;
+      result.distance = std::sqrt(d2);
+      result.position = q;
+      result.p = b;
+    }
+  }
+}
+
+/**
+ * @brief Computes the angle weighted pseudonormals of the vertices
+ * and the pseudonormals of the edges of the mesh.
+ *
+ * The pseudonormal of an edge is the sum of the normals of the
+ * triangles sharing it. The pseudonormals are not normalized since
+ * only the signs of their dot products are used.
+ */
+void
+TriangleMeshBVH::makePseudonormals() const
+{
+  const auto& m = _mesh->data();
+  auto nt = (uint32_t)m.triangleCount;
+  std::unordered_map<uint64_t, vec3f> edges;
+
+  _vertexNormals.assign(m.vertexCount, vec3f::null());
+  _edgeNormals.resize(3 * (size_t)nt);
+  edges.reserve(3 * (size_t)nt / 2);
+
+  auto edgeKey = [](uint32_t a, uint32_t b)
+    {
+      if (a > b)
+        std::swap(a, b);
+      return uint64_t(a) << 32 | b;
+    };
+
+  for (uint32_t t = 0; t < nt; ++t)
+  {
+    auto v = m.triangles[t].v;
+    vec3f p[3]{m.vertices[v[0]], m.vertices[v[1]], m.vertices[v[2]]};
+    auto n = triangle::normal(p[0], p[1], p[2]);
+
+    for (int i = 0; i < 3; ++i)
+    {
+      auto j = i == 2 ? 0 : i + 1;
+      auto k = j == 2 ? 0 : j + 1;
+      auto c = (p[j] - p[i]).versor().dot((p[k] - p[i]).versor());
+
+      _vertexNormals[v[i]] += n * std::acos(std::clamp(c, -1.f, 1.f));
+      auto e = edges.try_emplace(edgeKey(v[i], v[j]), vec3f::null()).first;
+
+      e->second += n;
+    }
+  }
+  for (uint32_t t = 0; t < nt; ++t)
+  {
+    auto v = m.triangles[t].v;
+
+    for (int i = 0; i < 3; ++i)
+      _edgeNormals[3 * t + i] = edges[edgeKey(v[i], v[i == 2 ? 0 : i + 1])];
+  }
+}
+
+/**
+ * @brief Returns the signed distance from \p p to the mesh.
+ *
+ * The distance is negative if \p p is inside the mesh, which is
+ * decided by the side of the pseudonormal of the feature (face,
+ * edge or vertex) of the mesh containing the closest point
+ * (Baerentzen and Aanaes, 2005). The sign is meaningful only if the
+ * mesh is closed and consistently oriented. If no point of the
+ * mesh is closer to \p p than \p maxDistance, \p maxDistance is
+ * returned.
+ */
+float
+TriangleMeshBVH::signedDistance(const vec3f& p, float maxDistance) const
+{
+  ClosestPoint c;
+
+  if (!closestPoint(p, c, maxDistance))
+    return maxDistance;
+  std::call_once(_pseudonormalFlag, [this]() { makePseudonormals(); });
+
+  const auto& b = c.p;
+  auto v = _mesh->data().triangles[c.triangleIndex].v;
+  vec3f n;
+
+  // Vertex and edge regions have exactly zero coordinates for the
+  // vertices not in the feature.
+  if (b.y == 0 && b.z == 0)
+    n = _vertexNormals[v[0]];
+  else if (b.x == 0 && b.z == 0)
+    n = _vertexNormals[v[1]];
+  else if (b.x == 0 && b.y == 0)
+    n = _vertexNormals[v[2]];
+  else if (b.z == 0)
+    n = _edgeNormals[3 * c.triangleIndex];
+  else if (b.x == 0)
+    n = _edgeNormals[3 * c.triangleIndex + 1];
+  else if (b.y == 0)
+    n = _edgeNormals[3 * c.triangleIndex + 2];
+  else
+  {
+    const auto* vertices = _mesh->data().vertices;
+    n = triangle::normal(vertices, v);
+  }
+  return (p - c.position).dot(n) < 0 ? -c.distance : c.distance;
+}
+
+/**
+ * @brief Computes the signed distance from every point in \p points
+ * to the mesh in parallel.
+ *
+ * See signedDistance(const vec3f&, float).
+ */
+void
+TriangleMeshBVH::signedDistance(std::span<const vec3f> points,
+  std::span<float> distances,
+  float maxDistance) const
+{
+  assert(distances.size() >= points.size());
+  parallelFor(points.size(), 256, [&, this](size_t begin, size_t end)
+    {
+      for (auto i = begin; i < end; ++i)
+        distances[i] = signedDistance(points[i], maxDistance);
+    });
+}
+
+/**
+ * @brief Sets every cell of \p grid to the signed distance from its
+ * center to the mesh.
+ *
+ * The cells are computed in parallel, in slices of consecutive
+ * cells. If \p maxDistance is finite, the cells farther than it
+ * from the mesh, whose sign is unknown, are set to \p maxDistance
+ * (narrow band).
+ */
+void
+TriangleMeshBVH::signedDistance(RegionGrid3<float, float>& grid,
+  float maxDistance) const
+{
+  const auto h = grid.cellSize() * 0.5f;
+  auto n = (size_t)grid.length();
+
+  parallelFor(n, 256, [&, this](size_t begin, size_t end)
+    {
+      for (auto i = begin; i < end; ++i)
+      {
+        auto id = (int64_t)i;
+
+        grid[id] = signedDistance(grid.basePoint(id) + h, maxDistance);
+      }
+    });
+}
+
 } // end namespace cg
@@ -0,0 +1,420 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: TriangleMeshBVHCache.cpp
+// ========
+// Source file for triangle mesh BVH cache.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#include "geometry/TriangleMeshBVHCache.h"
+#include <algorithm>
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// TriangleMeshBVHCache implementation
+// ====================
+TriangleMeshBVHCache::~TriangleMeshBVHCache()
+{
+  wait();
+}
+
+/**
+ * @brief Returns the BVH of \p mesh.
+ *
+ * If the BVH is not in the cache, it is made by the calling thread
+ * with TriangleMeshBVH::make() defaults, hence it can be read from
+ * the BVH cache directory. If another thread is making it, the
+ * calling thread waits for it.
+ */
+Reference<TriangleMeshBVH>
+TriangleMeshBVHCache::get(const TriangleMesh& mesh)
+{
+  std::unique_lock lock{_lock};
+
+  evict();
+  for (auto it = find(mesh); it != _entries.end(); it = find(mesh))
+  {
+    if (it->state == State::Ready)
+    {
+      it->coarse = nullptr;
+      return it->bvh;
+    }
+    _built.wait(lock);
+  }
+
+  // Take a reference to the BVH before releasing the lock, hence
+  // it cannot be evicted before it is returned.
+  Reference<TriangleMeshBVH> bvh = startBuild(mesh)->bvh;
+
+  lock.unlock();
+  try
+  {
+    bvh->makeNodes();
+  }
+  catch (...)
+  {
+    finishBuild(&mesh, false, false);
+    throw;
+  }
+  finishBuild(&mesh, true, false);
+  lock.lock();
+  evict();
+  return bvh;
+}
+
+/**
+ * @brief Returns the BVH of \p mesh without waiting for it to be
+ * made.
+ *
+ * If the BVH is in the cache, \p complete is set to true and the
+ * BVH is returned. Otherwise, the BVH is made by a bounded pool of
+ * background threads, if not yet, \p complete is set to false, and
+ * a coarse BVH of \p mesh is returned. The caller should ask again
+ * for the BVH until it is complete.
+ *
+ * The coarse BVH is built by the median split method with leaves
+ * of up to max(coarseLeafSize, n / 64) of the n triangles of the
+ * mesh, hence it has at most a few levels and a small mesh is
+ * intersected by brute force. It is built about twice as fast as
+ * the complete BVH. It is built once, by the first caller; the
+ * other callers wait for it.
+ */
+Reference<TriangleMeshBVH>
+TriangleMeshBVHCache::getAsync(const TriangleMesh& mesh, bool& complete)
+{
+  std::unique_lock lock{_lock};
+
+  evict();
+
+  auto it = find(mesh);
+
+  // Wait for another thread building the coarse BVH
+  for (; it != _entries.end() && it->state == State::Building &&
+    it->coarse == nullptr && it->buildingCoarse; it = find(mesh))
+    _built.wait(lock);
+  if (it != _entries.end() && it->state == State::Ready)
+  {
+    complete = true;
+    it->coarse = nullptr;
+    return it->bvh;
+  }
+  complete = false;
+  if (it == _entries.end())
+  {
+    it = startBuild(mesh);
+
+    auto bvh = it->bvh.get();
+    auto m = &mesh;
+
+    ++_pending;
+    // The entry keeps the BVH alive while it is built.
+    _workers.push([this, bvh, m]()
+      {
+        auto ok = true;
+
+        try
+        {
+          bvh->makeNodes();
+        }
+        catch (...)
+        {
+          ok = false;
+        }
+        finishBuild(m, ok, true);
+      });
+  }
+  else if (it->coarse != nullptr)
+    return it->coarse;
+  it->buildingCoarse = true;
+  lock.unlock();
+
+  Reference<TriangleMeshBVH> coarse;
+  // The entry is looked up again, since it may have been removed
+  // meanwhile.
+  auto publish = [&]()
+    {
+      lock.lock();
+      if (auto mit = _map.find(&mesh); mit != _map.end())
+      {
+        auto& e = *mit->second;
+
+        e.buildingCoarse = false;
+        if (e.state == State::Building && e.coarse == nullptr)
+          e.coarse = coarse;
+      }
+      _built.notify_all();
+    };
+
+  try
+  {
+    auto leafSize = (uint32_t)mesh.data().triangleCount / 64;
+
+    coarse = new TriangleMeshBVH{mesh,
+      std::max(coarseLeafSize, leafSize),
+      BVHBase::Median};
+  }
+  catch (...)
+  {
+    publish();
+    throw;
+  }
+  publish();
+  return coarse;
+}
+
+/**
+ * @brief Sets the memory budget of this cache to \p budget bytes.
+ *
+ * The least recently used BVHs not referenced outside the cache
+ * are evicted while the memory used by the cached BVHs exceeds the
+ * budget. Eviction happens only in the threads asking for BVHs,
+ * hence the budget can be exceeded until the next request.
+ */
+void
+TriangleMeshBVHCache::setMemoryBudget(size_t budget)
+{
+  std::lock_guard lock{_lock};
+
+  _memoryBudget = budget;
+  evict();
+}
+
+/// Returns the number of bytes used by the BVHs in this cache.
+size_t
+TriangleMeshBVHCache::memorySize() const
+{
+  std::lock_guard lock{_lock};
+  return _memorySize;
+}
+
+/// Returns the number of bytes used by the cached BVH of \p mesh,
+/// or zero if there is no such BVH.
+size_t
+TriangleMeshBVHCache::memorySize(const TriangleMesh& mesh) const
+{
+  std::lock_guard lock{_lock};
+
+  if (auto mit = _map.find(&mesh); mit != _map.end())
+    if (auto& e = *mit->second; e.state == State::Ready)
+      return e.memorySize;
+  return 0;
+}
+
+/**
+ * @brief Returns the number of references to \p mesh held only by
+ * this cache.
+ *
+ * They are the references of the BVHs of \p mesh neither being
+ * built nor referenced outside the cache, which would be released
+ * by remove(). A mesh whose reference count exceeds this number is
+ * in use outside the cache.
+ */
+int
+TriangleMeshBVHCache::meshReferenceCount(const TriangleMesh& mesh) const
+{
+  std::lock_guard lock{_lock};
+  int n{};
+
+  if (auto mit = _map.find(&mesh); mit != _map.end())
+    if (auto& e = *mit->second; e.state != State::Building)
+    {
+      if (e.bvh != nullptr && e.bvh->SharedObject::referenceCount() == 1)
+        ++n;
+      if (e.coarse != nullptr &&
+        e.coarse->SharedObject::referenceCount() == 1)
+        ++n;
+    }
+  return n;
+}
+
+/**
+ * @brief Removes the BVH of \p mesh from this cache.
+ *
+ * A BVH being built or referenced outside the cache is kept.
+ * Returns true if the BVH has been removed.
+ */
+bool
+TriangleMeshBVHCache::remove(const TriangleMesh& mesh)
+{
+  std::lock_guard lock{_lock};
+  auto mit = _map.find(&mesh);
+
+  if (mit == _map.end())
+    return false;
+
+  auto it = mit->second;
+
+  if (it->state == State::Building ||
+    (it->bvh != nullptr && it->bvh->SharedObject::referenceCount() > 1))
+    return false;
+  if (it->state == State::Ready)
+    _memorySize -= it->memorySize;
+  _map.erase(mit);
+  _entries.erase(it);
+  return true;
+}
+
+/// Returns the number of BVHs in this cache, including the ones
+/// being built.
+size_t
+TriangleMeshBVHCache::size() const
+{
+  std::lock_guard lock{_lock};
+  return _map.size();
+}
+
+/// Waits for the background builds of this cache to finish.
+void
+TriangleMeshBVHCache::wait()
+{
+  std::unique_lock lock{_lock};
+
+  _built.wait(lock, [this]() { return _pending == 0; });
+}
+
+/**
+ * @brief Removes all BVHs from this cache.
+ *
+ * The background builds are waited for. The BVHs referenced outside
+ * the cache are not destroyed.
+ */
+void
+TriangleMeshBVHCache::clear()
+{
+  wait();
+
+  std::lock_guard lock{_lock};
+
+  _map.clear();
+  _entries.clear();
+  _memorySize = 0;
+}
+
+//
+// Returns the entry of mesh, moved to the front of the LRU list,
+// or the end of the list if the mesh has no entry. An entry whose
+// build failed is removed, hence the BVH can be built again.
+//
+TriangleMeshBVHCache::EntryList::iterator
+TriangleMeshBVHCache::find(const TriangleMesh& mesh)
+{
+  auto mit = _map.find(&mesh);
+
+  if (mit == _map.end())
+    return _entries.end();
+
+  auto it = mit->second;
+
+  if (it->state == State::Failed)
+  {
+    _map.erase(mit);
+    _entries.erase(it);
+    return _entries.end();
+  }
+  _entries.splice(_entries.begin(), _entries, it);
+  return it;
+}
+
+TriangleMeshBVHCache::EntryList::iterator
+TriangleMeshBVHCache::startBuild(const TriangleMesh& mesh)
+{
+#ifdef _DEBUG
+  printf("**Building BVH for mesh %d\n", mesh.id);
+#endif // _DEBUG
+  // The BVH is made with the defaults of TriangleMeshBVH::make()
+  _entries.push_front({&mesh,
+    State::Building,
+    new TriangleMeshBVH{mesh,
+      TriangleMeshBVH::dflMaxTrianglesPerNode,
+      BVHBase::SAH,
+      BVHBase::Binary,
+      BVHBase::dflDuplicationBudget,
+      0},
+    nullptr,
+    0,
+    false});
+  _map[&mesh] = _entries.begin();
+  return _entries.begin();
+}
+
+//
+// Marks the entry of mesh as ready or failed. Failed
+// entries are removed by find(), in the threads asking for BVHs,
+// hence a background build never destroys a BVH.
+//
+void
+TriangleMeshBVHCache::finishBuild(const TriangleMesh* mesh,
+  bool ok,
+  bool async)
+{
+  std::lock_guard lock{_lock};
+
+  if (auto mit = _map.find(mesh); mit != _map.end())
+  {
+    auto& e = *mit->second;
+
+    if (!ok)
+      e.state = State::Failed;
+    else
+    {
+      e.state = State::Ready;
+      e.memorySize = e.bvh->memorySize() + e.bvh->packedTriangleMemorySize();
+      _memorySize += e.memorySize;
+    }
+  }
+  if (async)
+    --_pending;
+  // Notify while holding the lock, since the cache may be destroyed
+  // as soon as the last pending build is finished.
+  _built.notify_all();
+}
+
+//
+// Evicts the least recently used BVHs not referenced outside the
+// cache while the memory used exceeds the budget.
+//
+void
+TriangleMeshBVHCache::evict()
+{
+  for (auto it = _entries.end();
+    _memorySize > _memoryBudget && it != _entries.begin();)
+  {
+    --it;
+    if (it->state != State::Ready ||
+      it->bvh->SharedObject::referenceCount() > 1)
+      continue;
+    _memorySize -= it->memorySize;
+    _map.erase(it->mesh);
+    it = _entries.erase(it);
+  }
+}
+
+} // end namespace cg
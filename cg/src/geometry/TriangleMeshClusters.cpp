@@ -0,0 +1,337 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: TriangleMeshClusters.cpp
+// ========
+// Source file for triangle mesh clusters.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#include "core/Parallel.h"
+#include "geometry/TriangleMeshClusters.h"
+#include <algorithm>
+#include <numeric>
+
+namespace cg
+{ // begin namespace cg
+
+
+namespace
+{ // begin namespace
+
+using Cluster = TriangleMeshClusters::Cluster;
+
+// Meshes with fewer triangles are partitioned serially
+constexpr int parallelThreshold = 1 << 15;
+
+// Weight of the extent of the normals of a set of triangles relative
+// to the diagonal of the bounds of their centroids when choosing the
+// split axis. A set of triangles facing opposite sides, e.g., of a
+// thin slab, is split by normal rather than by position, otherwise
+// its clusters would never be back-facing.
+constexpr float normalWeight = 0.5f;
+
+//
+// Partitioner
+//
+// The clusters are the leaves of a kd-tree of the triangles built
+// by splitting a set of triangles at the median of their centroids
+// or normals along the axis of largest extent, until the sets have
+// at most maxCount triangles.
+//
+class Partitioner
+{
+public:
+  Partitioner(const TriangleMesh::Data& data, int maxCount);
+
+  auto order()
+  {
+    return _order.data();
+  }
+
+  std::vector<Cluster> partition();
+
+private:
+  const TriangleMesh::Data& _data;
+  int _maxCount;
+  std::vector<int> _order;
+  std::vector<vec3f> _centroids;
+  std::vector<vec3f> _normals;
+
+  int split(int first, int last);
+  void partition(int first, int last, std::vector<Cluster>& clusters);
+  Cluster makeCluster(int first, int last);
+
+}; // Partitioner
+
+Partitioner::Partitioner(const TriangleMesh::Data& data, int maxCount):
+  _data{data},
+  _maxCount{maxCount},
+  _order(data.triangleCount),
+  _centroids(data.triangleCount),
+  _normals(data.triangleCount)
+{
+  std::iota(_order.begin(), _order.end(), 0);
+  parallelFor(_order.size(), 1 << 14, [this](size_t first, size_t last)
+    {
+      for (auto i = first; i < last; ++i)
+      {
+        auto v = _data.triangles[i].v;
+        const auto& p0 = _data.vertices[v[0]];
+        const auto& p1 = _data.vertices[v[1]];
+        const auto& p2 = _data.vertices[v[2]];
+        auto n = triangle::normal(p0, p1, p2);
+
+        _centroids[i] = (p0 + p1 + p2) * (1.f / 3);
+        // Degenerate triangles have null normals
+        _normals[i] = n.squaredNorm() > 0.5f ? n : vec3f::null();
+      }
+    });
+}
+
+// Splits the triangles [first, last) of the order in two halves.
+// Returns the first triangle of the second half.
+int
+Partitioner::split(int first, int last)
+{
+  Bounds3f cb;
+  Bounds3f nb;
+
+  for (auto i = first; i < last; ++i)
+  {
+    cb.inflate(_centroids[_order[i]]);
+    nb.inflate(_normals[_order[i]]);
+  }
+
+  auto cs = cb.size();
+  auto ns = nb.size() * (normalWeight * cs.length());
+  auto dim = 0;
+  auto extent = cs.x;
+
+  for (auto k = 1; k < 6; ++k)
+    if (auto e = k < 3 ? cs[k] : ns[k - 3]; e > extent)
+    {
+      dim = k;
+      extent = e;
+    }
+
+  const auto& keys = dim < 3 ? _centroids : _normals;
+  auto k = dim % 3;
+  auto mid = first + (last - first) / 2;
+  auto o = _order.data();
+
+  std::nth_element(o + first, o + mid, o + last, [&keys, k](int a, int b)
+    {
+      return keys[a][k] < keys[b][k];
+    });
+  return mid;
+}
+
+void
+Partitioner::partition(int first, int last, std::vector<Cluster>& clusters)
+{
+  if (last - first <= _maxCount)
+  {
+    clusters.push_back(makeCluster(first, last));
+    return;
+  }
+
+  auto mid = split(first, last);
+
+  partition(first, mid, clusters);
+  partition(mid, last, clusters);
+}
+
+Cluster
+Partitioner::makeCluster(int first, int last)
+{
+  // The triangles of a cluster keep their order in the mesh, e.g.,
+  // the one made by MeshOptimizer
+  std::sort(_order.begin() + first, _order.begin() + last);
+
+  Cluster cluster;
+  auto axis = vec3f::null();
+
+  for (auto i = first; i < last; ++i)
+  {
+    auto t = _order[i];
+
+    for (auto v : _data.triangles[t].v)
+      cluster.bounds.inflate(_data.vertices[v]);
+    axis += _normals[t];
+  }
+  cluster.coneCutoff = 2;
+  cluster.first = first;
+  cluster.count = last - first;
+  if (axis.squaredNorm() < 1e-6f)
+  {
+    cluster.coneAxis = vec3f::null();
+    return cluster;
+  }
+  axis.normalize();
+
+  auto minDot = 1.f;
+
+  for (auto i = first; i < last; ++i)
+    if (const auto& n = _normals[_order[i]]; n.squaredNorm() > 0)
+      minDot = std::min(minDot, axis.dot(n));
+  cluster.coneAxis = axis;
+  if (minDot > 0)
+    cluster.coneCutoff = sqrt(1 - minDot * minDot);
+  return cluster;
+}
+
+std::vector<Cluster>
+Partitioner::partition()
+{
+  using Range = std::pair<int, int>;
+
+  std::vector<Range> ranges{{0, (int)_order.size()}};
+
+  // The top levels of the tree are split serially into enough
+  // subtrees for the threads, which are partitioned in parallel
+  if (_order.size() >= parallelThreshold)
+  {
+    const auto n = 4 * parallelThreadCount();
+
+    for (auto splitting = true; splitting && ranges.size() < n;)
+    {
+      std::vector<Range> next;
+
+      splitting = false;
+      for (auto [first, last] : ranges)
+        if (last - first <= _maxCount)
+          next.push_back({first, last});
+        else
+        {
+          auto mid = split(first, last);
+
+          next.push_back({first, mid});
+          next.push_back({mid, last});
+          splitting = true;
+        }
+      ranges.swap(next);
+    }
+  }
+
+  std::vector<std::vector<Cluster>> clusters(ranges.size());
+
+  parallelFor(ranges.size(), 1, [&, this](size_t first, size_t last)
+    {
+      for (auto i = first; i < last; ++i)
+        partition(ranges[i].first, ranges[i].second, clusters[i]);
+    });
+
+  std::vector<Cluster> result;
+
+  for (auto& c : clusters)
+    result.insert(result.end(), c.begin(), c.end());
+  return result;
+}
+
+} // end namespace
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// TriangleMeshClusters implementation
+// ====================
+TriangleMeshClusters*
+TriangleMeshClusters::make(TriangleMesh& mesh, int maxTriangleCount)
+{
+  Partitioner partitioner{mesh.data(), std::max(maxTriangleCount, 1)};
+  auto clusters = new TriangleMeshClusters;
+
+  clusters->_clusters = partitioner.partition();
+  mesh.reorderTriangles(partitioner.order());
+  mesh.clusters = clusters;
+  return clusters;
+}
+
+TriangleMeshClusters*
+TriangleMeshClusters::get(const TriangleMesh& mesh)
+{
+  return dynamic_cast<TriangleMeshClusters*>((SharedObject*)mesh.clusters);
+}
+
+/**
+ * @brief Returns true if the triangles of \p cluster are back-facing
+ * from \p viewpoint.
+ *
+ * A triangle is back-facing if the angle between its normal and the
+ * direction from the viewpoint to the triangle is less than 90
+ * degrees. The test is conservative: the direction from a point
+ * viewpoint is taken to every point of the bounding sphere of the
+ * cluster, and the normals to every normal of its normal cone.
+ */
+bool
+TriangleMeshClusters::isBackFacing(const Cluster& cluster,
+  const vec4f& viewpoint)
+{
+  const auto cutoff = cluster.coneCutoff;
+
+  if (cutoff > 1)
+    return false;
+
+  const vec3f p{viewpoint.x, viewpoint.y, viewpoint.z};
+
+  if (viewpoint.w == 0)
+    return p.dot(cluster.coneAxis) > cutoff * p.length();
+
+  auto d = cluster.bounds.center() - p * (1 / viewpoint.w);
+  auto r = cluster.bounds.diagonalLength() * 0.5f;
+
+  return d.dot(cluster.coneAxis) > cutoff * d.length() + r * (1 + cutoff);
+}
+
+int
+TriangleMeshClusters::cull(const Frustum& frustum,
+  const vec4f* viewpoint,
+  std::vector<int>& counts,
+  std::vector<int>& offsets) const
+{
+  auto n = 0;
+
+  counts.clear();
+  offsets.clear();
+  for (const auto& cluster : _clusters)
+  {
+    if (frustum.classify(cluster.bounds) == Frustum::Outside ||
+      (viewpoint != nullptr && isBackFacing(cluster, *viewpoint)))
+      continue;
+    if (!counts.empty() && offsets.back() + counts.back() == cluster.first)
+      counts.back() += cluster.count;
+    else
+    {
+      counts.push_back(cluster.count);
+      offsets.push_back(cluster.first);
+    }
+    n += cluster.count;
+  }
+  return n;
+}
+
+} // end namespace cg
@@ -0,0 +1,194 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: TriangleMeshLOD.cpp
+// ========
+// Source file for triangle mesh levels of detail.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#include "core/Parallel.h"
+#include "geometry/MeshOptimizer.h"
+#include "geometry/MeshSimplifier.h"
+#include "geometry/TriangleMeshLOD.h"
+#include <algorithm>
+#include <atomic>
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// TriangleMeshLOD implementation
+// ===============
+//
+// Levels made by a background worker. They are moved to the object
+// by the thread calling get(), hence the GL resources of the level
+// meshes are never released by the worker.
+//
+struct TriangleMeshLOD::Job: public SharedObject
+{
+  std::vector<Level> levels;
+  std::atomic<bool> done{};
+
+}; // TriangleMeshLOD::Job
+
+TriangleMeshLOD::TriangleMeshLOD(const TriangleMesh& mesh)
+{
+  make(mesh, _levels);
+}
+
+TriangleMeshLOD::~TriangleMeshLOD()
+{
+  // do nothing
+}
+
+void
+TriangleMeshLOD::make(const TriangleMesh& mesh, std::vector<Level>& levels)
+{
+  auto n = mesh.data().triangleCount;
+
+  if (n < 2 * minTriangleCount)
+    return;
+
+  MeshSimplifier simplifier{mesh};
+
+  for (int i = 1; i <= maxLevels; ++i)
+  {
+    auto target = n >> i;
+
+    if (target < minTriangleCount)
+      break;
+
+    auto count = simplifier.simplify(target);
+
+    // Stop if the simplification stalled
+    if (count > target + target / 2)
+      break;
+
+    Reference<TriangleMesh> level{simplifier.mesh()};
+
+    MeshOptimizer::optimize(*level);
+    levels.push_back({level, simplifier.error()});
+  }
+}
+
+namespace
+{ // begin namespace
+
+// Copies the arrays of mesh, but the normals, used by a simplifier
+TriangleMesh*
+copyMesh(const TriangleMesh& mesh)
+{
+  const auto& data = mesh.data();
+  auto nv = data.vertexCount;
+  auto nt = data.triangleCount;
+  TriangleMesh::Data d;
+
+  d.vertexCount = nv;
+  d.triangleCount = nt;
+  d.vertices = new vec3f[nv];
+  d.vertexNormals = nullptr;
+  d.uv = mesh.hasUV() ? new vec2f[nv] : nullptr;
+  d.triangles = new TriangleMesh::Triangle[nt];
+  std::copy_n(data.vertices, nv, d.vertices);
+  if (d.uv != nullptr)
+    std::copy_n(data.uv, nv, d.uv);
+  std::copy_n(data.triangles, nt, d.triangles);
+  return new TriangleMesh{std::move(d)};
+}
+
+inline TriangleMeshLOD*
+asTriangleMeshLOD(SharedObject* object)
+{
+  return dynamic_cast<TriangleMeshLOD*>(object);
+}
+
+// Workers making the levels. The pool is joined at exit, and the
+// levels not yet started are discarded.
+WorkerPool lodWorkers;
+
+} // end namespace
+
+TriangleMeshLOD*
+TriangleMeshLOD::get(const TriangleMesh& mesh)
+{
+  if (auto lod = asTriangleMeshLOD(mesh.lod))
+    return lod;
+
+  auto lod = new TriangleMeshLOD;
+
+  mesh.lod = lod;
+  if (mesh.data().triangleCount >= 2 * minTriangleCount)
+  {
+    Reference<TriangleMesh> copy{copyMesh(mesh)};
+    Reference<Job> job{new Job};
+
+    lod->_job = job;
+    lodWorkers.push([copy, job]()
+      {
+        try
+        {
+          make(*copy, job->levels);
+        }
+        catch (...)
+        {
+          job->levels.clear();
+        }
+        job->done.store(true, std::memory_order_release);
+      });
+  }
+  return lod;
+}
+
+int
+TriangleMeshLOD::levelCount() const
+{
+  if (_job != nullptr && _job->done.load(std::memory_order_acquire))
+  {
+    _levels = std::move(_job->levels);
+    _job = nullptr;
+  }
+  return int(_levels.size());
+}
+
+const TriangleMeshLOD::Level&
+TriangleMeshLOD::level(int i) const
+{
+  return _levels[i];
+}
+
+const TriangleMesh*
+TriangleMeshLOD::select(float maxError) const
+{
+  for (auto i = levelCount(); i-- > 0;)
+    if (_levels[i].error <= maxError)
+      return _levels[i].mesh;
+  return nullptr;
+}
+
+} // end namespace cg
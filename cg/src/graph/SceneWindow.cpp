@@ -28,7 +28,7 @@
 // Source file for generic graph scene window.
 //
 // Author: Paulo Pagliosa
-// Last revision: 06/08/2025
+// Last revision: 18/10/2026
 
 #include "graph/SceneWindow.h"
 #include "graphics/Assets.h"
@@ -385,6 +385,24 @@ SceneWindow::inspectLight(SceneWindow&, LightProxy& proxy)
   light->turnOn(light->isTurnedOn() && proxy.sceneObject()->visible());
 }
 
+//
+// Sets the mesh of proxy to the asset mesh mit. The placeholder mesh
+// is rendered until the asset mesh is loaded in background, unless
+// another mesh is set meanwhile.
+//
+inline void
+setMeshAsync(TriangleMeshProxy& proxy, MeshMapIterator mit)
+{
+  Reference<TriangleMeshProxy> p{&proxy};
+  auto request = Assets::loadMeshAsync(mit, [p, mit](TriangleMesh& mesh)
+    {
+      if (mit->first == p->meshName())
+        p->setMesh(mesh, mit->first);
+    });
+
+  proxy.setMesh(*request->mesh(), mit->first);
+}
+
 void
 SceneWindow::inspectPrimitive(SceneWindow& window, TriangleMeshProxy& proxy)
 {
@@ -394,7 +412,7 @@ SceneWindow::inspectPrimitive(SceneWindow& window, TriangleMeshProxy& proxy)
     if (auto payload = ImGui::AcceptDragDropPayload("TriangleMesh"))
     {
       auto mit = *(MeshMapIterator*)payload->Data;
-      proxy.setMesh(*Assets::loadMesh(mit), mit->first);
+      setMeshAsync(proxy, mit);
     }
     ImGui::EndDragDropTarget();
   }
@@ -407,7 +425,7 @@ SceneWindow::inspectPrimitive(SceneWindow& window, TriangleMeshProxy& proxy)
     {
       for (auto mit = meshes.begin(); mit != meshes.end(); ++mit)
         if (ImGui::Selectable(mit->first.c_str()))
-          proxy.setMesh(*Assets::loadMesh(mit), mit->first);
+          setMeshAsync(proxy, mit);
     }
     ImGui::EndPopup();
   }
@@ -28,55 +28,187 @@
 // Source file for assets.
 //
 // Author: Paulo Pagliosa
-// Last revision: 03/02/2022
+// Last revision: 19/10/2026
 
 #include "graphics/Application.h"
 #include "graphics/Assets.h"
+#include "graphics/GLMesh.h"
+#include "graphics/TriangleMeshShape.h"
+#include "geometry/MeshSweeper.h"
+#include "geometry/TriangleMeshClusters.h"
+#include "geometry/TriangleMeshLOD.h"
+#include "geometry/TriangleMeshBVH.h"
+#include "core/Parallel.h"
+#include "utils/Stopwatch.h"
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <mutex>
+#include <thread>
 
 namespace cg
 { // begin namespace cg
 
 namespace fs = std::filesystem;
 
+namespace
+{ // begin namespace
 
-/////////////////////////////////////////////////////////////////////
 //
-// Assets implementation
-// ======
-bool Assets::_initialized;
-MeshMap Assets::_meshes;
-MaterialMap Assets::_materials;
-size_t Assets::_maxMeshSize;
-size_t Assets::_meshSize;
+// Pool of threads reading asset meshes
+//
+class MeshLoader
+{
+public:
+  static constexpr unsigned maxThreads = 4;
+
+  ~MeshLoader()
+  {
+    {
+      std::lock_guard lock{_mutex};
+      _stop = true;
+    }
+    _cv.notify_all();
+    for (auto& thread : _threads)
+      thread.join();
+    for (auto& [request, mesh] : _done)
+      delete mesh;
+  }
+
+  void push(MeshRequest* request, std::string filename)
+  {
+    {
+      std::lock_guard lock{_mutex};
+
+      if (_threads.empty())
+      {
+        auto n = parallelThreadCount();
+
+        n = std::min(maxThreads, n > 1 ? n - 1 : 1u);
+        while (n--)
+          _threads.emplace_back([this]() { run(); });
+      }
+      _jobs.emplace_back(request, std::move(filename));
+    }
+    _cv.notify_one();
+  }
+
+  bool pop(MeshRequest*& request, TriangleMesh*& mesh)
+  {
+    std::lock_guard lock{_mutex};
+
+    if (_done.empty())
+      return false;
+    std::tie(request, mesh) = _done.front();
+    _done.pop_front();
+    return true;
+  }
+
+private:
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  std::deque<std::pair<MeshRequest*, std::string>> _jobs;
+  std::deque<std::pair<MeshRequest*, TriangleMesh*>> _done;
+  std::vector<std::thread> _threads;
+  bool _stop{};
+
+  void run()
+  {
+    for (;;)
+    {
+      std::unique_lock lock{_mutex};
+
+      _cv.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+      if (_stop)
+        return;
+
+      auto [request, filename] = std::move(_jobs.front());
+
+      _jobs.pop_front();
+      lock.unlock();
+
+      // Parse the file and compute the normals (see MeshReader)
+      TriangleMesh* mesh{};
+
+      try
+      {
+        mesh = Application::loadMesh(filename.c_str());
+      }
+      catch (...)
+      {
+        // mesh remains null
+      }
+      lock.lock();
+      _done.emplace_back(request, mesh);
+    }
+  }
+
+}; // MeshLoader
 
-static inline auto
-meshSize(const TriangleMesh* m)
+//
+// Returns true if mesh is referenced outside the mesh cache. The
+// BVHs of mesh held only by the BVH cache of TriangleMeshShape
+// reference the mesh, but they are not uses of it.
+//
+inline bool
+inUse(const TriangleMesh& mesh)
 {
-  return m->data().vertexCount;
+  auto n = TriangleMeshShape::bvhCache().meshReferenceCount(mesh);
+  return mesh.referenceCount() > 1 + n;
 }
 
-static inline auto
-unmapUnusedMeshes(MeshMap& meshes)
+//
+// Removes the BVHs of mesh and of its levels of detail from the BVH
+// cache of TriangleMeshShape. Returns false if mesh is still in use,
+// since a BVH of it may have been taken meanwhile.
+//
+bool
+removeBVHs(const TriangleMesh& mesh)
 {
-  size_t ms{};
+  auto& cache = TriangleMeshShape::bvhCache();
 
-  for (auto& [name, mesh] : meshes)
-    if (mesh != nullptr)
-      if (mesh->referenceCount() > 1)
-        ms += meshSize(mesh);
-      else
-      {
-#ifdef _DEBUG
-        printf("**Releasing mesh '%s'...\n", name.c_str());
-#endif // _DEBUG
-        mesh = nullptr;
-      }
-  return ms;
+  cache.remove(mesh);
+  if (auto lod = dynamic_cast<TriangleMeshLOD*>((SharedObject*)mesh.lod))
+    for (int i = 0; i < lod->levelCount(); ++i)
+      cache.remove(*lod->level(i).mesh);
+  return mesh.referenceCount() == 1;
 }
 
+} // end namespace
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// MeshRequest implementation
+// ===========
+TriangleMesh*
+MeshRequest::mesh() const
+{
+  if (_mesh != nullptr)
+    return _mesh;
+  return Assets::placeholderMesh();
+}
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// Assets implementation
+// ======
+bool Assets::_initialized;
+MeshMap Assets::_meshes;
+MaterialMap Assets::_materials;
+size_t Assets::_meshMemoryBudget;
+Assets::MeshLRU Assets::_lru;
+std::unordered_map<const TriangleMesh*, Assets::MeshLRU::iterator>
+  Assets::_lruIndex;
+Assets::MeshCacheStatistics Assets::_statistics;
+std::map<std::string, MeshRequestRef> Assets::_requests;
+
+// Defined after _requests, hence destroyed before it
+static MeshLoader meshLoader;
+
 void
-Assets::initialize(size_t maxMeshSize)
+Assets::initialize(size_t meshMemoryBudget)
 {
   if (!_initialized)
   {
@@ -89,47 +221,257 @@ Assets::initialize(size_t maxMeshSize)
       for (auto e = fs::directory_iterator(); p != e; ++p)
         if (fs::is_regular_file(p->status()))
           _meshes[p->path().filename().string()] = nullptr;
+      // BVHs of asset meshes are cached next to the assets.
+      if (TriangleMeshBVH::cacheDirectory().empty())
+      {
+        auto cp = Application::assetFilePath("cache/");
+        TriangleMeshBVH::setCacheDirectory(cp);
+      }
     }
 
     auto dm = Material::defaultMaterial();
 
     _materials[dm->name()] = dm;
-    _maxMeshSize = maxMeshSize ? maxMeshSize : dflMaxMeshSize;
+    _meshMemoryBudget = meshMemoryBudget ?
+      meshMemoryBudget :
+      dflMeshMemoryBudget;
     _initialized = true;
   }
 }
 
+/**
+ * @brief Returns the number of bytes used by \p mesh.
+ *
+ * They are the bytes of the mesh arrays, of its GL buffers, of its
+ * BVH in the BVH cache of TriangleMeshShape, of its clusters and of
+ * its levels of detail, if any. The GL buffers and the BVH of a mesh
+ * are usually made when the mesh is first rendered, hence the size
+ * can grow.
+ */
+size_t
+Assets::memorySize(const TriangleMesh& mesh)
+{
+  const auto& m = mesh.data();
+  size_t nv = m.vertexCount;
+  auto s = sizeof(TriangleMesh) +
+    nv * sizeof(vec3f) +
+    m.triangleCount * sizeof(TriangleMesh::Triangle);
+
+  if (mesh.hasVertexNormals())
+    s += nv * sizeof(vec3f);
+  if (mesh.hasUV())
+    s += nv * sizeof(vec2f);
+  if (auto glMesh = asGLMesh(mesh.userData))
+    s += glMesh->memorySize();
+  s += TriangleMeshShape::bvhCache().memorySize(mesh);
+  if (auto clusters = TriangleMeshClusters::get(mesh))
+    s += clusters->memorySize();
+  if (auto lod = dynamic_cast<TriangleMeshLOD*>((SharedObject*)mesh.lod))
+    for (int i = 0; i < lod->levelCount(); ++i)
+      s += memorySize(*lod->level(i).mesh);
+  return s;
+}
+
+/// Returns the number of bytes used by the cached meshes.
+size_t
+Assets::meshMemorySize()
+{
+  size_t s{};
+
+  for (auto mit : _lru)
+    s += memorySize(*mit->second);
+  return s;
+}
+
+/**
+ * @brief Sets the memory budget of the mesh cache to \p budget
+ * bytes.
+ *
+ * The least recently used meshes not in use are evicted until the
+ * cached meshes fit in the budget.
+ */
+void
+Assets::setMeshMemoryBudget(size_t budget)
+{
+  _meshMemoryBudget = budget;
+  evict(0);
+}
+
+//
+// Evicts the least recently used meshes not referenced outside the
+// cache until size more bytes fit in the budget, or no such mesh is
+// left. Returns the number of bytes used by the cached meshes.
+//
+size_t
+Assets::evict(size_t size)
+{
+  auto used = meshMemorySize();
+
+  for (auto it = _lru.end();
+    used + size > _meshMemoryBudget && it != _lru.begin();)
+  {
+    auto& [name, mesh] = **--it;
+
+    if (inUse(*mesh))
+      continue;
+
+    auto s = memorySize(*mesh);
+
+    if (!removeBVHs(*mesh))
+      continue;
+#ifdef _DEBUG
+    printf("**Releasing mesh '%s'...\n", name.c_str());
+#endif // _DEBUG
+    used -= s;
+    ++_statistics.evictions;
+    _statistics.evictedBytes += s;
+    _lruIndex.erase(mesh);
+    mesh = nullptr;
+    it = _lru.erase(it);
+  }
+  return used;
+}
+
+//
+// Evicts meshes until size more bytes fit in the budget. If not
+// possible, returns false without evicting any mesh.
+//
+bool
+Assets::reserve(size_t size)
+{
+  size_t used{};
+
+  for (auto mit : _lru)
+    if (inUse(*mit->second))
+      used += memorySize(*mit->second);
+  if (used + size > _meshMemoryBudget)
+    return false;
+  evict(size);
+  return true;
+}
+
+//
+// Returns the cached mesh mit moved to the front of the LRU list.
+//
+TriangleMesh*
+Assets::hit(MeshMapIterator mit)
+{
+  TriangleMesh* m{mit->second};
+
+  _lru.splice(_lru.begin(), _lru, _lruIndex[m]);
+  ++_statistics.hits;
+  return m;
+}
+
+TriangleMesh*
+Assets::cacheMesh(MeshMapIterator mit, TriangleMesh* m)
+{
+  // The mesh may have been loaded meanwhile by loadMesh()
+  if (mit->second != nullptr)
+  {
+    delete m;
+    return mit->second;
+  }
+  // If unable to fit the mesh, then delete it and return null
+  if (!reserve(memorySize(*m)))
+  {
+    delete m;
+    return nullptr;
+  }
+
+  auto it = _meshes.find(mit->first);
+
+  it->second = m;
+  _lru.push_front(it);
+  _lruIndex[m] = _lru.begin();
+  return m;
+}
+
 TriangleMesh*
 Assets::loadMesh(MeshMapIterator mit)
 {
   if (mit == _meshes.end())
     return nullptr;
 
-  TriangleMesh* m{mit->second};
+  if (mit->second != nullptr)
+    return hit(mit);
+
+  auto filename = "meshes/" + mit->first;
+  TriangleMesh* m;
 
-  if (m == nullptr)
+  ++_statistics.misses;
+  if (m = Application::loadMesh(filename.c_str()))
+    m = cacheMesh(mit, m);
+  return m;
+}
+
+MeshRequestRef
+Assets::loadMeshAsync(MeshMapIterator mit, MeshRequest::Callback onReady)
+{
+  if (mit == _meshes.end())
+    return nullptr;
+  if (auto rit = _requests.find(mit->first); rit != _requests.end())
   {
-    auto filename = "meshes/" + mit->first;
+    if (onReady)
+      rit->second->_callbacks.push_back(std::move(onReady));
+    return rit->second;
+  }
+
+  MeshRequestRef request{new MeshRequest{mit}};
+
+  if (mit->second != nullptr)
+  {
+    request->_mesh = hit(mit);
+    request->_state = MeshRequest::State::Ready;
+    return request;
+  }
+  ++_statistics.misses;
+  if (onReady)
+    request->_callbacks.push_back(std::move(onReady));
+  _requests[mit->first] = request;
+  meshLoader.push(request, "meshes/" + mit->first);
+  return request;
+}
+
+void
+Assets::uploadMeshes(double timeBudget)
+{
+  if (_requests.empty())
+    return;
 
-    if (m = Application::loadMesh(filename.c_str()))
+  Stopwatch sw;
+  MeshRequest* r;
+  TriangleMesh* m;
+
+  sw.start();
+  while (meshLoader.pop(r, m))
+  {
+    MeshRequestRef request{r};
+
+    _requests.erase(r->_mit->first);
+    if (m != nullptr && (m = cacheMesh(r->_mit, m)) != nullptr)
     {
-      auto s = meshSize(m);
-
-      if (_meshSize + s > _maxMeshSize)
-        // If unable to release any cached mesh, then delete
-        // the last loaded mesh and return null
-        if (auto ms = unmapUnusedMeshes(_meshes); ms != _meshSize)
-          _meshSize = ms;
-        else
-        {
-          delete m;
-          return nullptr;
-        }
-      _meshSize += s;
-      _meshes[mit->first] = m;
+      // Create the GL buffers here rather than in the first draw
+      glMesh(m);
+      r->_mesh = m;
+      r->_state = MeshRequest::State::Ready;
+      for (auto& callback : r->_callbacks)
+        callback(*m);
     }
+    else
+      r->_state = MeshRequest::State::Failed;
+    r->_callbacks.clear();
+    if (sw.time() >= timeBudget)
+      break;
   }
-  return m;
+}
+
+TriangleMesh*
+Assets::placeholderMesh()
+{
+  static MeshRef placeholder{MeshSweeper::makeBox()};
+
+  return placeholder;
 }
 
 } // end namespace cg
@@ -0,0 +1,81 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: ChunkedTriangleMeshShape.cpp
+// ========
+// Source file for chunked triangle mesh shape.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#include "graphics/ChunkedTriangleMeshShape.h"
+
+namespace cg
+{ // begin namespace cg
+
+
+/////////////////////////////////////////////////////////////////////
+//
+// ChunkedTriangleMeshShape implementation
+// ========================
+ChunkedTriangleMeshShape::ChunkedTriangleMeshShape
+  (const ChunkedTriangleMesh& mesh):
+  _mesh{&mesh}
+{
+  // do nothing
+}
+
+bool
+ChunkedTriangleMeshShape::canIntersect() const
+{
+  return true;
+}
+
+bool
+ChunkedTriangleMeshShape::localIntersect(const Ray3f& ray) const
+{
+  return _mesh->intersect(ray);
+}
+
+bool
+ChunkedTriangleMeshShape::localIntersect(const Ray3f& ray,
+  Intersection& hit) const
+{
+  return _mesh->intersect(ray, hit) ? void(hit.object = this), true : false;
+}
+
+vec3f
+ChunkedTriangleMeshShape::normal(const Intersection& hit) const
+{
+  return _mesh->normal(hit);
+}
+
+Bounds3f
+ChunkedTriangleMeshShape::bounds() const
+{
+  return _mesh->bounds();
+}
+
+} // end namespace cg
@@ -28,7 +28,7 @@
 // Source file for OpenGL 3D graphics.
 //
 // Author: Paulo Pagliosa
-// Last revision: 04/09/2023
+// Last revision: 18/10/2026
 
 #include "geometry/MeshSweeper.h"
 #include "graphics/GLGraphics3.h"
@@ -173,11 +173,7 @@ GLGraphics3::quad()
 TriangleMesh*
 GLGraphics3::cone()
 {
-  static Reference<TriangleMesh> _cone;
-
-  if (_cone == nullptr)
-    _cone = MeshSweeper::makeCone();
-  return _cone;
+  return MeshSweeper::mesh(MeshSweeper::Shape::Cone);
 }
 
 TriangleMesh*
@@ -193,21 +189,13 @@ GLGraphics3::box()
 TriangleMesh*
 GLGraphics3::sphere()
 {
-  static Reference<TriangleMesh> _sphere;
-
-  if (_sphere == nullptr)
-    _sphere = MeshSweeper::makeSphere();
-  return _sphere;
+  return MeshSweeper::mesh(MeshSweeper::Shape::Sphere);
 }
 
 TriangleMesh*
 GLGraphics3::cylinder()
 {
-  static Reference<TriangleMesh> _cylinder;
-
-  if (_cylinder == nullptr)
-    _cylinder = MeshSweeper::makeCylinder();
-  return _cylinder;
+  return MeshSweeper::mesh(MeshSweeper::Shape::Cylinder);
 }
 
 GLGraphics3::GLGraphics3():
@@ -246,11 +234,7 @@ GLGraphics3::drawMesh(const TriangleMesh& mesh,
 
   auto m = glMesh(&mesh);
 
-  m->bind();
-  glDrawElements(GL_TRIANGLES,
-    count * 3,
-    GL_UNSIGNED_INT,
-    (void*)(sizeof(TriangleMesh::Triangle) * offset));
+  m->drawTriangles(count, offset);
   GLSL::Program::setCurrent(cp);
 }
 
@@ -28,30 +28,67 @@
 // Source file for OpenGL mesh array object.
 //
 // Author: Paulo Pagliosa
-// Last revision: 29/08/2023
+// Last revision: 19/10/2026
 
 #include "graphics/GLMesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
 
 namespace cg
 { // begin namespace cg
 
+namespace
+{ // begin namespace
+
 template <typename T>
 inline auto bufferSize(int n)
 {
   return sizeof(T) * n;
 }
 
+inline GLuint
+snorm10(float x)
+{
+  x = std::clamp(x, -1.0f, 1.0f);
+  return GLuint(int(std::round(x * 511))) & 0x3ff;
+}
+
+// Packs n as GL_INT_2_10_10_10_REV (w = 0)
+inline GLuint
+packNormal(const vec3f& n)
+{
+  return snorm10(n.x) | snorm10(n.y) << 10 | snorm10(n.z) << 20;
+}
+
+} // end namespace
+
 
 /////////////////////////////////////////////////////////////////////
 //
 // GLMesh implementation
 // ======
-GLMesh::GLMesh(const TriangleMesh& mesh)
+GLMesh::Layout GLMesh::defaultLayout{GLMesh::Layout::Interleaved};
+
+GLMesh::GLMesh(const TriangleMesh& mesh, Layout layout):
+  _layout{layout},
+  _memorySize{0}
 {
   glGenVertexArrays(1, &_vao);
   glBindVertexArray(_vao);
   glGenBuffers(4, _buffers);
+  if (layout == Layout::Separate)
+    uploadSeparate(mesh);
+  else
+    uploadInterleaved(mesh, layout == Layout::InterleavedPacked);
+  uploadIndices(mesh);
+  _vertexCount = mesh.data().triangleCount * 3;
+}
 
+void
+GLMesh::uploadSeparate(const TriangleMesh& mesh)
+{
   const auto& m = mesh.data();
 
   if (auto s = bufferSize<vec3f>(m.vertexCount))
@@ -64,6 +101,7 @@ GLMesh::GLMesh(const TriangleMesh& mesh)
     glBufferData(GL_ARRAY_BUFFER, s, m.vertexNormals, GL_STATIC_DRAW);
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(1);
+    _memorySize += 2 * s;
   }
   if (auto s = mesh.hasUV() * bufferSize<vec2f>(m.vertexCount))
   {
@@ -71,13 +109,101 @@ GLMesh::GLMesh(const TriangleMesh& mesh)
     glBufferData(GL_ARRAY_BUFFER, s, m.uv, GL_STATIC_DRAW);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(2);
+    _memorySize += s;
   }
-  if (auto s = bufferSize<TriangleMesh::Triangle>(m.triangleCount))
+}
+
+void
+GLMesh::uploadInterleaved(const TriangleMesh& mesh, bool packNormals)
+{
+  const auto& m = mesh.data();
+
+  if (m.vertexCount == 0)
+    return;
+
+  const size_t normalSize = packNormals ? sizeof(GLuint) : sizeof(vec3f);
+  const size_t uvOffset = sizeof(vec3f) + normalSize;
+  const auto hasUV = mesh.hasUV();
+  const auto stride = uvOffset + hasUV * sizeof(vec2f);
+  const auto s = stride * m.vertexCount;
+  std::vector<char> vertices(s);
+
+  for (int i = 0; i < m.vertexCount; ++i)
+  {
+    auto v = vertices.data() + stride * i;
+    auto n = m.vertexNormals ? m.vertexNormals[i] : vec3f::null();
+
+    memcpy(v, &m.vertices[i], sizeof(vec3f));
+    v += sizeof(vec3f);
+    if (packNormals)
+    {
+      auto p = packNormal(n);
+      memcpy(v, &p, sizeof(GLuint));
+    }
+    else
+      memcpy(v, &n, sizeof(vec3f));
+    if (hasUV)
+      memcpy(v + normalSize, &m.uv[i], sizeof(vec2f));
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, _buffers[0]);
+  glBufferData(GL_ARRAY_BUFFER, s, vertices.data(), GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, GLsizei(stride), 0);
+  glEnableVertexAttribArray(0);
+
+  auto offset = (void*)sizeof(vec3f);
+
+  if (packNormals)
+    glVertexAttribPointer(1,
+      4,
+      GL_INT_2_10_10_10_REV,
+      GL_TRUE,
+      GLsizei(stride),
+      offset);
+  else
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, GLsizei(stride), offset);
+  glEnableVertexAttribArray(1);
+  if (hasUV)
   {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _buffers[3]);
+    offset = (void*)uvOffset;
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, GLsizei(stride), offset);
+    glEnableVertexAttribArray(2);
+  }
+  _memorySize += s;
+}
+
+void
+GLMesh::uploadIndices(const TriangleMesh& mesh)
+{
+  const auto& m = mesh.data();
+
+  _indexType = GL_UNSIGNED_INT;
+  if (m.triangleCount == 0)
+    return;
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _buffers[3]);
+  if (m.vertexCount < 65536)
+  {
+    // Every index fits in 16 bits: upload half the bytes
+    auto n = m.triangleCount * 3;
+    std::vector<GLushort> indices(n);
+    auto index = indices.data();
+
+    for (int i = 0; i < m.triangleCount; ++i)
+      for (auto v : m.triangles[i].v)
+        *index++ = GLushort(v);
+    _indexType = GL_UNSIGNED_SHORT;
+    _memorySize += bufferSize<GLushort>(n);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+      bufferSize<GLushort>(n),
+      indices.data(),
+      GL_STATIC_DRAW);
+  }
+  else
+  {
+    auto s = bufferSize<TriangleMesh::Triangle>(m.triangleCount);
+
+    _memorySize += s;
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, s, m.triangles, GL_STATIC_DRAW);
   }
-  _vertexCount = m.triangleCount * 3;
 }
 
 void
@@ -93,4 +219,30 @@ GLMesh::setColors(GLColorBuffer* colors, int location)
   glVertexAttrib4f(location, 0, 0, 0, 0);
 }
 
+void
+GLMesh::drawTriangles(const int* counts, const int* offsets, int n)
+{
+  if (n == 1)
+  {
+    drawTriangles(counts[0], offsets[0]);
+    return;
+  }
+
+  std::vector<GLsizei> indexCounts(n);
+  std::vector<const void*> indexOffsets(n);
+  const auto triangleSize = indexSize() * 3;
+
+  for (int i = 0; i < n; ++i)
+  {
+    indexCounts[i] = counts[i] * 3;
+    indexOffsets[i] = (const void*)(triangleSize * size_t(offsets[i]));
+  }
+  bind();
+  glMultiDrawElements(GL_TRIANGLES,
+    indexCounts.data(),
+    _indexType,
+    indexOffsets.data(),
+    n);
+}
+
 } // end namespace cg
@@ -28,7 +28,7 @@
 // Source file for OpenGL mesh renderer.
 //
 // Author: Paulo Pagliosa
-// Last revision: 02/09/2023
+// Last revision: 18/10/2026
 
 #include "graphics/GLMeshRenderer.h"
 
@@ -542,8 +542,7 @@ GLMeshRenderer::render(TriangleMesh& mesh, const mat4f& t, const mat3f& n)
 
   auto m = glMesh(&mesh);
 
-  m->bind();
-  glDrawElements(GL_TRIANGLES, m->vertexCount(), GL_UNSIGNED_INT, 0);
+  m->drawTriangles(mesh.data().triangleCount);
 }
 
 void
@@ -28,9 +28,14 @@
 // Source file for OpenGL renderer.
 //
 // Author: Paulo Pagliosa
-// Last revision: 30/10/2023
+// Last revision: 19/10/2026
 
+#include "geometry/MeshSweeper.h"
+#include "geometry/TriangleMeshClusters.h"
+#include "geometry/TriangleMeshLOD.h"
+#include "graphics/ChunkedTriangleMeshShape.h"
 #include "graphics/GLRenderer.h"
+#include <algorithm>
 
 namespace cg
 { // begin namespace cg
@@ -320,6 +325,9 @@ struct GLRenderer::GLData
   GLuint lineColorMixIdx;
   GLuint modelMaterialIdx;
   GLuint colorMapMaterialIdx;
+  // Triangle ranges of the visible clusters of a mesh
+  std::vector<int> clusterCounts;
+  std::vector<int> clusterOffsets;
 
   GLData();
 
@@ -513,6 +521,10 @@ GLRenderer::beginRender()
 
   glClearColor((float)bc.r, (float)bc.g, (float)bc.b, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  if (flags.isSet(CullBackFaces))
+    glEnable(GL_CULL_FACE);
+  else
+    glDisable(GL_CULL_FACE);
   _gl->program.use();
   _gl->program.setUniform(_gl->projectionTypeLoc, _camera->projectionType());
   _gl->program.setUniformMat4(_gl->viewportMatrixLoc, _gl->viewportMatrix);
@@ -569,20 +581,48 @@ normalMatrix(const mat3f& n, const Camera* c)
   return mat3f{c->worldToCameraMatrix()} * n;
 }
 
+inline const ChunkedTriangleMesh*
+chunkedMesh(const Primitive& primitive)
+{
+  auto instance = dynamic_cast<const ShapeInstance*>(&primitive);
+
+  if (instance == nullptr)
+    return nullptr;
+
+  auto shape = instance->shape();
+
+  if (auto chunked = dynamic_cast<const ChunkedTriangleMeshShape*>(shape))
+    return chunked->mesh();
+  return nullptr;
+}
+
 } // end namespace
 
 bool
 GLRenderer::drawMesh(const Primitive& primitive)
 {
-  auto mesh = primitive.tesselate();
-
-  if (!mesh)
-    return false;
-
   auto& t = primitive.localToWorldMatrix();
   auto& n = primitive.normalMatrix();
 
-  drawMesh(*mesh, *primitive.material(), t, n, mesh->data().triangleCount, 0);
+  if (auto chunked = chunkedMesh(primitive))
+    drawChunkedMesh(*chunked, *primitive.material(), t, n);
+  else
+  {
+    auto mesh = primitive.tesselate();
+
+    if (!mesh)
+      return false;
+    mesh = levelOfDetail(*mesh, primitive);
+    if (auto clusters = TriangleMeshClusters::get(*mesh))
+      drawClusters(*mesh, *clusters, primitive);
+    else
+      drawMesh(*mesh,
+        *primitive.material(),
+        t,
+        n,
+        mesh->data().triangleCount,
+        0);
+  }
   if (flags.isSet(DrawBounds))
   {
     setLineColor(boundsColor);
@@ -595,13 +635,110 @@ GLRenderer::drawMesh(const Primitive& primitive)
   return true;
 }
 
+/**
+ * @brief Returns the coarsest level of detail of \p mesh, the mesh
+ * of \p primitive, whose error projected on the screen is at most
+ * lodTolerance pixels.
+ *
+ * The error is projected at the point of the bounds of the
+ * primitive nearest to the camera. If \p mesh is a cached mesh of
+ * MeshSweeper, the level is the cached mesh of the same shape with
+ * the resolution for its projected radius. Otherwise, until the
+ * levels of the mesh are made, in background, the mesh itself is
+ * returned.
+ */
+const TriangleMesh*
+GLRenderer::levelOfDetail(const TriangleMesh& mesh,
+  const Primitive& primitive) const
+{
+  if (lodTolerance <= 0)
+    return &mesh;
+
+  MeshSweeper::Shape shape;
+  auto swept = MeshSweeper::isCached(mesh, shape);
+  TriangleMeshLOD* lod{};
+
+  if (!swept && (lod = TriangleMeshLOD::get(mesh))->levelCount() == 0)
+    return &mesh;
+
+  // World length of a pixel
+  auto d = _windowViewportRatio;
+
+  if (_camera->projectionType() == Camera::Perspective)
+  {
+    auto b = primitive.bounds();
+    auto z = -_camera->worldToCamera(b.center()).z;
+    auto F = _camera->nearPlane();
+
+    if ((z -= b.diagonalLength() * 0.5f) <= F)
+      return swept ?
+        MeshSweeper::mesh(shape, MeshSweeper::maxResolution) :
+        &mesh;
+    d *= z / F;
+  }
+
+  const auto& t = primitive.localToWorldMatrix();
+  auto s = std::max({vec3f{t[0]}.length(),
+    vec3f{t[1]}.length(),
+    vec3f{t[2]}.length()});
+
+  // The swept shapes have unit radius
+  if (swept)
+    return MeshSweeper::mesh(shape,
+      MeshSweeper::resolution(s / d, lodTolerance));
+
+  auto level = lod->select(lodTolerance * d / s);
+
+  return level != nullptr ? level : &mesh;
+}
+
+/**
+ * @brief Draws the clusters of \p mesh, the mesh of \p primitive,
+ * not outside the view frustum and, if the flag CullBackFaces is
+ * set, not back-facing from the camera, with a single draw call
+ * (see TriangleMeshClusters::cull()).
+ */
 void
-GLRenderer::drawMesh(const TriangleMesh& mesh,
+GLRenderer::drawClusters(const TriangleMesh& mesh,
+  const TriangleMeshClusters& clusters,
+  const Primitive& primitive)
+{
+  const auto& t = primitive.localToWorldMatrix();
+  // The frustum and viewpoint in the local space of the mesh
+  Frustum frustum{mvpMatrix(mvMatrix(t, _camera), _camera)};
+  const vec4f* viewpoint{};
+  vec4f p;
+
+  if (flags.isSet(CullBackFaces))
+  {
+    const auto& w = primitive.worldToLocalMatrix();
+
+    if (_camera->projectionType() == Camera::Perspective)
+      p = vec4f{w.transform(_camera->position()), 1};
+    else
+      p = vec4f{w.transformVector(_camera->directionOfProjection()), 0};
+    viewpoint = &p;
+  }
+
+  auto& counts = _gl->clusterCounts;
+  auto& offsets = _gl->clusterOffsets;
+
+  if (clusters.cull(frustum, viewpoint, counts, offsets) == 0)
+    return;
+
+  auto m = prepareMesh(mesh,
+    *primitive.material(),
+    t,
+    primitive.normalMatrix());
+
+  m->drawTriangles(counts.data(), offsets.data(), (int)counts.size());
+}
+
+GLMesh*
+GLRenderer::prepareMesh(const TriangleMesh& mesh,
   const Material& material,
   const mat4f& t,
-  const mat3f& n,
-  int count,
-  int offset)
+  const mat3f& n)
 {
   auto mvm = mvMatrix(t, _camera);
 
@@ -620,14 +757,18 @@ GLRenderer::drawMesh(const TriangleMesh& mesh,
     _gl->modelMaterialIdx;
   glUniformSubroutinesuiv(GL_FRAGMENT_SHADER, 2, subIds);
   renderMaterial(material);
+  return glMesh(&mesh);
+}
 
-  auto m = glMesh(&mesh);
-
-  m->bind();
-  glDrawElements(GL_TRIANGLES,
-    count * 3,
-    GL_UNSIGNED_INT,
-    (void*)(sizeof(TriangleMesh::Triangle) * offset));
+void
+GLRenderer::drawMesh(const TriangleMesh& mesh,
+  const Material& material,
+  const mat4f& t,
+  const mat3f& n,
+  int count,
+  int offset)
+{
+  prepareMesh(mesh, material, t, n)->drawTriangles(count, offset);
 }
 
 bool
@@ -653,6 +794,34 @@ GLRenderer::drawSubMesh(const TriangleMesh& mesh,
   return true;
 }
 
+/**
+ * @brief Draws the chunks of \p mesh whose bounds are not outside
+ * the view frustum.
+ *
+ * The GL buffers of a chunk are made when the chunk is drawn after
+ * being paged in, and released here after the chunk is paged out.
+ * The residency budget of the mesh should hold the chunks in the
+ * view frustum, otherwise chunks are paged in every frame.
+ */
+void
+GLRenderer::drawChunkedMesh(const ChunkedTriangleMesh& mesh,
+  const Material& material,
+  const mat4f& t,
+  const mat3f& n)
+{
+  mesh.releasePagedOut();
+
+  // The frustum in the local space of the mesh
+  Frustum frustum{mvpMatrix(mvMatrix(t, _camera), _camera)};
+
+  mesh.queryChunks(frustum, [&](int i)
+    {
+      auto chunk = mesh.chunkMesh(i);
+
+      drawMesh(*chunk, material, t, n, chunk->data().triangleCount, 0);
+    });
+}
+
 void
 GLRenderer::drawAxes(const mat4f& m, float s)
 {
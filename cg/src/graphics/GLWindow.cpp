@@ -28,10 +28,11 @@
 // Source file for OpenGL window.
 //
 // Author: Paulo Pagliosa
-// Last revision: 22/09/2025
+// Last revision: 18/10/2026
 
 #include "core/Exception.h"
 #include "graphics/Application.h"
+#include "graphics/Assets.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
@@ -189,6 +190,8 @@ GLWindow::mainLoop()
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
     _deltaTime = 1000.0f / ImGui::GetIO().Framerate;
+    // Finish the asset meshes loaded in background.
+    Assets::uploadMeshes();
     if (!_paused)
       // Update the scene.
       update();
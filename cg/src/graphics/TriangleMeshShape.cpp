@@ -28,11 +28,10 @@
 // Class definition for triangle mesh shape.
 //
 // Author: Paulo Pagliosa
-// Last revision: 01/08/2023
+// Last revision: 19/10/2026
 
 #include "graphics/TriangleMeshShape.h"
 #include <cassert>
-#include <map>
 
 namespace cg
 { // begin namespace cg
@@ -42,35 +41,7 @@ namespace cg
 //
 // TriangleMeshShape implementation
 // =================
-class BVHBuilder
-{
-public:
-  using BVHMap = std::map<uint32_t, Reference<TriangleMeshBVH>>;
-
-  TriangleMeshBVH* bvh(const TriangleMesh& mesh)
-  {
-    {
-      auto mit = _map.find(mesh.id);
-
-      if (_map.end() != mit)
-        return mit->second;
-    }
-#ifdef _DEBUG
-    printf("**Building BVH for mesh %d\n", mesh.id);
-#endif // _DEBUG
-
-    auto* bvh = new TriangleMeshBVH{mesh};
-
-    _map.emplace(mesh.id, bvh);
-    return bvh;
-  }
-
-private:
-  BVHMap _map;
-
-}; // BVHBuilder
-
-static BVHBuilder _bvhBuilder;
+bool TriangleMeshShape::_asyncBVHBuild;
 
 TriangleMeshShape::TriangleMeshShape(const TriangleMesh& mesh):
   _mesh{&mesh}
@@ -83,7 +54,12 @@ TriangleMeshShape::setMesh(const TriangleMesh& mesh)
 {
   if (_mesh != &mesh)
   {
+    std::lock_guard lock{_bvhLock};
+
+    _queryBVH = nullptr;
+    _bvhComplete = false;
     _bvh = nullptr;
+    _coarseBVH = nullptr;
     _mesh = &mesh;
   }
 }
@@ -100,12 +76,57 @@ TriangleMeshShape::canIntersect() const
   return true;
 }
 
+/// Returns the cache of the BVHs of the meshes of the shapes.
+TriangleMeshBVHCache&
+TriangleMeshShape::bvhCache()
+{
+  static TriangleMeshBVHCache cache;
+  return cache;
+}
+
+/**
+ * @brief Returns the BVH of the mesh of this shape.
+ *
+ * If the BVHs are built asynchronously, a coarse BVH is returned
+ * until the BVH of the mesh is built in background (see
+ * TriangleMeshBVHCache::getAsync()).
+ *
+ * Can be invoked by concurrent ray queries, but not concurrently
+ * with setMesh(). Once the BVH is complete, no lock is taken. Until
+ * then, one thread at a time asks the cache for the BVH, while the
+ * others use the coarse BVH, if any.
+ */
 TriangleMeshBVH*
 TriangleMeshShape::bvh() const
 {
-  if (_bvh == nullptr)
-    _bvh = _bvhBuilder.bvh(*_mesh);
-  return _bvh;
+  if (_bvhComplete)
+    return _queryBVH;
+
+  std::unique_lock lock{_bvhLock, std::try_to_lock};
+
+  if (!lock.owns_lock())
+  {
+    if (auto bvh = _queryBVH.load())
+      return bvh;
+    lock.lock();
+  }
+  if (!_bvhComplete)
+  {
+    auto complete = true;
+    auto bvh = _asyncBVHBuild ?
+      bvhCache().getAsync(*_mesh, complete) :
+      bvhCache().get(*_mesh);
+
+    // Any coarse BVH of the mesh will do, hence the first one is
+    // kept, since it may be in use.
+    if (complete)
+      _bvh = bvh;
+    else if (_coarseBVH == nullptr)
+      _coarseBVH = bvh;
+    _queryBVH = complete ? _bvh : _coarseBVH;
+    _bvhComplete = complete;
+  }
+  return _queryBVH;
 }
 
 bool
@@ -28,10 +28,25 @@
 // Source file for OBJ mesh reader.
 //
 // Author: Paulo Pagliosa
-// Last revision: 17/07/2023
+// Last revision: 18/10/2026
 
 #include "utils/MeshReader.h"
+#include "core/Hash.h"
+#include "core/Parallel.h"
+#include "geometry/TriangleMeshFile.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace cg
 { // begin namespace cg
@@ -138,6 +153,1147 @@ readMeshData(FILE* file, TriangleMesh::Data& data)
     }
 }
 
+//
+// Parallel OBJ parsing
+//
+// The mapped file is split into chunks starting at line boundaries.
+// Every chunk is parsed by a single thread into its own arrays. The
+// indices of the chunk faces are zero-based and absolute, but for
+// the ones given relative to the end of a list (that is, negative),
+// which are relative to the first element of the list in the chunk
+// and are fixed when the chunks are merged.
+//
+// The texture coordinate and normal indices of the triangle corners
+// are kept only if a face of the chunk has them; -1 stands for a
+// missing index.
+//
+constexpr size_t objChunkSize = 4 << 20;
+
+enum OBJList
+{
+  Positions,
+  TexCoords,
+  Normals
+};
+
+struct OBJCorner
+{
+  int index[3];
+  bool relative[3];
+
+}; // OBJCorner
+
+struct OBJChunk
+{
+  const char* begin;
+  const char* end;
+  std::vector<vec3f> vertices;
+  std::vector<vec2f> texCoords;
+  std::vector<vec3f> normals;
+  std::vector<TriangleMesh::Triangle> triangles;
+  std::vector<int> texCoordIndices;
+  std::vector<int> normalIndices;
+  // Relative indices, as 3 * corner + OBJList
+  std::vector<uint32_t> relativeIndices;
+  bool hasAttributes{};
+  bool error{};
+
+  int count(int list) const
+  {
+    return int(list == Positions ? vertices.size() :
+      list == TexCoords ? texCoords.size() : normals.size());
+  }
+
+  void addTriangle(const OBJCorner* const c[3]);
+
+}; // OBJChunk
+
+void
+OBJChunk::addTriangle(const OBJCorner* const c[3])
+{
+  auto corner = uint32_t(triangles.size() * 3);
+
+  triangles.emplace_back().setVertices(c[0]->index[Positions],
+    c[1]->index[Positions],
+    c[2]->index[Positions]);
+  if (!hasAttributes)
+    for (int k = 0; k < 3; ++k)
+      if (c[k]->index[TexCoords] >= 0 || c[k]->index[Normals] >= 0)
+      {
+        texCoordIndices.assign(corner, -1);
+        normalIndices.assign(corner, -1);
+        hasAttributes = true;
+        break;
+      }
+  for (int k = 0; k < 3; ++k)
+  {
+    if (hasAttributes)
+    {
+      texCoordIndices.push_back(c[k]->index[TexCoords]);
+      normalIndices.push_back(c[k]->index[Normals]);
+    }
+    for (int list = 0; list < 3; ++list)
+      if (c[k]->relative[list])
+        relativeIndices.push_back((corner + k) * 3 + list);
+  }
+}
+
+inline bool
+isBlank(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool
+isDigit(char c)
+{
+  return unsigned(c - '0') < 10;
+}
+
+inline const char*
+skipBlanks(const char* s, const char* end)
+{
+  while (s < end && isBlank(*s))
+    ++s;
+  return s;
+}
+
+inline const char*
+skipLine(const char* s, const char* end)
+{
+  auto eol = (const char*)memchr(s, '\n', end - s);
+  return eol ? eol + 1 : end;
+}
+
+bool
+parseInt(const char*& s, const char* end, int& value)
+{
+  auto p = s;
+  auto negative = false;
+
+  if (p < end && (*p == '-' || *p == '+'))
+    negative = *p++ == '-';
+  if (p == end || !isDigit(*p))
+    return false;
+
+  int64_t n{};
+
+  for (; p < end && isDigit(*p); ++p)
+    if ((n = n * 10 + (*p - '0')) > INT_MAX)
+      return false;
+  value = int(negative ? -n : n);
+  s = p;
+  return true;
+}
+
+//
+// Parses a decimal float. Mantissas of up to 19 digits with small
+// exponents are converted with a single double operation, which is
+// exact but for the final rounding to float; anything else, such as
+// longer mantissas, inf or nan, is handed to std::from_chars.
+//
+bool
+parseFloat(const char*& s, const char* end, float& value)
+{
+  static constexpr double powers[]
+  {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  constexpr int maxDigits = 19;
+  auto p = s;
+  auto negative = false;
+
+  if (p < end && (*p == '-' || *p == '+'))
+    negative = *p++ == '-';
+
+  uint64_t m{};
+  int digits{};
+  int exponent{};
+  auto any = false;
+
+  for (; p < end && isDigit(*p); ++p, any = true)
+    if (digits < maxDigits)
+    {
+      m = m * 10 + (*p - '0');
+      digits += m != 0;
+    }
+    else
+      ++exponent;
+  if (p < end && *p == '.')
+    for (++p; p < end && isDigit(*p); ++p, any = true)
+      if (digits < maxDigits)
+      {
+        m = m * 10 + (*p - '0');
+        digits += m != 0;
+        --exponent;
+      }
+  if (any && p < end && (*p | 0x20) == 'e')
+  {
+    auto q = p + 1;
+    int e;
+
+    if (parseInt(q, end, e) && e > -1000 && e < 1000)
+    {
+      exponent += e;
+      p = q;
+    }
+  }
+  if (!any || digits >= maxDigits || exponent < -22 || exponent > 22)
+  {
+    // from_chars does not accept a plus sign
+    auto b = s + (s < end && *s == '+');
+    auto [ptr, ec] = std::from_chars(b, end, value);
+
+    if (ec != std::errc{} && ec != std::errc::result_out_of_range)
+      return false;
+    s = ptr;
+    return true;
+  }
+
+  auto x = double(m);
+
+  x = exponent < 0 ? x / powers[-exponent] : x * powers[exponent];
+  value = float(negative ? -x : x);
+  s = p;
+  return true;
+}
+
+//
+// Parses the index of a face vertex in the given list of the chunk.
+//
+inline bool
+parseIndex(const char*& s,
+  const char* end,
+  const OBJChunk& chunk,
+  int list,
+  OBJCorner& corner)
+{
+  int i;
+
+  if (!parseInt(s, end, i) || i == 0)
+    return false;
+  if ((corner.relative[list] = i < 0))
+    corner.index[list] = chunk.count(list) + i;
+  else
+    corner.index[list] = i - 1;
+  return true;
+}
+
+inline bool
+isIndexEnd(const char* s, const char* end)
+{
+  return s == end || isBlank(*s) || *s == '\n';
+}
+
+//
+// Parses a face vertex: v, v/vt, v//vn or v/vt/vn.
+//
+bool
+parseCorner(const char*& s,
+  const char* end,
+  const OBJChunk& chunk,
+  OBJCorner& c)
+{
+  c = {{-1, -1, -1}, {}};
+  if (!parseIndex(s, end, chunk, Positions, c))
+    return false;
+  if (s < end && *s == '/')
+  {
+    if (!isIndexEnd(++s, end) && *s != '/')
+      if (!parseIndex(s, end, chunk, TexCoords, c))
+        return false;
+    if (s < end && *s == '/')
+      if (!isIndexEnd(++s, end) && !parseIndex(s, end, chunk, Normals, c))
+        return false;
+  }
+  // Skip anything else up to the end of the vertex
+  while (!isIndexEnd(s, end))
+    ++s;
+  return true;
+}
+
+bool
+parseFloats(const char*& s, const char* end, float* x, int n)
+{
+  for (int i = 0; i < n; ++i)
+    if (!parseFloat(s = skipBlanks(s, end), end, x[i]))
+      return false;
+  return true;
+}
+
+void
+parseOBJChunk(OBJChunk& chunk)
+{
+  auto s = chunk.begin;
+  auto end = chunk.end;
+
+  chunk.vertices.reserve((end - s) / 48);
+  chunk.triangles.reserve((end - s) / 48);
+  for (; (s = skipBlanks(s, end)) < end; s = skipLine(s, end))
+  {
+    auto ok = true;
+    float x[3];
+
+    if (end - s < 2)
+      break;
+    if (*s == 'v')
+    {
+      if (isBlank(s[1]))
+      {
+        if ((ok = parseFloats(++s, end, x, 3)))
+          chunk.vertices.emplace_back(x[0], x[1], x[2]);
+      }
+      else if (end - s > 2 && isBlank(s[2]))
+      {
+        if (s[1] == 't')
+        {
+          if ((ok = parseFloats(s += 2, end, x, 2)))
+            chunk.texCoords.emplace_back(x[0], x[1]);
+        }
+        else if (s[1] == 'n')
+        {
+          if ((ok = parseFloats(s += 2, end, x, 3)))
+            chunk.normals.emplace_back(x[0], x[1], x[2]);
+        }
+      }
+    }
+    else if (*s == 'f' && isBlank(s[1]))
+    {
+      // Faces are triangulated as fans around their first vertex
+      OBJCorner corners[3];
+      OBJCorner* c[3]{corners, corners + 1, corners + 2};
+
+      ++s;
+      for (int nfv = 0; ok; ++nfv)
+      {
+        if ((s = skipBlanks(s, end)) == end || *s == '\n' || *s == '#')
+          break;
+        if (nfv > 2)
+          std::swap(c[1], c[2]);
+        if ((ok = parseCorner(s, end, chunk, *c[std::min(nfv, 2)])) && nfv >= 2)
+          chunk.addTriangle(c);
+      }
+    }
+    if (!ok)
+    {
+      chunk.error = true;
+      return;
+    }
+  }
+}
+//
+// Welds the corners of the triangles of data with equal position,
+// texture coordinate and normal indices into vertices. The vertices
+// are looked up in a table indexed by position, whose entries chain
+// the vertices sharing a position. Vertex i keeps position i; the
+// vertices for other texture coordinate or normal indices of the
+// same position are appended to the vertex array. The normals are
+// set only if every corner has one.
+//
+void
+weldOBJVertices(TriangleMesh::Data& data,
+  const std::vector<vec2f>& texCoords,
+  const std::vector<vec3f>& normals,
+  const std::vector<int>& texCoordIndices,
+  const std::vector<int>& normalIndices)
+{
+  using Key = std::pair<int, int>;
+
+  constexpr Key unused{INT_MIN, INT_MIN};
+  const auto np = data.vertexCount;
+  std::vector<Key> keys(np, unused);
+  std::vector<int> next(np, -1);
+  std::vector<int> positions;
+  auto v = &data.triangles->v[0];
+  size_t missingNormals{};
+
+  for (size_t c = 0, n = size_t(data.triangleCount) * 3; c < n; ++c)
+  {
+    Key key{texCoordIndices[c], normalIndices[c]};
+    auto i = v[c];
+
+    missingNormals += key.second < 0;
+    if (keys[i] == unused)
+      keys[i] = key;
+    else
+      for (; keys[i] != key; i = next[i])
+        if (next[i] < 0)
+        {
+          next[i] = int(keys.size());
+          keys.push_back(key);
+          next.push_back(-1);
+          positions.push_back(v[c]);
+        }
+    v[c] = i;
+  }
+
+  const auto nv = int(keys.size());
+
+  if (nv > np)
+  {
+    auto vertices = new vec3f[nv];
+
+    std::copy_n(data.vertices, np, vertices);
+    for (int i = np; i < nv; ++i)
+      vertices[i] = data.vertices[positions[i - np]];
+    delete []data.vertices;
+    data.vertices = vertices;
+    data.vertexCount = nv;
+  }
+  if (!texCoords.empty())
+  {
+    data.uv = new vec2f[nv];
+    for (int i = 0; i < nv; ++i)
+      data.uv[i] = keys[i].first >= 0 ? texCoords[keys[i].first] : vec2f{0, 0};
+  }
+  if (missingNormals == 0 && !normals.empty())
+  {
+    data.vertexNormals = new vec3f[nv];
+    for (int i = 0; i < nv; ++i)
+      data.vertexNormals[i] = keys[i].second >= 0 ?
+        normals[keys[i].second].versor() :
+        vec3f::null();
+  }
+}
+
+TriangleMesh*
+parseOBJ(const char* filename, const MappedFile& file, bool attributes)
+{
+  const auto begin = file.as<const char>();
+  const auto end = begin + file.size();
+  const auto chunkCount = (file.size() + objChunkSize - 1) / objChunkSize;
+  std::vector<OBJChunk> chunks(chunkCount);
+
+  for (size_t i = 0; i < chunkCount; ++i)
+  {
+    chunks[i].begin = i ? chunks[i - 1].end : begin;
+    chunks[i].end = i + 1 < chunkCount ?
+      skipLine(std::max(chunks[i].begin, begin + (i + 1) * objChunkSize), end) :
+      end;
+  }
+  parallelFor(chunkCount, 1, [&](size_t first, size_t last)
+    {
+      for (auto i = first; i < last; ++i)
+        parseOBJChunk(chunks[i]);
+    });
+
+  // Prefix sums of the list and triangle counts of the chunks
+  std::vector<std::array<size_t, 3>> firstIndex(chunkCount + 1);
+  std::vector<size_t> firstTriangle(chunkCount + 1);
+  auto hasAttributes = false;
+
+  for (size_t i = 0; i < chunkCount; ++i)
+  {
+    if (chunks[i].error)
+    {
+      fprintf(stderr, "Syntax error in OBJ file %s\n", filename);
+      return nullptr;
+    }
+    for (int list = 0; list < 3; ++list)
+      firstIndex[i + 1][list] = firstIndex[i][list] + chunks[i].count(list);
+    firstTriangle[i + 1] = firstTriangle[i] + chunks[i].triangles.size();
+    hasAttributes |= attributes && chunks[i].hasAttributes;
+  }
+
+  const auto& counts = firstIndex[chunkCount];
+
+  if (std::max(counts[Positions], firstTriangle[chunkCount] * 3) > INT_MAX)
+  {
+    fprintf(stderr, "OBJ file %s is too large\n", filename);
+    return nullptr;
+  }
+
+  TriangleMesh::Data data;
+
+  data.vertexCount = int(counts[Positions]);
+  data.triangleCount = int(firstTriangle[chunkCount]);
+  data.vertices = new vec3f[data.vertexCount];
+  data.vertexNormals = nullptr;
+  data.uv = nullptr;
+  data.triangles = new TriangleMesh::Triangle[data.triangleCount];
+
+  std::vector<vec2f> texCoords;
+  std::vector<vec3f> normals;
+  std::vector<int> texCoordIndices;
+  std::vector<int> normalIndices;
+
+  if (hasAttributes)
+  {
+    const auto cornerCount = size_t(data.triangleCount) * 3;
+
+    texCoords.resize(counts[TexCoords]);
+    normals.resize(counts[Normals]);
+    texCoordIndices.resize(cornerCount);
+    normalIndices.resize(cornerCount);
+  }
+
+  std::atomic<bool> invalid{false};
+
+  parallelFor(chunkCount, 1, [&](size_t first, size_t last)
+    {
+      for (auto i = first; i < last; ++i)
+      {
+        auto& chunk = chunks[i];
+        auto& offset = firstIndex[i];
+        auto corner = firstTriangle[i] * 3;
+        auto cornerCount = chunk.triangles.size() * 3;
+        int* indices[3]{&data.triangles[firstTriangle[i]].v[0]};
+
+        std::copy(chunk.vertices.begin(),
+          chunk.vertices.end(),
+          data.vertices + offset[Positions]);
+        std::copy(chunk.triangles.begin(),
+          chunk.triangles.end(),
+          data.triangles + firstTriangle[i]);
+        if (hasAttributes)
+        {
+          std::copy(chunk.texCoords.begin(),
+            chunk.texCoords.end(),
+            texCoords.begin() + offset[TexCoords]);
+          std::copy(chunk.normals.begin(),
+            chunk.normals.end(),
+            normals.begin() + offset[Normals]);
+          indices[TexCoords] = texCoordIndices.data() + corner;
+          indices[Normals] = normalIndices.data() + corner;
+          if (chunk.hasAttributes)
+          {
+            std::ranges::copy(chunk.texCoordIndices, indices[TexCoords]);
+            std::ranges::copy(chunk.normalIndices, indices[Normals]);
+          }
+          else
+          {
+            std::fill_n(indices[TexCoords], cornerCount, -1);
+            std::fill_n(indices[Normals], cornerCount, -1);
+          }
+        }
+        for (auto r : chunk.relativeIndices)
+          if (auto list = r % 3; indices[list] != nullptr)
+            if ((indices[list][r / 3] += int(offset[list])) < 0)
+              invalid = true;
+        for (int list = 0; list < 3; ++list)
+          if (auto index = indices[list])
+          {
+            // Missing attribute indices are -1
+            auto minIndex = list == Positions ? 0 : -1;
+            auto count = int(counts[list]);
+
+            for (size_t c = 0; c < cornerCount; ++c)
+              if (index[c] < minIndex || index[c] >= count)
+                invalid = true;
+          }
+        chunk = {};
+      }
+    });
+  if (invalid)
+  {
+    fprintf(stderr, "Invalid vertex index in OBJ file %s\n", filename);
+    delete []data.vertices;
+    delete []data.triangles;
+    return nullptr;
+  }
+  if (hasAttributes)
+    weldOBJVertices(data, texCoords, normals, texCoordIndices, normalIndices);
+  return new TriangleMesh{std::move(data)};
+}
+
+//
+// Binary PLY and STL reading
+//
+// The files are read sequentially, in blocks of fileBlockSize
+// bytes, and decoded into the arrays of the mesh data.
+//
+constexpr size_t fileBlockSize = 4 << 20;
+
+class BlockReader
+{
+public:
+  BlockReader(FILE* file):
+    _file{file},
+    _buffer(fileBlockSize)
+  {
+    // do nothing
+  }
+
+  // Returns a pointer to the next n bytes of the file, or null if
+  // the file has less than n bytes left.
+  const uint8_t* next(size_t n)
+  {
+    if (_end - _position < n && !fill(n))
+      return nullptr;
+
+    auto p = _buffer.data() + _position;
+
+    _position += n;
+    return p;
+  }
+
+private:
+  FILE* _file;
+  std::vector<uint8_t> _buffer;
+  size_t _position{};
+  size_t _end{};
+
+  bool fill(size_t n)
+  {
+    // Larger reads come from corrupted sizes
+    constexpr size_t maxSize = size_t(1) << 30;
+    auto left = _end - _position;
+
+    if (n > maxSize)
+      return false;
+    memmove(_buffer.data(), _buffer.data() + _position, left);
+    if (n > _buffer.size())
+      _buffer.resize(n);
+    _position = 0;
+    _end = left + fread(_buffer.data() + left,
+      1,
+      _buffer.size() - left,
+      _file);
+    return _end >= n;
+  }
+
+}; // BlockReader
+
+template <typename T>
+inline T
+load(const uint8_t* p, bool swap)
+{
+  uint8_t bytes[sizeof(T)];
+  T value;
+
+  memcpy(bytes, p, sizeof(T));
+  if (swap)
+    std::reverse(bytes, bytes + sizeof(T));
+  memcpy(&value, bytes, sizeof(T));
+  return value;
+}
+
+enum class PLYType
+{
+  Int8,
+  UInt8,
+  Int16,
+  UInt16,
+  Int32,
+  UInt32,
+  Float32,
+  Float64,
+  Invalid
+};
+
+inline size_t
+plySize(PLYType type)
+{
+  static constexpr size_t sizes[]{1, 1, 2, 2, 4, 4, 4, 8, 0};
+
+  return sizes[int(type)];
+}
+
+PLYType
+plyType(const char* name)
+{
+  static constexpr std::pair<const char*, PLYType> types[]
+  {
+    {"char", PLYType::Int8},
+    {"int8", PLYType::Int8},
+    {"uchar", PLYType::UInt8},
+    {"uint8", PLYType::UInt8},
+    {"short", PLYType::Int16},
+    {"int16", PLYType::Int16},
+    {"ushort", PLYType::UInt16},
+    {"uint16", PLYType::UInt16},
+    {"int", PLYType::Int32},
+    {"int32", PLYType::Int32},
+    {"uint", PLYType::UInt32},
+    {"uint32", PLYType::UInt32},
+    {"float", PLYType::Float32},
+    {"float32", PLYType::Float32},
+    {"double", PLYType::Float64},
+    {"float64", PLYType::Float64}
+  };
+
+  for (auto [typeName, type] : types)
+    if (!strcmp(name, typeName))
+      return type;
+  return PLYType::Invalid;
+}
+
+template <typename T>
+inline T
+plyValue(const uint8_t* p, PLYType type, bool swap)
+{
+  using enum PLYType;
+
+  switch (type)
+  {
+    case Int8: return T(int8_t(*p));
+    case UInt8: return T(*p);
+    case Int16: return T(load<int16_t>(p, swap));
+    case UInt16: return T(load<uint16_t>(p, swap));
+    case Int32: return T(load<int32_t>(p, swap));
+    case UInt32: return T(load<uint32_t>(p, swap));
+    case Float32: return T(load<float>(p, swap));
+    default: return T(load<double>(p, swap));
+  }
+}
+
+struct PLYProperty
+{
+  std::string name;
+  PLYType type;
+  PLYType countType;
+  size_t offset;
+
+  bool isList() const
+  {
+    return countType != PLYType::Invalid;
+  }
+
+}; // PLYProperty
+
+struct PLYElement
+{
+  std::string name;
+  size_t count;
+  std::vector<PLYProperty> properties;
+  // Size of an item, if no property is a list; zero otherwise
+  size_t size{};
+
+}; // PLYElement
+
+//
+// Reads the header of a PLY file, leaving the file at the first
+// byte of the data.
+//
+bool
+readPLYHeader(FILE* file, std::vector<PLYElement>& elements, bool& swap)
+{
+  constexpr auto maxSize = 1024;
+  char line[maxSize];
+  char format[32];
+
+  if (!fgets(line, maxSize, file) || strncmp(line, "ply", 3) != 0)
+    return false;
+  if (!fgets(line, maxSize, file) ||
+    sscanf(line, "format %31s", format) != 1)
+    return false;
+  if (!strcmp(format, "binary_little_endian"))
+    swap = std::endian::native != std::endian::little;
+  else if (!strcmp(format, "binary_big_endian"))
+    swap = std::endian::native != std::endian::big;
+  else
+    return false;
+  while (fgets(line, maxSize, file))
+  {
+    char s[3][64];
+    unsigned long long count;
+
+    if (!strncmp(line, "end_header", 10))
+      return !elements.empty();
+    if (sscanf(line, "element %63s %llu", s[0], &count) == 2)
+      elements.push_back({s[0], count, {}, 0});
+    else if (sscanf(line, "property list %63s %63s %63s", s[0], s[1], s[2])
+      == 3)
+    {
+      if (elements.empty())
+        return false;
+      elements.back().properties.push_back({s[2],
+        plyType(s[1]),
+        plyType(s[0]),
+        0});
+    }
+    else if (sscanf(line, "property %63s %63s", s[0], s[1]) == 2)
+    {
+      if (elements.empty())
+        return false;
+      elements.back().properties.push_back({s[1],
+        plyType(s[0]),
+        PLYType::Invalid,
+        0});
+    }
+    else if (strncmp(line, "comment", 7) && strncmp(line, "obj_info", 8))
+      return false;
+    if (!elements.empty() && !elements.back().properties.empty())
+    {
+      auto& p = elements.back().properties.back();
+
+      if (p.type == PLYType::Invalid)
+        return false;
+    }
+  }
+  return false;
+}
+
+bool
+skipPLYProperty(BlockReader& reader, const PLYProperty& p, bool swap)
+{
+  auto size = plySize(p.type);
+
+  if (p.isList())
+  {
+    auto s = reader.next(plySize(p.countType));
+
+    if (s == nullptr)
+      return false;
+    size *= plyValue<size_t>(s, p.countType, swap);
+  }
+  return reader.next(size) != nullptr;
+}
+
+//
+// Triangle array growing as needed, for faces with more than three
+// vertices.
+//
+class TriangleArray
+{
+public:
+  TriangleArray(size_t capacity):
+    _triangles{new TriangleMesh::Triangle[capacity]},
+    _capacity{capacity}
+  {
+    // do nothing
+  }
+
+  auto size() const
+  {
+    return _size;
+  }
+
+  void add(int v0, int v1, int v2)
+  {
+    if (_size == _capacity)
+    {
+      auto capacity = std::max<size_t>(16, _capacity + _capacity / 2);
+      auto triangles = new TriangleMesh::Triangle[capacity];
+
+      std::copy_n(_triangles.get(), _size, triangles);
+      _triangles.reset(triangles);
+      _capacity = capacity;
+    }
+    _triangles[_size++].setVertices(v0, v1, v2);
+  }
+
+  auto release()
+  {
+    return _triangles.release();
+  }
+
+private:
+  std::unique_ptr<TriangleMesh::Triangle[]> _triangles;
+  size_t _capacity;
+  size_t _size{};
+
+}; // TriangleArray
+
+TriangleMesh*
+parsePLY(FILE* file, const char* filename)
+{
+  std::vector<PLYElement> elements;
+  auto swap = false;
+
+  if (!readPLYHeader(file, elements, swap))
+  {
+    fprintf(stderr, "Invalid or ASCII PLY file %s\n", filename);
+    return nullptr;
+  }
+  for (auto& e : elements)
+  {
+    auto fixedSize = true;
+
+    for (auto& p : e.properties)
+    {
+      p.offset = e.size;
+      e.size += plySize(p.type);
+      fixedSize &= !p.isList();
+    }
+    if (!fixedSize)
+      e.size = 0;
+  }
+
+  auto error = [filename]()
+    {
+      fprintf(stderr, "Invalid or truncated PLY file %s\n", filename);
+      return nullptr;
+    };
+  BlockReader reader{file};
+  std::unique_ptr<vec3f[]> vertices;
+  std::unique_ptr<vec3f[]> normals;
+  std::unique_ptr<vec2f[]> uv;
+  std::unique_ptr<TriangleArray> triangles;
+  size_t vertexCount{};
+
+  for (auto& e : elements)
+    if (e.name == "vertex" && e.size > 0 && vertices == nullptr)
+    {
+      // Properties x, y, z, nx, ny, nz, and u and v (or s and t)
+      constexpr const char* names[][8]
+      {
+        {"x", "y", "z", "nx", "ny", "nz", "u", "v"},
+        {"x", "y", "z", "nx", "ny", "nz", "s", "t"}
+      };
+      const PLYProperty* p[8]{};
+
+      for (auto& property : e.properties)
+        for (auto& n : names)
+          for (int i = 0; i < 8; ++i)
+            if (property.name == n[i])
+              p[i] = &property;
+      if (!p[0] || !p[1] || !p[2] || e.count > INT_MAX)
+        return error();
+      vertexCount = e.count;
+      vertices.reset(new vec3f[vertexCount]);
+      if (p[3] && p[4] && p[5])
+        normals.reset(new vec3f[vertexCount]);
+      if (p[6] && p[7])
+        uv.reset(new vec2f[vertexCount]);
+      for (size_t i = 0; i < vertexCount; ++i)
+      {
+        auto s = reader.next(e.size);
+
+        if (s == nullptr)
+          return error();
+
+        auto value = [s, swap](const PLYProperty* p)
+          {
+            return plyValue<float>(s + p->offset, p->type, swap);
+          };
+
+        vertices[i].set(value(p[0]), value(p[1]), value(p[2]));
+        if (normals)
+          normals[i].set(value(p[3]), value(p[4]), value(p[5]));
+        if (uv)
+          uv[i].set(value(p[6]), value(p[7]));
+      }
+    }
+    else if (e.name == "face" && vertices != nullptr && triangles == nullptr)
+    {
+      const PLYProperty* indices{};
+
+      for (auto& property : e.properties)
+        if (property.isList() &&
+          (property.name == "vertex_indices" ||
+          property.name == "vertex_index"))
+          indices = &property;
+      if (indices == nullptr || e.count > INT_MAX)
+        return error();
+      triangles = std::make_unique<TriangleArray>(e.count);
+
+      const auto countSize = plySize(indices->countType);
+      const auto indexSize = plySize(indices->type);
+
+      for (size_t i = 0; i < e.count; ++i)
+        for (auto& property : e.properties)
+        {
+          if (&property != indices)
+          {
+            if (!skipPLYProperty(reader, property, swap))
+              return error();
+            continue;
+          }
+
+          auto s = reader.next(countSize);
+
+          if (s == nullptr)
+            return error();
+
+          auto n = plyValue<size_t>(s, indices->countType, swap);
+
+          if ((s = reader.next(n * indexSize)) == nullptr)
+            return error();
+
+          int v[3];
+
+          // Faces are triangulated as fans around their first vertex
+          for (size_t k = 0; k < n; ++k, s += indexSize)
+          {
+            auto index = plyValue<int64_t>(s, indices->type, swap);
+
+            if (index < 0 || index >= int64_t(vertexCount))
+              return error();
+            v[k < 2 ? k : 2] = int(index);
+            if (k >= 2)
+            {
+              triangles->add(v[0], v[1], v[2]);
+              v[1] = v[2];
+            }
+          }
+        }
+    }
+    else if (e.size > 0)
+    {
+      for (auto n = e.count; n > 0;)
+      {
+        auto m = std::min<size_t>(n, fileBlockSize / e.size + 1);
+
+        if (reader.next(m * e.size) == nullptr)
+          return error();
+        n -= m;
+      }
+    }
+    else
+      for (size_t i = 0; i < e.count; ++i)
+        for (auto& property : e.properties)
+          if (!skipPLYProperty(reader, property, swap))
+            return error();
+  if (vertices == nullptr || triangles == nullptr)
+    return error();
+
+  TriangleMesh::Data data;
+
+  data.vertexCount = int(vertexCount);
+  data.triangleCount = int(std::min<size_t>(triangles->size(), INT_MAX));
+  data.vertices = vertices.release();
+  data.vertexNormals = normals.release();
+  data.uv = uv.release();
+  data.triangles = triangles->release();
+  if (data.vertexNormals != nullptr)
+    for (int i = 0; i < data.vertexCount; ++i)
+      data.vertexNormals[i].normalize();
+  return new TriangleMesh{std::move(data)};
+}
+
+//
+// Index of the vertices of an STL file, whose triangles store their
+// vertices rather than vertex indices. Equal vertices are welded:
+// the table maps the bit pattern of a vertex to its index in the
+// vertex array. It uses open addressing with linear probing and is
+// doubled when half full.
+//
+class STLVertexTable
+{
+public:
+  STLVertexTable(std::vector<vec3f>& vertices, size_t capacity):
+    _vertices{vertices}
+  {
+    resize(std::bit_ceil(std::max<size_t>(capacity, 1024)));
+  }
+
+  int index(const vec3f& p)
+  {
+    // -0 and 0 are welded
+    vec3f v{p.x + 0.0f, p.y + 0.0f, p.z + 0.0f};
+    auto slot = hash(v) & _mask;
+
+    for (;; slot = (slot + 1) & _mask)
+    {
+      auto i = _slots[slot];
+
+      if (i < 0)
+        break;
+      if (!memcmp(&_vertices[i], &v, sizeof v))
+        return i;
+    }
+
+    auto i = int(_vertices.size());
+
+    _vertices.push_back(v);
+    _slots[slot] = i;
+    if (_vertices.size() > _slots.size() / 2)
+      resize(_slots.size() * 2);
+    return i;
+  }
+
+private:
+  std::vector<vec3f>& _vertices;
+  std::vector<int> _slots;
+  size_t _mask;
+
+  static size_t hash(const vec3f& v)
+  {
+    uint32_t b[3];
+
+    memcpy(b, &v, sizeof b);
+
+    auto h = hash::round64(hash::round64(hash::round64(0, b[0]), b[1]), b[2]);
+
+    return size_t(h ^ (h >> 29));
+  }
+
+  void resize(size_t size)
+  {
+    _slots.assign(size, -1);
+    _mask = size - 1;
+    for (int i = 0, n = int(_vertices.size()); i < n; ++i)
+    {
+      auto slot = hash(_vertices[i]) & _mask;
+
+      while (_slots[slot] >= 0)
+        slot = (slot + 1) & _mask;
+      _slots[slot] = i;
+    }
+  }
+
+}; // STLVertexTable
+
+TriangleMesh*
+parseSTL(FILE* file, const char* filename)
+{
+  constexpr size_t headerSize = 84;
+  constexpr size_t facetSize = 50;
+  constexpr auto swap = std::endian::native != std::endian::little;
+
+  BlockReader reader{file};
+  auto header = reader.next(headerSize);
+  std::error_code ec;
+  auto size = std::filesystem::file_size(filename, ec);
+
+  if (header == nullptr)
+  {
+    fprintf(stderr, "Invalid STL file %s\n", filename);
+    return nullptr;
+  }
+
+  size_t n = load<uint32_t>(header + 80, swap);
+
+  if (size != headerSize + n * facetSize || n > INT_MAX)
+  {
+    fprintf(stderr, "Invalid or ASCII STL file %s\n", filename);
+    return nullptr;
+  }
+
+  std::unique_ptr<TriangleMesh::Triangle[]> triangles;
+  std::vector<vec3f> vertices;
+
+  triangles.reset(new TriangleMesh::Triangle[n]);
+  // A closed mesh has about half as many vertices as triangles
+  vertices.reserve(n / 2 + 3);
+
+  STLVertexTable table{vertices, n};
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    auto s = reader.next(facetSize);
+
+    if (s == nullptr)
+    {
+      fprintf(stderr, "Truncated STL file %s\n", filename);
+      return nullptr;
+    }
+    // Facet normals are ignored
+    s += 12;
+
+    int v[3];
+
+    for (int k = 0; k < 3; ++k, s += 12)
+      v[k] = table.index({load<float>(s, swap),
+        load<float>(s + 4, swap),
+        load<float>(s + 8, swap)});
+    triangles[i].setVertices(v[0], v[1], v[2]);
+  }
+
+  TriangleMesh::Data data;
+
+  data.vertexCount = int(vertices.size());
+  data.triangleCount = int(n);
+  data.vertices = new vec3f[vertices.size()];
+  data.vertexNormals = nullptr;
+  data.uv = nullptr;
+  data.triangles = triangles.release();
+  std::ranges::copy(vertices, data.vertices);
+  return new TriangleMesh{std::move(data)};
+}
+
 } // end namespace
 
 
@@ -146,7 +1302,23 @@ readMeshData(FILE* file, TriangleMesh::Data& data)
 // MeshReader implementation
 // ==========
 TriangleMesh*
-MeshReader::readOBJ(const char* filename)
+MeshReader::readOBJ(const char* filename, bool attributes)
+{
+  Reference<MappedFile> file{MappedFile::open(filename)};
+
+  if (file == nullptr)
+    return readOBJSequential(filename);
+  printf("Reading Wavefront OBJ file %s...\n", filename);
+
+  auto mesh = parseOBJ(filename, *file, attributes);
+
+  if (mesh != nullptr && !mesh->hasVertexNormals())
+    mesh->computeNormals();
+  return mesh;
+}
+
+TriangleMesh*
+MeshReader::readOBJSequential(const char* filename)
 {
   FILE* file = fopen(filename, "r");
 
@@ -170,4 +1342,151 @@ MeshReader::readOBJ(const char* filename)
   return mesh;
 }
 
+/**
+ * @brief Reads the triangle mesh file \p filename written by
+ * MeshWriter::writeMesh().
+ *
+ * The file is mapped into memory with copy-on-write access and the
+ * arrays of the mesh reference its pages directly, hence reading
+ * takes time proportional to the pages touched, not to the size of
+ * the file. If \p verify is true, the checksum of the arrays is
+ * checked, which reads the whole file. Returns null if the file
+ * cannot be mapped, is not a valid triangle mesh file, or does not
+ * match its checksum.
+ */
+TriangleMesh*
+MeshReader::readMesh(const char* filename, bool verify)
+{
+  using Header = TriangleMeshFileHeader;
+
+  Reference<MappedFile> file{MappedFile::open(filename,
+    MappedFile::CopyOnWrite)};
+
+  if (file == nullptr)
+    return nullptr;
+
+  auto header = Header::get(*file);
+
+  if (header == nullptr)
+  {
+    fprintf(stderr, "Invalid mesh file %s\n", filename);
+    return nullptr;
+  }
+
+  const size_t nv = header->vertexCount;
+  const size_t elementSizes[]
+  {
+    sizeof(vec3f),
+    sizeof(vec3f),
+    sizeof(vec2f),
+    sizeof(TriangleMesh::Triangle)
+  };
+  void* arrays[Header::BVH]{};
+  uint64_t checksum{};
+
+  for (int i = 0; i < Header::BVH; ++i)
+  {
+    auto& section = header->sections[i];
+    auto count = i == Header::Triangles ? size_t(header->triangleCount) : nv;
+
+    // Normals and uv are optional
+    if (section.size != elementSizes[i] * count &&
+      (section.size > 0 || i == Header::Vertices || i == Header::Triangles))
+    {
+      fprintf(stderr, "Invalid mesh file %s\n", filename);
+      return nullptr;
+    }
+    if (section.size > 0)
+      arrays[i] = file->data() + section.offset;
+    if (verify)
+      checksum = hash64(arrays[i], section.size, checksum);
+  }
+  if (verify && checksum != header->checksum)
+  {
+    fprintf(stderr, "Checksum mismatch in mesh file %s\n", filename);
+    return nullptr;
+  }
+
+  TriangleMesh::Data data;
+
+  data.vertexCount = header->vertexCount;
+  data.triangleCount = header->triangleCount;
+  data.vertices = (vec3f*)arrays[Header::Vertices];
+  data.vertexNormals = (vec3f*)arrays[Header::Normals];
+  data.uv = (vec2f*)arrays[Header::UV];
+  data.triangles = (TriangleMesh::Triangle*)arrays[Header::Triangles];
+
+  Bounds3f bounds;
+
+  if (header->flags & Header::HasBounds)
+  {
+    auto b = header->bounds;
+
+    bounds.set(vec3f{b[0], b[1], b[2]}, vec3f{b[3], b[4], b[5]});
+  }
+
+  auto mesh = new TriangleMesh{data, file, bounds};
+
+  if (!mesh->hasVertexNormals())
+    mesh->computeNormals();
+  return mesh;
+}
+
+/// Reads the binary (little- or big-endian) PLY file \p filename.
+/// Vertex normals and texture coordinates are read if present.
+TriangleMesh*
+MeshReader::readPLY(const char* filename)
+{
+  FILE* file = fopen(filename, "rb");
+
+  if (file == nullptr)
+    return nullptr;
+  printf("Reading PLY file %s...\n", filename);
+
+  auto mesh = parsePLY(file, filename);
+
+  fclose(file);
+  if (mesh != nullptr && !mesh->hasVertexNormals())
+    mesh->computeNormals();
+  return mesh;
+}
+
+/// Reads the binary STL file \p filename. Equal vertices of the
+/// facets are welded into a single mesh vertex.
+TriangleMesh*
+MeshReader::readSTL(const char* filename)
+{
+  FILE* file = fopen(filename, "rb");
+
+  if (file == nullptr)
+    return nullptr;
+  printf("Reading STL file %s...\n", filename);
+
+  auto mesh = parseSTL(file, filename);
+
+  fclose(file);
+  if (mesh != nullptr)
+    mesh->computeNormals();
+  return mesh;
+}
+
+/// Reads the mesh file \p filename in the format given by its
+/// extension: .ply, .stl, .cgm (triangle mesh file) or OBJ, for
+/// any other extension.
+TriangleMesh*
+MeshReader::read(const char* filename)
+{
+  auto extension = std::filesystem::path{filename}.extension().string();
+
+  for (auto& c : extension)
+    c = char(tolower(c));
+  if (extension == ".ply")
+    return readPLY(filename);
+  if (extension == ".stl")
+    return readSTL(filename);
+  if (extension == ".cgm")
+    return readMesh(filename);
+  return readOBJ(filename);
+}
+
 } // end namespace cg
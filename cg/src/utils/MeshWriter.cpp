@@ -28,32 +28,605 @@
 // Class definition for mesh writer.
 //
 // Author: Paulo Pagliosa
-// Last revision: 29/08/2023
+// Last revision: 19/10/2026
 
+#include "core/Hash.h"
+#include "core/MappedFile.h"
+#include "core/Parallel.h"
+#include "geometry/ChunkedTriangleMeshFile.h"
+#include "geometry/TriangleMeshBVH.h"
 #include "utils/MeshWriter.h"
+#include <algorithm>
+#include <charconv>
 #include <filesystem>
+#include <vector>
 
 namespace cg
 { // begin namespace cg
 
 
+namespace
+{ // begin namespace
+
+//
+// OBJ formatting
+//
+// The records of an OBJ file are formatted in blocks of at most
+// objBlockSize records of the same kind into buffers, which are
+// written in order. Floats are formatted with std::to_chars, which
+// yields the shortest representation read back as the same float.
+//
+constexpr size_t objBlockSize = 1 << 16;
+
+enum class OBJRecord
+{
+  Vertex,
+  TexCoord,
+  Normal,
+  Face
+};
+
+struct OBJBlock
+{
+  OBJRecord record;
+  size_t begin;
+  size_t end;
+  std::vector<char> text;
+
+}; // OBJBlock
+
+inline char*
+formatFloat(char* s, float x)
+{
+  *s++ = ' ';
+  return std::to_chars(s, s + 24, x).ptr;
+}
+
+inline char*
+formatIndex(char* s, int i, bool texCoord, bool normal)
+{
+  auto b = std::to_chars(s, s + 12, i).ptr;
+  auto n = size_t(b - s);
+
+  if (texCoord || normal)
+  {
+    *b++ = '/';
+    if (texCoord)
+      b = (char*)memcpy(b, s, n) + n;
+    if (normal)
+    {
+      *b++ = '/';
+      b = (char*)memcpy(b, s, n) + n;
+    }
+  }
+  return b;
+}
+
+void
+formatOBJBlock(const TriangleMesh::Data& data, OBJBlock& block)
+{
+  using enum OBJRecord;
+
+  // Upper bounds of the sizes of a formatted float (with its leading
+  // space) and vertex index triple, plus slack for std::to_chars
+  constexpr size_t maxFloatSize = 16;
+  constexpr size_t maxIndexSize = 3 * 12;
+  constexpr size_t slack = 32;
+
+  const auto texCoord = data.uv != nullptr;
+  const auto normal = data.vertexNormals != nullptr;
+  const auto n = block.end - block.begin;
+
+  block.text.resize(slack + n * (block.record == Face ?
+    3 * (maxIndexSize + 1) + 3 :
+    3 * maxFloatSize + 4));
+
+  auto s = block.text.data();
+
+  switch (block.record)
+  {
+    case Vertex:
+    case Normal:
+    {
+      auto v = block.record == Vertex ? data.vertices : data.vertexNormals;
+
+      for (auto i = block.begin; i < block.end; ++i)
+      {
+        *s++ = 'v';
+        if (block.record == Normal)
+          *s++ = 'n';
+        s = formatFloat(s, v[i].x);
+        s = formatFloat(s, v[i].y);
+        s = formatFloat(s, v[i].z);
+        *s++ = '\n';
+      }
+      break;
+    }
+
+    case TexCoord:
+      for (auto i = block.begin; i < block.end; ++i)
+      {
+        *s++ = 'v';
+        *s++ = 't';
+        s = formatFloat(s, data.uv[i].x);
+        s = formatFloat(s, data.uv[i].y);
+        *s++ = '\n';
+      }
+      break;
+
+    case Face:
+      for (auto i = block.begin; i < block.end; ++i)
+      {
+        *s++ = 'f';
+        for (auto v : data.triangles[i].v)
+        {
+          *s++ = ' ';
+          s = formatIndex(s, v + 1, texCoord, normal);
+        }
+        *s++ = '\n';
+      }
+      break;
+  }
+  block.text.resize(s - block.text.data());
+}
+
+//
+// Chunking
+//
+// The triangles of a mesh are sorted by the Morton codes of their
+// centroids in the bounds of the mesh and split into runs of
+// consecutive triangles, hence each chunk is a compact cluster of
+// the mesh. The chunks are made in batches, concurrently, and
+// written in order.
+//
+struct MeshChunk
+{
+  Reference<TriangleMesh> mesh;
+  Reference<TriangleMeshBVH> bvh;
+
+}; // MeshChunk
+
+inline uint64_t
+spreadBits(uint32_t x)
+{
+  uint64_t b = x & 0x3ff;
+
+  b = (b | b << 16) & 0x30000ff;
+  b = (b | b << 8) & 0x300f00f;
+  b = (b | b << 4) & 0x30c30c3;
+  b = (b | b << 2) & 0x9249249;
+  return b;
+}
+
+inline uint64_t
+morton(const vec3f& p)
+{
+  const auto q = [](float x)
+    {
+      return uint32_t(std::clamp(x, 0.f, 1.f) * 1023);
+    };
+
+  return spreadBits(q(p.x)) | spreadBits(q(p.y)) << 1 |
+    spreadBits(q(p.z)) << 2;
+}
+
+// Returns the keys of the triangles of a mesh, sorted. The key of a
+// triangle is the Morton code of its centroid in the highest bits,
+// followed by its index. The centroids are scaled by the largest
+// extent of the bounds of the mesh, hence the cells of the codes are
+// cubes and a flat mesh is not split across its thinnest axis first.
+std::vector<uint64_t>
+sortTriangles(const TriangleMesh& mesh)
+{
+  const auto& data = mesh.data();
+  const auto& bounds = mesh.bounds();
+  const auto s = bounds.size().max();
+  const auto scale = s > 0 ? 1 / s : 0;
+  std::vector<uint64_t> keys(data.triangleCount);
+
+  parallelFor(keys.size(), 1 << 14, [&](size_t first, size_t last)
+    {
+      for (auto i = first; i < last; ++i)
+      {
+        auto v = data.triangles[i].v;
+        auto c = (data.vertices[v[0]] + data.vertices[v[1]] +
+          data.vertices[v[2]]) * (1.f / 3);
+
+        keys[i] = morton((c - bounds.min()) * scale) << 32 | i;
+      }
+    });
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+// Makes the mesh of the triangles of the keys [first, last) with
+// the vertices they use, in the order of the vertices of the mesh.
+TriangleMesh*
+makeChunkMesh(const TriangleMesh::Data& data,
+  const uint64_t* first,
+  const uint64_t* last)
+{
+  auto triangle = [&data](const uint64_t* key) -> const auto&
+    {
+      return data.triangles[uint32_t(*key)];
+    };
+  std::vector<int> vertices;
+
+  vertices.reserve(3 * (last - first));
+  for (auto key = first; key != last; ++key)
+    for (auto v : triangle(key).v)
+      vertices.push_back(v);
+  std::sort(vertices.begin(), vertices.end());
+  vertices.erase(std::unique(vertices.begin(), vertices.end()),
+    vertices.end());
+
+  auto nv = (int)vertices.size();
+  auto nt = int(last - first);
+  TriangleMesh::Data chunk;
+
+  chunk.vertexCount = nv;
+  chunk.triangleCount = nt;
+  chunk.vertices = new vec3f[nv];
+  chunk.vertexNormals = data.vertexNormals ? new vec3f[nv] : nullptr;
+  chunk.uv = data.uv ? new vec2f[nv] : nullptr;
+  chunk.triangles = new TriangleMesh::Triangle[nt];
+  for (int i = 0; i < nv; ++i)
+  {
+    auto v = vertices[i];
+
+    chunk.vertices[i] = data.vertices[v];
+    if (chunk.vertexNormals)
+      chunk.vertexNormals[i] = data.vertexNormals[v];
+    if (chunk.uv)
+      chunk.uv[i] = data.uv[v];
+  }
+  for (int i = 0; i < nt; ++i)
+  {
+    auto v = triangle(first + i).v;
+
+    for (int k = 0; k < 3; ++k)
+      chunk.triangles[i].v[k] = int(std::lower_bound(vertices.begin(),
+        vertices.end(),
+        v[k]) - vertices.begin());
+  }
+  return new TriangleMesh{std::move(chunk)};
+}
+
+} // end namespace
+
+
 /////////////////////////////////////////////////////////////////////
 //
 // MeshWriter implementation
 // ==========
+/**
+ * @brief Writes \p mesh to the Wavefront OBJ file \p filename.
+ *
+ * The vertex texture coordinates and normals of the mesh, if any,
+ * are written and referenced by the faces. If \p parallel is true,
+ * blocks of records are formatted concurrently and written in
+ * order.
+ */
 bool
-MeshWriter::writeOBJ(const TriangleMesh& mesh, const char* filename)
+MeshWriter::writeOBJ(const TriangleMesh& mesh,
+  const char* filename,
+  bool parallel)
 {
-  FILE* file = fopen(filename, "w");
+  FILE* file = fopen(filename, "wb");
 
   if (file == nullptr)
     return false;
   printf("Writing Wavefront OBJ file %s...\n", filename);
 
   auto& data = mesh.data();
-  // TODO
+  std::vector<OBJBlock> blocks;
+  auto addBlocks = [&](OBJRecord record, size_t count)
+    {
+      for (size_t i = 0; i < count; i += objBlockSize)
+        blocks.push_back({record, i, std::min(i + objBlockSize, count), {}});
+    };
+
+  addBlocks(OBJRecord::Vertex, data.vertexCount);
+  if (mesh.hasUV())
+    addBlocks(OBJRecord::TexCoord, data.vertexCount);
+  if (mesh.hasVertexNormals())
+    addBlocks(OBJRecord::Normal, data.vertexCount);
+  addBlocks(OBJRecord::Face, data.triangleCount);
+
+  auto ok = fprintf(file,
+    "# %d vertices, %d triangles\n",
+    data.vertexCount,
+    data.triangleCount) > 0;
+  // Blocks formatted before being written, which bounds the memory
+  // used by the buffers
+  const size_t batchSize = parallel ? 4 * parallelThreadCount() : 1;
+
+  for (size_t b = 0; ok && b < blocks.size(); b += batchSize)
+  {
+    auto n = std::min(batchSize, blocks.size() - b);
+
+    parallelFor(n, 1, [&](size_t first, size_t last)
+      {
+        for (auto i = first; i < last; ++i)
+          formatOBJBlock(data, blocks[b + i]);
+      });
+    for (auto i = b; ok && i < b + n; ++i)
+    {
+      auto& text = blocks[i].text;
+
+      ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+      std::vector<char>{}.swap(text);
+    }
+  }
+  ok &= fclose(file) == 0;
+  return ok;
+}
+
+/**
+ * @brief Writes \p mesh to the triangle mesh file \p filename.
+ *
+ * If \p bvh is not null, its nodes are stored in the file, and
+ * TriangleMeshBVH::make() adopts them for a mesh read from the file
+ * with MeshReader::readMesh() if the build parameters match. The
+ * BVH must be a BVH of \p mesh with binary nodes, that is, with a
+ * layout other than the quantized ones.
+ *
+ * The data are first written to a temporary file, which is then
+ * renamed, so readers never see a partially written file.
+ */
+bool
+MeshWriter::writeMesh(const TriangleMesh& mesh,
+  const char* filename,
+  const TriangleMeshBVH* bvh)
+{
+  using Header = TriangleMeshFileHeader;
+
+  if (bvh != nullptr && (bvh->mesh() != &mesh || bvh->writeSize() == 0))
+    return false;
+
+  const auto& data = mesh.data();
+  const void* arrays[Header::SectionCount]
+  {
+    data.vertices,
+    data.vertexNormals,
+    data.uv,
+    data.triangles
+  };
+  const size_t sizes[Header::SectionCount]
+  {
+    sizeof(vec3f) * data.vertexCount,
+    sizeof(vec3f) * data.vertexCount * mesh.hasVertexNormals(),
+    sizeof(vec2f) * data.vertexCount * mesh.hasUV(),
+    sizeof(TriangleMesh::Triangle) * data.triangleCount,
+    bvh != nullptr ? bvh->writeSize() : 0
+  };
+  Header header{};
+
+  memcpy(header.magic, Header::fileMagic, sizeof Header::fileMagic);
+  header.version = Header::fileVersion;
+  header.byteOrder = Header::fileByteOrder;
+  header.flags = Header::HasBounds;
+  header.vertexCount = data.vertexCount;
+  header.triangleCount = data.triangleCount;
+
+  const auto& bounds = mesh.bounds();
+
+  memcpy(header.bounds, &bounds.min(), sizeof(vec3f));
+  memcpy(header.bounds + 3, &bounds.max(), sizeof(vec3f));
+
+  auto offset = sizeof header;
+
+  for (int i = 0; i < Header::SectionCount; ++i)
+  {
+    offset = (offset + Header::alignment - 1) & ~(Header::alignment - 1);
+    if (sizes[i] > 0)
+    {
+      header.sections[i] = {offset, sizes[i]};
+      offset += sizes[i];
+    }
+    if (i < Header::BVH)
+      header.checksum = hash64(arrays[i], sizes[i], header.checksum);
+  }
+
+  namespace fs = std::filesystem;
+
+  const fs::path path{filename};
+  const fs::path temp{MappedFile::tempName(filename)};
+
+  auto file = fopen(temp.string().c_str(), "wb");
+
+  if (file == nullptr)
+    return false;
+
+  auto ok = fwrite(&header, sizeof header, 1, file) == 1;
+
+  offset = sizeof header;
+  for (int i = 0; ok && i < Header::SectionCount; ++i)
+    if (auto& section = header.sections[i]; section.size > 0)
+    {
+      char padding[Header::alignment]{};
+      auto n = size_t(section.offset - offset);
+
+      ok = fwrite(padding, 1, n, file) == n;
+      if (ok)
+        ok = i == Header::BVH ?
+          bvh->write(file, header.checksum) :
+          fwrite(arrays[i], section.size, 1, file) == 1;
+      offset = section.offset + section.size;
+    }
+  ok &= fclose(file) == 0;
+
+  std::error_code ec;
 
-  fclose(file);
+  if (ok)
+    fs::rename(temp, path, ec);
+  if (!ok || ec)
+  {
+    fs::remove(temp, ec);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Writes \p mesh to the chunked triangle mesh file
+ * \p filename (see ChunkedTriangleMesh).
+ *
+ * The triangles of the mesh are clustered in chunks of at most
+ * \p maxTrianglesPerChunk triangles, each stored with the nodes of
+ * its BVH built with \p maxTrianglesPerNode triangles per leaf.
+ * Only a batch of chunks is in memory at a time, hence \p mesh can
+ * be larger than the memory if its arrays are in the pages of a
+ * mapped file, e.g., of a mesh read by MeshReader::readMesh(). The
+ * vertex normals of the mesh, if any, are stored in the chunks, so
+ * they are the same on both sides of the chunk boundaries.
+ *
+ * As in writeMesh(), the data are first written to a temporary
+ * file, which is then renamed.
+ */
+bool
+MeshWriter::writeChunkedMesh(const TriangleMesh& mesh,
+  const char* filename,
+  int maxTrianglesPerChunk,
+  uint32_t maxTrianglesPerNode)
+{
+  using Header = ChunkedTriangleMeshFileHeader;
+  using Section = TriangleMeshFileHeader::Section;
+
+  const auto& data = mesh.data();
+  const size_t nt = data.triangleCount;
+
+  if (nt == 0 || maxTrianglesPerChunk <= 0)
+    return false;
+
+  namespace fs = std::filesystem;
+
+  const fs::path path{filename};
+  const fs::path temp{MappedFile::tempName(filename)};
+
+  auto file = fopen(temp.string().c_str(), "wb");
+
+  if (file == nullptr)
+    return false;
+
+  const auto keys = sortTriangles(mesh);
+  const auto nc = (nt + maxTrianglesPerChunk - 1) / maxTrianglesPerChunk;
+  std::vector<Header::Chunk> chunks(nc);
+  Header header{};
+
+  memcpy(header.magic, Header::fileMagic, sizeof Header::fileMagic);
+  header.version = Header::fileVersion;
+  header.byteOrder = Header::fileByteOrder;
+  header.triangleCount = data.triangleCount;
+  header.chunkCount = (int32_t)nc;
+  header.maxTrianglesPerNode = maxTrianglesPerNode;
+
+  const auto& bounds = mesh.bounds();
+
+  memcpy(header.bounds, &bounds.min(), sizeof(vec3f));
+  memcpy(header.bounds + 3, &bounds.max(), sizeof(vec3f));
+
+  // The header is written again, after the chunk table
+  auto ok = fwrite(&header, sizeof header, 1, file) == 1;
+  uint64_t offset = sizeof header;
+  std::vector<char> padding(Header::chunkAlignment);
+  auto pad = [&](uint64_t alignment)
+    {
+      auto n = size_t(-offset & (alignment - 1));
+
+      offset += n;
+      return fwrite(padding.data(), 1, n, file) == n;
+    };
+  int64_t vertexCount{};
+  // Chunks made before being written, which bounds the memory used
+  // by the chunks in memory
+  const size_t batchSize = 4 * parallelThreadCount();
+  std::vector<MeshChunk> batch(batchSize);
+
+  for (size_t b = 0; ok && b < nc; b += batchSize)
+  {
+    auto n = std::min(batchSize, nc - b);
+
+    // Chunks of nt / nc triangles, give or take one
+    parallelFor(n, 1, [&](size_t first, size_t last)
+      {
+        for (auto i = first; i < last; ++i)
+        {
+          auto c = b + i;
+          auto& chunk = batch[i];
+
+          chunk.mesh = makeChunkMesh(data,
+            keys.data() + c * nt / nc,
+            keys.data() + (c + 1) * nt / nc);
+          chunk.bvh = new TriangleMeshBVH{*chunk.mesh, maxTrianglesPerNode};
+        }
+      });
+    for (size_t i = 0; ok && i < n; ++i)
+    {
+      auto c = b + i;
+      const auto& chunkMesh = *batch[i].mesh;
+      const auto& chunkData = chunkMesh.data();
+      const void* arrays[Section::SectionCount]
+      {
+        chunkData.vertices,
+        chunkData.vertexNormals,
+        chunkData.uv,
+        chunkData.triangles
+      };
+      const size_t sizes[Section::SectionCount]
+      {
+        sizeof(vec3f) * chunkData.vertexCount,
+        sizeof(vec3f) * chunkData.vertexCount * chunkMesh.hasVertexNormals(),
+        sizeof(vec2f) * chunkData.vertexCount * chunkMesh.hasUV(),
+        sizeof(TriangleMesh::Triangle) * chunkData.triangleCount,
+        batch[i].bvh->writeSize()
+      };
+      auto& chunk = chunks[c];
+      const auto& chunkBounds = chunkMesh.bounds();
+
+      memcpy(chunk.bounds, &chunkBounds.min(), sizeof(vec3f));
+      memcpy(chunk.bounds + 3, &chunkBounds.max(), sizeof(vec3f));
+      chunk.vertexCount = chunkData.vertexCount;
+      chunk.triangleCount = chunkData.triangleCount;
+      chunk.firstTriangle = int32_t(c * nt / nc);
+      vertexCount += chunkData.vertexCount;
+      for (int s = 0; s < Section::BVH; ++s)
+        chunk.checksum = hash64(arrays[s], sizes[s], chunk.checksum);
+      ok = pad(Header::chunkAlignment);
+      for (int s = 0; ok && s < Section::SectionCount; ++s)
+        if (sizes[s] > 0)
+        {
+          ok = pad(Header::alignment);
+          chunk.sections[s] = {offset, sizes[s]};
+          if (ok)
+            ok = s == Section::BVH ?
+              batch[i].bvh->write(file, chunk.checksum) :
+              fwrite(arrays[s], sizes[s], 1, file) == 1;
+          offset += sizes[s];
+        }
+      batch[i] = {};
+    }
+  }
+  ok = ok && vertexCount <= INT32_MAX && pad(Header::alignment);
+  if (ok)
+  {
+    header.vertexCount = (int32_t)vertexCount;
+    header.chunkTableOffset = offset;
+    ok = fwrite(chunks.data(), sizeof(Header::Chunk), nc, file) == nc &&
+      fseek(file, 0, SEEK_SET) == 0 &&
+      fwrite(&header, sizeof header, 1, file) == 1;
+  }
+  ok &= fclose(file) == 0;
+
+  std::error_code ec;
+
+  if (ok)
+    fs::rename(temp, path, ec);
+  if (!ok || ec)
+  {
+    fs::remove(temp, ec);
+    return false;
+  }
   return true;
 }
 
@@ -0,0 +1,595 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: BVHBench.cpp
+// ========
+// BVH build and traversal benchmark.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#include "geometry/BVHAnalysis.h"
+#include "geometry/MeshSweeper.h"
+#include "utils/MeshReader.h"
+#include "utils/Stopwatch.h"
+#include "core/Parallel.h"
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+
+using namespace cg;
+
+namespace
+{ // begin namespace
+
+//
+// Sphere primitive used to benchmark BVH<T>.
+//
+class Sphere: public SharedObject
+{
+public:
+  Sphere(const vec3f& center, float radius):
+    _center{center},
+    _radius{radius}
+  {
+    // do nothing
+  }
+
+  Bounds3f bounds() const
+  {
+    return {_center - vec3f{_radius}, _center + vec3f{_radius}};
+  }
+
+  bool intersect(const Ray3f& ray) const
+  {
+    float t;
+
+    return intersect(ray, t);
+  }
+
+  bool intersect(const Ray3f& ray, Intersection& hit) const
+  {
+    float t;
+
+    if (!intersect(ray, t))
+      return false;
+    hit.object = this;
+    hit.distance = t;
+    return true;
+  }
+
+private:
+  vec3f _center;
+  float _radius;
+
+  bool intersect(const Ray3f& ray, float& t) const
+  {
+    auto d = ray.origin - _center;
+    auto a = ray.direction.dot(ray.direction);
+    auto b = d.dot(ray.direction);
+    auto c = d.dot(d) - _radius * _radius;
+    auto delta = b * b - a * c;
+
+    if (delta < 0)
+      return false;
+    delta = sqrt(delta);
+    t = (-b - delta) / a;
+    if (t < ray.tMin)
+      t = (-b + delta) / a;
+    return t >= ray.tMin && t <= ray.tMax;
+  }
+
+}; // Sphere
+
+struct Options
+{
+  size_t rayCount{200000};
+  uint32_t maxPrimitivesPerNode{4};
+  BVHBase::NodeLayout layout{BVHBase::Binary};
+  bool epo{};
+  bool sortRays{};
+  bool packTriangles{};
+  bool query{};
+
+};
+
+std::mt19937 rng;
+std::uniform_real_distribution<float> uniform{0, 1};
+
+inline auto
+random(float min, float max)
+{
+  return min + (max - min) * uniform(rng);
+}
+
+inline auto
+randomPoint(const Bounds3f& b)
+{
+  const auto& p1 = b.min();
+  const auto& p2 = b.max();
+
+  return vec3f{random(p1.x, p2.x), random(p1.y, p2.y), random(p1.z, p2.z)};
+}
+
+inline auto
+randomDirection()
+{
+  auto z = random(-1, 1);
+  auto r = sqrtf(math::max(0.f, 1 - z * z));
+  auto a = random(0, 2 * math::pi<float>);
+
+  return vec3f{r * cosf(a), r * sinf(a), z};
+}
+
+TriangleMesh*
+makeSoup(int n, float size, float minLength, float maxLength)
+{
+  TriangleMesh::Data data;
+
+  data.vertexCount = 3 * n;
+  data.triangleCount = n;
+  data.vertices = new vec3f[3 * n];
+  data.vertexNormals = nullptr;
+  data.triangles = new TriangleMesh::Triangle[n];
+
+  Bounds3f box{vec3f{-size}, vec3f{size}};
+
+  for (int i = 0; i < n; ++i)
+  {
+    auto c = randomPoint(box);
+    auto d = randomDirection() * random(minLength, maxLength);
+    auto e = randomDirection() * minLength;
+    auto v = data.vertices + 3 * i;
+
+    v[0] = c - d;
+    v[1] = c + d;
+    v[2] = c + e;
+    data.triangles[i].setVertices(3 * i, 3 * i + 1, 3 * i + 2);
+  }
+  return new TriangleMesh{std::move(data)};
+}
+
+TriangleMesh*
+makeTerrain(int n)
+{
+  TriangleMesh::Data data;
+  auto nv = (n + 1) * (n + 1);
+
+  data.vertexCount = nv;
+  data.triangleCount = 2 * n * n;
+  data.vertices = new vec3f[nv];
+  data.vertexNormals = nullptr;
+  data.triangles = new TriangleMesh::Triangle[2 * n * n];
+  for (int j = 0, k = 0; j <= n; ++j)
+    for (int i = 0; i <= n; ++i)
+    {
+      auto x = float(i) / n * 10 - 5;
+      auto y = float(j) / n * 10 - 5;
+
+      data.vertices[k++] = {x, y, sinf(x * 1.7f) * cosf(y * 2.3f) * 0.5f};
+    }
+  for (int j = 0, k = 0; j < n; ++j)
+    for (int i = 0; i < n; ++i)
+    {
+      auto v = j * (n + 1) + i;
+
+      data.triangles[k++].setVertices(v, v + 1, v + n + 2);
+      data.triangles[k++].setVertices(v, v + n + 2, v + n + 1);
+    }
+  return new TriangleMesh{std::move(data)};
+}
+
+auto
+makeRays(const Bounds3f& bounds, size_t n)
+{
+  auto b = bounds;
+  std::vector<Ray3f> rays;
+
+  // Shoot rays from inside a box slightly larger than the scene.
+  b.inflate(1.2f);
+  rays.reserve(n);
+  for (size_t i = 0; i < n; ++i)
+    rays.emplace_back(randomPoint(b), randomDirection());
+  return rays;
+}
+
+const char*
+splitMethodName(BVHBase::SplitMethod method)
+{
+  static const char* names[]{"SAH", "Median", "Spatial"};
+  return names[int(method)];
+}
+
+void
+printHeader(const char* scene, size_t primitiveCount)
+{
+  printf("\n%s: %zu primitives\n", scene, primitiveCount);
+  printf("%-8s %10s %12s %9s %8s %8s %10s %10s\n",
+    "split",
+    "build(ms)",
+    "memory(B)",
+    "SAH",
+    "overlap",
+    "EPO",
+    "Mrays/s",
+    "occl Mr/s");
+}
+
+template <typename B>
+void
+trace(const B& bvh,
+  const BVHAnalysis& a,
+  BVHBase::SplitMethod method,
+  double buildTime,
+  const std::vector<Ray3f>& rays,
+  const Options& options)
+{
+  auto n = rays.size();
+  std::vector<Intersection> hits(n);
+  std::unique_ptr<bool[]> occluded{new bool[n]};
+  Stopwatch sw;
+
+  sw.start();
+  bvh.intersect(rays, hits, options.sortRays);
+
+  auto closestTime = sw.time();
+  Stopwatch sw2;
+
+  sw2.start();
+  bvh.intersect(rays, std::span<bool>{occluded.get(), n}, options.sortRays);
+
+  auto occlusionTime = sw2.time();
+  char epo[16] = "-";
+
+  if (a.epo >= 0)
+    snprintf(epo, sizeof epo, "%.4f", a.epo);
+  printf("%-8s %10.1f %12zu %9.2f %8.3f %8s %10.2f %10.2f\n",
+    splitMethodName(method),
+    buildTime,
+    bvh.memorySize(),
+    a.sahCost,
+    a.siblingOverlap,
+    epo,
+    n / closestTime * 1e-3,
+    n / occlusionTime * 1e-3);
+}
+
+//
+// Checks the frustum and box queries of bvh against a linear scan
+// of the primitive bounds: no primitive reported in a contained
+// range can be outside a volume and, unless the BVH was built by
+// spatial splits, every primitive whose bounds are not outside the
+// volume must be reported. (The references of a split primitive
+// are bounded by the bounds of its clipped parts, which can miss a
+// volume that the bounds of the primitive intersect.)
+//
+template <typename V, typename Outside>
+void
+query(const BVHBase& bvh,
+  const std::vector<Bounds3f>& bounds,
+  const char* name,
+  const V& volume,
+  Outside isOutside)
+{
+  constexpr auto repeat = 20;
+  const auto n = bounds.size();
+  std::vector<uint8_t> reported(n);
+  size_t contained{};
+
+  bvh.query(volume, [&](uint32_t first, uint32_t count, bool inside)
+    {
+      for (auto i = first, e = i + count; i < e; ++i)
+      {
+        auto id = bvh.primitiveId(i);
+
+        reported[id] |= inside ? 2 : 1;
+        contained += inside;
+      }
+    });
+
+  size_t found{};
+  size_t missed{};
+  size_t wrong{};
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    auto outside = isOutside(volume, bounds[i]);
+
+    found += !outside;
+    missed += !outside && !reported[i];
+    wrong += outside && (reported[i] & 2);
+  }
+  if (bvh.splitMethod() == BVHBase::SplitMethod::Spatial)
+    missed = 0;
+
+  Stopwatch sw;
+
+  sw.start();
+  for (int k = 0; k < repeat; ++k)
+    bvh.query(volume, [](uint32_t, uint32_t, bool) {});
+
+  auto queryTime = sw.time() / repeat;
+  Stopwatch sw2;
+  size_t count{};
+
+  sw2.start();
+  for (int k = 0; k < repeat; ++k)
+    for (const auto& b : bounds)
+      count += !isOutside(volume, b);
+
+  auto scanTime = sw2.time() / repeat;
+
+  printf("%-8s %-8s %10zu %10zu %10.3f %10.3f %s\n",
+    "",
+    name,
+    found,
+    contained,
+    queryTime,
+    scanTime,
+    missed + wrong == 0 && count == found * repeat ? "ok" : "FAILED");
+}
+
+void
+query(const BVHBase& bvh, const std::vector<Bounds3f>& bounds)
+{
+  Bounds3f scene;
+
+  for (const auto& b : bounds)
+    scene.inflate(b);
+
+  // A camera outside the scene looking at its center, and the box
+  // between the center and the maximum corner of the scene.
+  auto c = scene.center();
+  auto d = scene.diagonalLength();
+  auto eye = c + vec3f{0.9f, 0.5f, 0.3f} * d;
+  Frustum frustum{mat4f::perspective(30, 1.5f, 0.01f * d, 2 * d) *
+    mat4f::lookAt(eye, c, vec3f{0, 0, 1})};
+  Bounds3f box{c, scene.max()};
+
+  printf("%-8s %-8s %10s %10s %10s %10s\n",
+    "",
+    "query",
+    "found",
+    "contained",
+    "BVH(ms)",
+    "scan(ms)");
+  query(bvh, bounds, "frustum", frustum, [](const Frustum& f, const Bounds3f& b)
+    {
+      return f.classify(b) == Frustum::Outside;
+    });
+  query(bvh, bounds, "box", box, [](const Bounds3f& box, const Bounds3f& b)
+    {
+      return !box.overlap(b);
+    });
+}
+
+constexpr BVHBase::SplitMethod splitMethods[]
+{
+  BVHBase::SAH,
+  BVHBase::Median,
+  BVHBase::Spatial
+};
+
+void
+benchMesh(const char* name, const TriangleMesh& mesh, const Options& options)
+{
+  auto rays = makeRays(mesh.bounds(), options.rayCount);
+
+  printHeader(name, mesh.data().triangleCount);
+  for (auto method : splitMethods)
+  {
+    Stopwatch sw;
+
+    sw.start();
+
+    Reference<TriangleMeshBVH> bvh{new TriangleMeshBVH{mesh,
+      options.maxPrimitivesPerNode,
+      method,
+      options.layout}};
+
+    if (options.packTriangles)
+      bvh->setPackedTriangles(true);
+
+    auto buildTime = sw.time();
+
+    trace(*bvh,
+      BVHAnalysis{*bvh, options.epo},
+      method,
+      buildTime,
+      rays,
+      options);
+    if (bvh->packedTriangles())
+      printf("%-8s %10s %12zu (packed triangles)\n",
+        "",
+        "",
+        bvh->packedTriangleMemorySize());
+    if (options.query)
+    {
+      const auto& m = mesh.data();
+      std::vector<Bounds3f> bounds(m.triangleCount);
+
+      for (int i = 0; i < m.triangleCount; ++i)
+        for (auto v : m.triangles[i].v)
+          bounds[i].inflate(m.vertices[v]);
+      query(*bvh, bounds);
+    }
+  }
+}
+
+void
+benchSpheres(int n, const Options& options)
+{
+  BVH<Sphere>::PrimitiveArray spheres;
+  Bounds3f box{vec3f{-10}, vec3f{10}};
+  Bounds3f bounds;
+
+  for (int i = 0; i < n; ++i)
+  {
+    spheres.push_back(new Sphere{randomPoint(box), random(0.01f, 0.2f)});
+    bounds.inflate(spheres.back()->bounds());
+  }
+
+  auto rays = makeRays(bounds, options.rayCount);
+
+  printHeader("BVH<Sphere>", spheres.size());
+  for (auto method : splitMethods)
+  {
+    auto primitives = spheres;
+    Stopwatch sw;
+
+    sw.start();
+
+    Reference<BVH<Sphere>> bvh{new BVH<Sphere>{std::move(primitives),
+      options.maxPrimitivesPerNode,
+      method,
+      options.layout}};
+    auto buildTime = sw.time();
+
+    trace(*bvh, BVHAnalysis{*bvh}, method, buildTime, rays, options);
+    if (options.query)
+    {
+      std::vector<Bounds3f> bounds;
+
+      bounds.reserve(spheres.size());
+      for (const auto& sphere : spheres)
+        bounds.push_back(sphere->bounds());
+      query(*bvh, bounds);
+    }
+  }
+}
+
+void
+usage()
+{
+  puts("Usage: bvhbench [options] [file.obj...]\n"
+    "Options:\n"
+    "  --rays n         number of rays per test (default 200000)\n"
+    "  --leaf n         maximum number of primitives per leaf (default 4)\n"
+    "  --layout name    binary, wide4, wide8, quantized8 or quantized16\n"
+    "  --sort           sort the rays before tracing\n"
+    "  --packed         pack the triangles of the leaves for SIMD tests\n"
+    "  --query          check frustum and box queries against a scan\n"
+    "  --epo            compute the end-point overlap (slow)");
+}
+
+} // end namespace
+
+int
+main(int argc, char** argv)
+{
+  Options options;
+  std::vector<const char*> files;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    auto arg = argv[i];
+    auto hasValue = i + 1 < argc;
+
+    if (!strcmp(arg, "--rays") && hasValue)
+      options.rayCount = strtoull(argv[++i], nullptr, 10);
+    else if (!strcmp(arg, "--leaf") && hasValue)
+      options.maxPrimitivesPerNode = std::max(1, atoi(argv[++i]));
+    else if (!strcmp(arg, "--layout") && hasValue)
+    {
+      static const char* names[]
+      {
+        "binary", "wide4", "wide8", "quantized8", "quantized16"
+      };
+      std::string name{argv[++i]};
+      int layout = 0;
+
+      while (layout < 5 && name != names[layout])
+        ++layout;
+      if (layout == 5)
+      {
+        usage();
+        return 1;
+      }
+      options.layout = BVHBase::NodeLayout(layout);
+    }
+    else if (!strcmp(arg, "--sort"))
+      options.sortRays = true;
+    else if (!strcmp(arg, "--packed"))
+      options.packTriangles = true;
+    else if (!strcmp(arg, "--epo"))
+      options.epo = true;
+    else if (!strcmp(arg, "--query"))
+      options.query = true;
+    else if (*arg == '-')
+    {
+      usage();
+      return 1;
+    }
+    else
+      files.push_back(arg);
+  }
+  printf("Threads: %u, rays: %zu\n", parallelThreadCount(), options.rayCount);
+
+  // Generated scenes. The generator is reseeded for every scene, so
+  // each scene and its rays are the same in every run.
+  {
+    rng.seed(1);
+
+    Reference<TriangleMesh> mesh{MeshSweeper::makeSphere(256)};
+
+    benchMesh("Sphere", *mesh, options);
+  }
+  {
+    rng.seed(2);
+
+    Reference<TriangleMesh> mesh{makeTerrain(300)};
+
+    benchMesh("Terrain", *mesh, options);
+  }
+  {
+    rng.seed(3);
+
+    Reference<TriangleMesh> mesh{makeSoup(100000, 5, 0.05f, 0.2f)};
+
+    benchMesh("Soup", *mesh, options);
+  }
+  {
+    rng.seed(4);
+
+    Reference<TriangleMesh> mesh{makeSoup(50000, 5, 0.01f, 1.5f)};
+
+    benchMesh("Slivers", *mesh, options);
+  }
+  rng.seed(5);
+  benchSpheres(100000, options);
+  for (auto file : files)
+  {
+    rng.seed(6);
+
+    Reference<TriangleMesh> mesh{MeshReader::readOBJ(file)};
+
+    if (mesh == nullptr)
+      fprintf(stderr, "Unable to read %s\n", file);
+    else
+      benchMesh(file, *mesh, options);
+  }
+  return 0;
+}
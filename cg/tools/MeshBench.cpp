@@ -0,0 +1,1057 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: MeshBench.cpp
+// ========
+// Mesh reader benchmark.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#include "geometry/ChunkedTriangleMesh.h"
+#include "geometry/MeshOptimizer.h"
+#include "geometry/TriangleMeshAdjacency.h"
+#include "geometry/TriangleMeshBVH.h"
+#include "geometry/TriangleMeshLOD.h"
+#include "utils/MeshReader.h"
+#include "utils/MeshWriter.h"
+#include "utils/Stopwatch.h"
+#include "core/Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+
+using namespace cg;
+
+namespace
+{ // begin namespace
+
+struct Options
+{
+  size_t generatedSize{1024};
+  int runs{1};
+  bool keep{};
+  int chunkTriangleCount{MeshWriter::dflChunkTriangleCount};
+  // Residency budget in MB of the chunked mesh; 0 is a quarter of
+  // the bytes of its chunks
+  size_t residencyBudget{};
+
+};
+
+//
+// Writes a terrain of quads, with vertex texture coordinates and
+// normals, to an OBJ file of about size megabytes.
+//
+bool
+writeTerrain(const char* filename, size_t size)
+{
+  // About 177 bytes per vertex and face
+  auto n = int(std::sqrt(double(size << 20) / 177)) + 2;
+  auto file = fopen(filename, "w");
+
+  if (file == nullptr)
+    return false;
+
+  std::mt19937 rng{1};
+  std::uniform_real_distribution<float> uniform{-0.01f, 0.01f};
+  auto d = 1.0f / (n - 1);
+
+  fprintf(file, "# Generated terrain: %d x %d vertices\n", n, n);
+  for (int j = 0; j < n; ++j)
+    for (int i = 0; i < n; ++i)
+    {
+      auto x = i * d;
+      auto y = j * d;
+      auto sx = std::sin(8 * x);
+      auto cy = std::cos(8 * y);
+      vec3f normal{-0.8f * std::cos(8 * x) * cy,
+        0.8f * sx * std::sin(8 * y),
+        1};
+
+      normal.normalize();
+      fprintf(file, "v %.6f %.6f %.6f\n", x, y, 0.1f * sx * cy + uniform(rng));
+      fprintf(file, "vt %.6f %.6f\n", x, y);
+      fprintf(file, "vn %.6f %.6f %.6f\n", normal.x, normal.y, normal.z);
+    }
+  for (int j = 0; j < n - 1; ++j)
+    for (int i = 0; i < n - 1; ++i)
+    {
+      auto v = j * n + i + 1;
+
+      fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
+        v, v, v,
+        v + 1, v + 1, v + 1,
+        v + n + 1, v + n + 1, v + n + 1,
+        v + n, v + n, v + n);
+    }
+  return fclose(file) == 0;
+}
+
+//
+// Returns the number of vertices and triangles of b differing
+// from the ones of a. The counts must match.
+//
+std::pair<size_t, size_t>
+compare(const TriangleMesh& a, const TriangleMesh& b)
+{
+  auto& da = a.data();
+  auto& db = b.data();
+  size_t nv{};
+  size_t nt{};
+
+  for (int i = 0; i < da.vertexCount; ++i)
+    nv += da.vertices[i] != db.vertices[i];
+  for (int i = 0; i < da.triangleCount; ++i)
+    nt += memcmp(da.triangles + i, db.triangles + i, sizeof *da.triangles) != 0;
+  return {nv, nt};
+}
+
+size_t
+memorySize(const TriangleMesh& mesh)
+{
+  auto& data = mesh.data();
+  size_t vertexSize = sizeof(vec3f);
+
+  if (mesh.hasVertexNormals())
+    vertexSize += sizeof(vec3f);
+  if (mesh.hasUV())
+    vertexSize += sizeof(vec2f);
+  return data.vertexCount * vertexSize +
+    data.triangleCount * sizeof(TriangleMesh::Triangle);
+}
+
+//
+// Writes mesh with fprintf, as a baseline for MeshWriter::writeOBJ.
+// %.9g is needed to read back the same floats.
+//
+bool
+writeOBJPrintf(const TriangleMesh& mesh, const char* filename)
+{
+  auto file = fopen(filename, "w");
+
+  if (file == nullptr)
+    return false;
+
+  auto& data = mesh.data();
+
+  for (int i = 0; i < data.vertexCount; ++i)
+  {
+    const auto& v = data.vertices[i];
+
+    fprintf(file, "v %.9g %.9g %.9g\n", v.x, v.y, v.z);
+  }
+  if (mesh.hasUV())
+    for (int i = 0; i < data.vertexCount; ++i)
+      fprintf(file, "vt %.9g %.9g\n", data.uv[i].x, data.uv[i].y);
+  if (mesh.hasVertexNormals())
+    for (int i = 0; i < data.vertexCount; ++i)
+    {
+      const auto& n = data.vertexNormals[i];
+
+      fprintf(file, "vn %.9g %.9g %.9g\n", n.x, n.y, n.z);
+    }
+  for (int i = 0; i < data.triangleCount; ++i)
+  {
+    auto v = data.triangles[i].v;
+
+    fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n",
+      v[0] + 1, v[0] + 1, v[0] + 1,
+      v[1] + 1, v[1] + 1, v[1] + 1,
+      v[2] + 1, v[2] + 1, v[2] + 1);
+  }
+  return fclose(file) == 0;
+}
+
+//
+// Returns true if the arrays of a and b are equal. The normals are
+// compared with a tolerance, since the reader normalizes them.
+//
+bool
+equal(const TriangleMesh& a, const TriangleMesh& b)
+{
+  auto& da = a.data();
+  auto& db = b.data();
+  auto nv = size_t(da.vertexCount);
+
+  if (da.vertexCount != db.vertexCount ||
+    da.triangleCount != db.triangleCount ||
+    a.hasUV() != b.hasUV())
+    return false;
+  for (size_t i = 0; i < nv; ++i)
+    if ((da.vertexNormals[i] - db.vertexNormals[i]).squaredNorm() > 1e-12f)
+      return false;
+  return !memcmp(da.vertices, db.vertices, nv * sizeof(vec3f)) &&
+    (!a.hasUV() || !memcmp(da.uv, db.uv, nv * sizeof(vec2f))) &&
+    !memcmp(da.triangles,
+      db.triangles,
+      da.triangleCount * sizeof(TriangleMesh::Triangle));
+}
+
+//
+// Times writing mesh, which must have normals and uv, to an OBJ
+// file, and checks that the file is read back as the same mesh.
+//
+void
+benchOBJWrite(const TriangleMesh& mesh, const Options& options)
+{
+  using Writer = bool (*)(const TriangleMesh&, const char*);
+  static const struct
+  {
+    const char* name;
+    Writer write;
+  } writers[]
+  {
+    {"fprintf", writeOBJPrintf},
+    {"writeOBJ", [](const TriangleMesh& m, const char* s)
+      {
+        return MeshWriter::writeOBJ(m, s);
+      }},
+    {"writeOBJ+p", [](const TriangleMesh& m, const char* s)
+      {
+        return MeshWriter::writeOBJ(m, s, true);
+      }}
+  };
+  auto path = std::filesystem::temp_directory_path() / "meshbench.out.obj";
+  auto filename = path.string();
+
+  printf("%-10s %10s %10s %10s\n", "Writer", "Time (ms)", "MB/s", "Equal");
+  for (auto& writer : writers)
+  {
+    auto best = std::numeric_limits<double>::max();
+
+    for (int i = 0; i < options.runs; ++i)
+    {
+      Stopwatch sw;
+
+      sw.start();
+      if (!writer.write(mesh, filename.c_str()))
+      {
+        fprintf(stderr, "Unable to write %s\n", filename.c_str());
+        return;
+      }
+      best = std::min(best, sw.time());
+    }
+
+    auto size = std::filesystem::file_size(path) / double(1 << 20);
+    Reference<TriangleMesh> m{MeshReader::readOBJ(filename.c_str())};
+
+    printf("%-10s %10.1f %10.1f %10s\n",
+      writer.name,
+      best,
+      size * 1000 / best,
+      m != nullptr && equal(mesh, *m) ? "yes" : "no");
+  }
+  std::filesystem::remove(path);
+}
+
+//
+// Writes mesh to a binary PLY file with vertex positions, normals
+// and uv, in the given byte order.
+//
+bool
+writePLY(const TriangleMesh& mesh, const char* filename, std::endian order)
+{
+  auto file = fopen(filename, "wb");
+
+  if (file == nullptr)
+    return false;
+
+  auto& data = mesh.data();
+  auto swap = order != std::endian::native;
+  auto put = [file, swap](const void* p, size_t n)
+    {
+      uint8_t bytes[4];
+
+      memcpy(bytes, p, n);
+      if (swap)
+        std::reverse(bytes, bytes + n);
+      fwrite(bytes, n, 1, file);
+    };
+
+  fprintf(file,
+    "ply\nformat binary_%s_endian 1.0\n"
+    "element vertex %d\n"
+    "property float x\nproperty float y\nproperty float z\n"
+    "property float nx\nproperty float ny\nproperty float nz\n"
+    "property float u\nproperty float v\n"
+    "element face %d\n"
+    "property list uchar int vertex_indices\nend_header\n",
+    order == std::endian::little ? "little" : "big",
+    data.vertexCount,
+    data.triangleCount);
+  for (int i = 0; i < data.vertexCount; ++i)
+  {
+    const float* attributes[]
+    {
+      &data.vertices[i].x,
+      &data.vertexNormals[i].x,
+      &data.uv[i].x
+    };
+
+    for (int a = 0; a < 3; ++a)
+      for (int k = 0; k < (a < 2 ? 3 : 2); ++k)
+        put(attributes[a] + k, 4);
+  }
+  for (int i = 0; i < data.triangleCount; ++i)
+  {
+    uint8_t n = 3;
+
+    put(&n, 1);
+    for (auto v : data.triangles[i].v)
+      put(&v, 4);
+  }
+  return fclose(file) == 0;
+}
+
+//
+// Writes mesh to a binary STL file, with null facet normals.
+//
+bool
+writeSTL(const TriangleMesh& mesh, const char* filename)
+{
+  auto file = fopen(filename, "wb");
+
+  if (file == nullptr)
+    return false;
+
+  auto& data = mesh.data();
+  char header[80]{"meshbench"};
+  uint32_t n = data.triangleCount;
+
+  fwrite(header, sizeof header, 1, file);
+  fwrite(&n, sizeof n, 1, file);
+  for (int i = 0; i < data.triangleCount; ++i)
+  {
+    float facet[12]{};
+    uint16_t attributes{};
+
+    for (int k = 0; k < 3; ++k)
+      memcpy(facet + 3 * (k + 1),
+        &data.vertices[data.triangles[i].v[k]],
+        sizeof(vec3f));
+    fwrite(facet, sizeof facet, 1, file);
+    fwrite(&attributes, sizeof attributes, 1, file);
+  }
+  return fclose(file) == 0;
+}
+
+//
+// Writes mesh, which must have normals and uv, to PLY and STL files
+// and times reading them back.
+//
+void
+benchPLYSTL(const TriangleMesh& mesh, const Options& options)
+{
+  static const struct
+  {
+    const char* name;
+    const char* extension;
+    std::endian order;
+  } formats[]
+  {
+    {"ply (le)", ".ply", std::endian::little},
+    {"ply (be)", ".ply", std::endian::big},
+    {"stl", ".stl", std::endian::little}
+  };
+
+  printf("%-10s %10s %10s %10s %12s %10s\n",
+    "Format",
+    "Size (MB)",
+    "Time (ms)",
+    "MB/s",
+    "Vertices",
+    "Equal");
+  for (auto& format : formats)
+  {
+    auto path = std::filesystem::temp_directory_path() / "meshbench";
+
+    path += format.extension;
+
+    auto filename = path.string();
+    auto ok = !strcmp(format.extension, ".stl") ?
+      writeSTL(mesh, filename.c_str()) :
+      writePLY(mesh, filename.c_str(), format.order);
+
+    if (!ok)
+    {
+      fprintf(stderr, "Unable to write %s\n", filename.c_str());
+      return;
+    }
+
+    auto size = std::filesystem::file_size(path) / double(1 << 20);
+    auto best = std::numeric_limits<double>::max();
+    Reference<TriangleMesh> m;
+
+    for (int i = 0; i < options.runs; ++i)
+    {
+      Stopwatch sw;
+
+      m = nullptr;
+      sw.start();
+      m = MeshReader::read(filename.c_str());
+      best = std::min(best, sw.time());
+      if (m == nullptr)
+      {
+        fprintf(stderr, "Unable to read %s\n", filename.c_str());
+        return;
+      }
+    }
+
+    // STL files have no normals and uv, and its vertices are welded
+    // in the order they are referenced by the triangles
+    auto same = false;
+
+    if (!strcmp(format.extension, ".stl"))
+    {
+      auto& d0 = mesh.data();
+      auto& d1 = m->data();
+
+      same = d0.triangleCount == d1.triangleCount;
+      for (int i = 0; same && i < d0.triangleCount; ++i)
+        for (int k = 0; k < 3; ++k)
+          same &= d0.vertices[d0.triangles[i].v[k]] ==
+            d1.vertices[d1.triangles[i].v[k]];
+    }
+    else
+      same = equal(mesh, *m);
+    printf("%-10s %10.1f %10.1f %10.1f %12d %10s\n",
+      format.name,
+      size,
+      best,
+      size * 1000 / best,
+      m->data().vertexCount,
+      same ? "yes" : "no");
+    m = nullptr;
+    std::filesystem::remove(path);
+  }
+}
+
+//
+// Writes mesh and its BVH to a triangle mesh file and times reading
+// the file and making the BVH of the mesh read.
+//
+void
+benchMeshFile(const TriangleMesh& mesh, const Options& options)
+{
+  auto path = std::filesystem::temp_directory_path() / "meshbench.cgm";
+  auto filename = path.string();
+  Reference<TriangleMeshBVH> bvh;
+  Stopwatch sw;
+
+  sw.start();
+  bvh = new TriangleMeshBVH{mesh};
+
+  auto buildTime = sw.time();
+
+  if (!MeshWriter::writeMesh(mesh, filename.c_str(), bvh))
+  {
+    fprintf(stderr, "Unable to write %s\n", filename.c_str());
+    return;
+  }
+  printf("Mesh file: %.1f MB, BVH built in %.1f ms\n",
+    std::filesystem::file_size(path) / double(1 << 20),
+    buildTime);
+  for (auto verify : {false, true})
+  {
+    auto best = std::numeric_limits<double>::max();
+    auto bvhTime = best;
+
+    for (int i = 0; i < options.runs; ++i)
+    {
+      Stopwatch sw1;
+
+      sw1.start();
+
+      Reference<TriangleMesh> m{MeshReader::readMesh(filename.c_str(),
+        verify)};
+
+      best = std::min(best, sw1.time());
+      if (m == nullptr)
+      {
+        fprintf(stderr, "Unable to read %s\n", filename.c_str());
+        return;
+      }
+
+      Stopwatch sw2;
+
+      sw2.start();
+      bvh = TriangleMeshBVH::make(*m);
+      bvhTime = std::min(bvhTime, sw2.time());
+    }
+    printf("%-8s %10.1f ms (BVH %.1f ms)\n",
+      verify ? "cgm+v" : "cgm",
+      best,
+      bvhTime);
+  }
+  bvh = nullptr;
+  std::filesystem::remove(path);
+}
+
+//
+// Returns count rays shot downwards over mesh, in random order.
+//
+std::vector<Ray3f>
+downwardRays(const TriangleMesh& mesh, int count)
+{
+  std::mt19937 rng{1};
+  std::uniform_real_distribution<float> uniform{0, 1};
+  std::vector<Ray3f> rays;
+  const auto& b = mesh.bounds();
+  auto size = b.size();
+
+  rays.reserve(count);
+  for (int i = 0; i < count; ++i)
+  {
+    vec3f o{b.min().x + uniform(rng) * size.x,
+      b.min().y + uniform(rng) * size.y,
+      b.max().z + 1};
+    vec3f d{uniform(rng) - 0.5f, uniform(rng) - 0.5f, -4};
+
+    rays.emplace_back(o, d);
+  }
+  return rays;
+}
+
+//
+// Writes mesh to a chunked triangle mesh file and traces rays, in
+// coherent and random order, against the mesh read from the file
+// within a residency budget smaller than the file, reporting the
+// paging statistics. The closest hits are checked against a BVH of
+// mesh.
+//
+void
+benchChunkedMesh(const TriangleMesh& mesh, const Options& options)
+{
+  auto path = std::filesystem::temp_directory_path() / "meshbench.chunked.cgm";
+  auto filename = path.string();
+  Stopwatch sw;
+
+  sw.start();
+  if (!MeshWriter::writeChunkedMesh(mesh,
+    filename.c_str(),
+    options.chunkTriangleCount))
+  {
+    fprintf(stderr, "Unable to write %s\n", filename.c_str());
+    return;
+  }
+
+  auto writeTime = sw.time();
+  Reference<ChunkedTriangleMesh> chunked{ChunkedTriangleMesh::open(
+    filename.c_str())};
+
+  if (chunked == nullptr)
+  {
+    fprintf(stderr, "Unable to open %s\n", filename.c_str());
+    std::filesystem::remove(path);
+    return;
+  }
+
+  auto fileSize = std::filesystem::file_size(path);
+  auto budget = options.residencyBudget << 20;
+
+  if (budget == 0)
+    budget = fileSize / 4;
+  printf("\nChunked mesh file: %.1f MB, %d chunks, written in %.1f ms\n",
+    fileSize / double(1 << 20),
+    chunked->chunkCount(),
+    writeTime);
+
+  // Closest hits against a BVH of the whole mesh
+  auto rays = downwardRays(mesh, 1 << 20);
+  auto n = rays.size();
+  std::vector<float> distances(n);
+
+  {
+    Reference<TriangleMeshBVH> bvh = new TriangleMeshBVH{mesh};
+
+    parallelFor(n, 4096, [&](size_t begin, size_t end)
+      {
+        for (auto i = begin; i < end; ++i)
+        {
+          Ray3f r{rays[i]};
+          Intersection hit;
+
+          distances[i] = bvh->intersect(r, hit) ? hit.distance : -1;
+        }
+      });
+  }
+
+  // Coherent rays are sorted in rows of the points where they cross
+  // the middle plane of the bounds of mesh
+  const auto& b = mesh.bounds();
+  std::vector<vec3f> points(n);
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    const auto& r = rays[i];
+
+    points[i] = r((b.center().z - r.origin.z) / r.direction.z);
+  }
+
+  std::vector<uint32_t> coherent(n);
+  auto rowHeight = b.size().y / 256;
+  auto row = [&](uint32_t i)
+    {
+      return int((points[i].y - b.min().y) / rowHeight);
+    };
+
+  std::iota(coherent.begin(), coherent.end(), 0);
+  std::sort(coherent.begin(), coherent.end(), [&](uint32_t i, uint32_t j)
+    {
+      auto ri = row(i);
+      auto rj = row(j);
+
+      return ri != rj ? ri < rj : points[i].x < points[j].x;
+    });
+
+  std::vector<uint32_t> random(n);
+
+  std::iota(random.begin(), random.end(), 0);
+  printf("Budget %.1f MB, %zu rays\n", budget / double(1 << 20), n);
+  printf("%-8s %10s %10s %8s %10s %10s %10s %10s\n",
+    "Order",
+    "Time (ms)",
+    "Mrays/s",
+    "Wrong",
+    "Hits",
+    "Page-ins",
+    "Page-outs",
+    "Peak (MB)");
+  for (auto order : {&coherent, &random})
+  {
+    auto best = std::numeric_limits<double>::max();
+    std::atomic<size_t> wrong;
+    ChunkedTriangleMesh::Statistics stats;
+
+    for (int i = 0; i < options.runs; ++i)
+    {
+      // Start with no resident chunks
+      chunked->setResidencyBudget(0);
+      chunked->setResidencyBudget(budget);
+      chunked->resetStatistics();
+      wrong = 0;
+      sw.start();
+      parallelFor(n, 4096, [&](size_t begin, size_t end)
+        {
+          size_t w{};
+
+          for (auto k = begin; k < end; ++k)
+          {
+            auto j = (*order)[k];
+            Ray3f r{rays[j]};
+            Intersection hit;
+            auto d = chunked->intersect(r, hit) ? hit.distance : -1;
+
+            w += std::abs(d - distances[j]) > 1e-4f;
+          }
+          wrong += w;
+        });
+      best = std::min(best, sw.time());
+      stats = chunked->statistics();
+    }
+    printf("%-8s %10.1f %10.2f %8zu %10zu %10zu %10zu %10.1f\n",
+      order == &coherent ? "coherent" : "random",
+      best,
+      n / best * 1e-3,
+      wrong.load(),
+      stats.hits,
+      stats.pageIns,
+      stats.pageOuts,
+      stats.peakResidentBytes / double(1 << 20));
+  }
+  chunked = nullptr;
+  std::filesystem::remove(path);
+}
+
+//
+// Returns a copy of the vertices and triangles of mesh. If shuffle
+// is true, the triangles and vertices of the copy are shuffled, as
+// in a mesh exported without any order.
+//
+TriangleMesh*
+copyMesh(const TriangleMesh& mesh, bool shuffle)
+{
+  auto& data = mesh.data();
+  auto nv = data.vertexCount;
+  auto nt = data.triangleCount;
+  TriangleMesh::Data d{nv,
+    nt,
+    new vec3f[nv],
+    nullptr,
+    nullptr,
+    new TriangleMesh::Triangle[nt]};
+
+  std::copy_n(data.vertices, nv, d.vertices);
+  std::copy_n(data.triangles, nt, d.triangles);
+
+  auto m = new TriangleMesh{std::move(d)};
+
+  if (shuffle)
+  {
+    std::mt19937 rng{1};
+    std::vector<int> p(nt);
+
+    std::iota(p.begin(), p.end(), 0);
+    std::shuffle(p.begin(), p.end(), rng);
+    m->reorderTriangles(p.data());
+    p.resize(nv);
+    std::iota(p.begin(), p.end(), 0);
+    std::shuffle(p.begin(), p.end(), rng);
+    m->remapVertices(p.data());
+  }
+  return m;
+}
+
+//
+// Returns the best time to trace rays against a BVH of mesh.
+//
+double
+traceTime(const TriangleMesh& mesh,
+  const std::vector<Ray3f>& rays,
+  const Options& options)
+{
+  Reference<TriangleMeshBVH> bvh = new TriangleMeshBVH{mesh};
+  auto best = std::numeric_limits<double>::max();
+  int hits{};
+
+  for (int i = 0; i < options.runs; ++i)
+  {
+    Stopwatch sw;
+
+    sw.start();
+    for (const auto& ray : rays)
+    {
+      // The closest hit shortens the ray, so a copy is traced
+      Ray3f r{ray};
+      Intersection hit;
+
+      hits += bvh->intersect(r, hit);
+    }
+    best = std::min(best, sw.time());
+  }
+  return hits > 0 ? best : 0;
+}
+
+//
+// Reports the vertex cache statistics of mesh before and after
+// optimizing it with MeshOptimizer, and the time to trace rays
+// against the BVHs of the meshes. The same is done for a copy of
+// mesh whose triangles and vertices are shuffled.
+//
+void
+benchOptimize(const TriangleMesh& mesh, const Options& options)
+{
+  auto rays = downwardRays(mesh, 1 << 20);
+
+  printf("\nVertex cache (ACMR/ATVR, FIFO of 16 and 32 entries), "
+    "%zu rays\n",
+    rays.size());
+  printf("%-10s %7s %7s %7s %7s %10s %10s\n",
+    "Mesh",
+    "ACMR16",
+    "ATVR16",
+    "ACMR32",
+    "ATVR32",
+    "Opt (ms)",
+    "Rays (ms)");
+  for (auto shuffle : {false, true})
+  {
+    Reference<TriangleMesh> m{copyMesh(mesh, shuffle)};
+
+    for (auto optimize : {false, true})
+    {
+      double time{};
+
+      if (optimize)
+      {
+        Stopwatch sw;
+
+        sw.start();
+        MeshOptimizer::optimize(*m);
+        time = sw.time();
+      }
+
+      auto s16 = MeshOptimizer::analyzeVertexCache(*m, 16);
+      auto s32 = MeshOptimizer::analyzeVertexCache(*m, 32);
+
+      printf("%-10s %7.3f %7.3f %7.3f %7.3f %10.1f %10.1f\n",
+        optimize ? "optimized" : shuffle ? "shuffled" : "input",
+        s16.acmr,
+        s16.atvr,
+        s32.acmr,
+        s32.atvr,
+        time,
+        traceTime(*m, rays, options));
+    }
+  }
+}
+
+//
+// Times computing the normals, transforming and bounding a copy of
+// mesh.
+//
+void
+benchMeshOps(const TriangleMesh& mesh, const Options& options)
+{
+  Reference<TriangleMesh> m{copyMesh(mesh, false)};
+  auto trs = mat4f::TRS(vec3f{1, 2, 3}, vec3f{30, 45, 10}, vec3f{2});
+  double best[3];
+
+  std::fill_n(best, 3, std::numeric_limits<double>::max());
+  for (int i = 0; i < options.runs; ++i)
+  {
+    Stopwatch sw;
+
+    sw.start();
+    m->computeNormals();
+    best[0] = std::min(best[0], sw.lap());
+    m->TRS(trs);
+    best[1] = std::min(best[1], sw.lap());
+    m->bounds();
+    best[2] = std::min(best[2], sw.lap());
+  }
+  printf("\ncomputeNormals %.1f ms, TRS %.1f ms, bounds %.1f ms\n",
+    best[0],
+    best[1],
+    best[2]);
+}
+
+//
+// Times making the levels of detail of mesh.
+//
+void
+benchLOD(const TriangleMesh& mesh)
+{
+  Stopwatch sw;
+
+  sw.start();
+
+  Reference<TriangleMeshLOD> lod = new TriangleMeshLOD{mesh};
+  auto time = sw.time();
+  auto& b = mesh.bounds();
+
+  printf("\nLevels of detail made in %.1f ms (mesh size %g)\n",
+    time,
+    b.size().max());
+  printf("%-6s %12s %12s\n", "Level", "Triangles", "Error");
+  printf("%-6d %12d %12g\n", 0, mesh.data().triangleCount, 0.0);
+  for (int i = 0; i < lod->levelCount(); ++i)
+  {
+    const auto& level = lod->level(i);
+
+    printf("%-6d %12d %12g\n",
+      i + 1,
+      level.mesh->data().triangleCount,
+      level.error);
+  }
+}
+
+//
+// Times building the half-edge adjacency of mesh.
+//
+void
+benchAdjacency(const TriangleMesh& mesh, const Options& options)
+{
+  Reference<TriangleMeshAdjacency> a;
+  auto best = std::numeric_limits<double>::max();
+
+  for (int i = 0; i < options.runs; ++i)
+  {
+    Stopwatch sw;
+
+    sw.start();
+    a = new TriangleMeshAdjacency{mesh};
+    best = std::min(best, sw.time());
+  }
+  printf("\nAdjacency built in %.1f ms (%.1f M edges/s, %zu bytes)\n",
+    best,
+    a->edgeCount() / best * 1e-3,
+    a->memorySize());
+  printf("Edges: %d, boundary: %d, non-manifold: %d\n",
+    a->edgeCount(),
+    a->boundaryEdgeCount(),
+    a->nonManifoldEdgeCount());
+}
+
+void
+benchFile(const char* filename, const Options& options)
+{
+  using Reader = TriangleMesh* (*)(const char*);
+  static const struct
+  {
+    const char* name;
+    Reader read;
+  } readers[]
+  {
+    {"stdio", MeshReader::readOBJSequential},
+    {"mapped", [](const char* s) { return MeshReader::readOBJ(s, false); }},
+    {"mapped+a", [](const char* s) { return MeshReader::readOBJ(s); }}
+  };
+  constexpr auto readerCount = int(std::size(readers));
+  auto size = double(std::filesystem::file_size(filename)) / (1 << 20);
+  Reference<TriangleMesh> meshes[readerCount];
+
+  printf("\n%s: %.1f MB\n", filename, size);
+  printf("%-8s %10s %10s %12s %12s %12s %4s\n",
+    "Reader",
+    "Time (ms)",
+    "MB/s",
+    "Vertices",
+    "Triangles",
+    "Memory (MB)",
+    "UV");
+  for (int r = 0; r < readerCount; ++r)
+  {
+    auto best = std::numeric_limits<double>::max();
+
+    for (int i = 0; i < options.runs; ++i)
+    {
+      Stopwatch sw;
+
+      meshes[r] = nullptr;
+      sw.start();
+      meshes[r] = readers[r].read(filename);
+      best = std::min(best, sw.time());
+      if (meshes[r] == nullptr)
+      {
+        fprintf(stderr, "Unable to read %s\n", filename);
+        return;
+      }
+    }
+
+    auto& mesh = *meshes[r];
+
+    printf("%-8s %10.1f %10.1f %12d %12d %12.1f %4s\n",
+      readers[r].name,
+      best,
+      size * 1000 / best,
+      mesh.data().vertexCount,
+      mesh.data().triangleCount,
+      memorySize(mesh) / double(1 << 20),
+      mesh.hasUV() ? "yes" : "no");
+  }
+  for (int r = 1; r < readerCount; ++r)
+  {
+    auto& d0 = meshes[0]->data();
+    auto& d1 = meshes[r]->data();
+
+    printf("%s: ", readers[r].name);
+    if (d0.vertexCount != d1.vertexCount ||
+      d0.triangleCount != d1.triangleCount)
+      puts("the mesh differs in size from the stdio one");
+    else
+    {
+      auto [nv, nt] = compare(*meshes[0], *meshes[r]);
+
+      printf("%zu vertices, %zu triangles differ from the stdio mesh\n",
+        nv,
+        nt);
+    }
+  }
+  benchOBJWrite(*meshes[readerCount - 1], options);
+  benchPLYSTL(*meshes[readerCount - 1], options);
+  benchMeshFile(*meshes[readerCount - 1], options);
+  benchChunkedMesh(*meshes[readerCount - 1], options);
+  benchOptimize(*meshes[readerCount - 1], options);
+  benchMeshOps(*meshes[readerCount - 1], options);
+  benchLOD(*meshes[readerCount - 1]);
+  benchAdjacency(*meshes[readerCount - 1], options);
+}
+
+void
+usage()
+{
+  puts("Usage: meshbench [options] [file.obj...]\n"
+    "Options:\n"
+    "  --size n         size in MB of the generated OBJ file (default 1024)\n"
+    "  --runs n         number of runs per reader; the best is reported\n"
+    "  --keep           keep the generated OBJ file\n"
+    "  --chunk n        triangles per chunk of the chunked mesh file\n"
+    "  --budget n       residency budget in MB of the chunked mesh\n"
+    "                   (default a quarter of the file)\n"
+    "The OBJ file is generated only if no file is given.");
+}
+
+} // end namespace
+
+int
+main(int argc, char** argv)
+{
+  Options options;
+  std::vector<const char*> files;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    auto arg = argv[i];
+    auto hasValue = i + 1 < argc;
+
+    if (!strcmp(arg, "--size") && hasValue)
+      options.generatedSize = std::max(1ull, strtoull(argv[++i], nullptr, 10));
+    else if (!strcmp(arg, "--runs") && hasValue)
+      options.runs = std::max(1, atoi(argv[++i]));
+    else if (!strcmp(arg, "--keep"))
+      options.keep = true;
+    else if (!strcmp(arg, "--chunk") && hasValue)
+      options.chunkTriangleCount = std::max(1, atoi(argv[++i]));
+    else if (!strcmp(arg, "--budget") && hasValue)
+      options.residencyBudget = strtoull(argv[++i], nullptr, 10);
+    else if (*arg == '-')
+    {
+      usage();
+      return 1;
+    }
+    else
+      files.push_back(arg);
+  }
+  printf("Threads: %u\n", parallelThreadCount());
+  if (!files.empty())
+  {
+    for (auto file : files)
+      benchFile(file, options);
+    return 0;
+  }
+
+  auto path = std::filesystem::temp_directory_path() / "meshbench.obj";
+  auto filename = path.string();
+
+  printf("Writing %s...\n", filename.c_str());
+  if (!writeTerrain(filename.c_str(), options.generatedSize))
+  {
+    fprintf(stderr, "Unable to write %s\n", filename.c_str());
+    return 1;
+  }
+  benchFile(filename.c_str(), options);
+  if (!options.keep)
+    std::filesystem::remove(path);
+  return 0;
+}
@@ -0,0 +1,156 @@
+//[]---------------------------------------------------------------[]
+//|                                                                 |
+//| Copyright (C) 2026 Paulo Pagliosa.                              |
+//|                                                                 |
+//| This software is provided 'as-is', without any express or       |
+//| implied warranty. In no event will the authors be held liable   |
+//| for any damages arising from the use of this software.          |
+//|                                                                 |
+//| Permission is granted to anyone to use this software for any    |
+//| purpose, including commercial applications, and to alter it and |
+//| redistribute it freely, subject to the following restrictions:  |
+//|                                                                 |
+//| 1. The origin of this software must not be misrepresented; you  |
+//| must not claim that you wrote the original software. If you use |
+//| this software in a product, an acknowledgment in the product    |
+//| documentation would be appreciated but is not required.         |
+//|                                                                 |
+//| 2. Altered source versions must be plainly marked as such, and  |
+//| must not be misrepresented as being the original software.      |
+//|                                                                 |
+//| 3. This notice may not be removed or altered from any source    |
+//| distribution.                                                   |
+//|                                                                 |
+//[]---------------------------------------------------------------[]
+//
+// OVERVIEW: MeshConvert.cpp
+// ========
+// Converter from OBJ files to triangle mesh files.
+//
+// Author: Paulo Pagliosa
+// Last revision: 19/10/2026
+
+#include "geometry/ChunkedTriangleMesh.h"
+#include "geometry/TriangleMeshBVH.h"
+#include "utils/MeshReader.h"
+#include "utils/MeshWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace cg;
+
+namespace
+{ // begin namespace
+
+void
+usage()
+{
+  puts("Usage: meshconvert [options] input.obj output.cgm\n"
+    "Options:\n"
+    "  --bvh            store a BVH of the mesh in the output file\n"
+    "  --chunk n        write a chunked mesh file with up to n triangles\n"
+    "                   per chunk, each with a BVH\n"
+    "  --leaf n         maximum number of triangles per leaf (default 20)\n"
+    "  --split name     sah, median or spatial (default sah)");
+}
+
+} // end namespace
+
+int
+main(int argc, char** argv)
+{
+  auto bvh = false;
+  auto chunkTriangleCount = 0;
+  uint32_t maxTrianglesPerNode = 20;
+  auto splitMethod = BVHBase::SAH;
+  std::vector<const char*> files;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    auto arg = argv[i];
+    auto hasValue = i + 1 < argc;
+
+    if (!strcmp(arg, "--bvh"))
+      bvh = true;
+    else if (!strcmp(arg, "--chunk") && hasValue)
+      chunkTriangleCount = std::max(1, atoi(argv[++i]));
+    else if (!strcmp(arg, "--leaf") && hasValue)
+      maxTrianglesPerNode = std::max(1, atoi(argv[++i]));
+    else if (!strcmp(arg, "--split") && hasValue)
+    {
+      std::string name{argv[++i]};
+
+      if (name == "sah")
+        splitMethod = BVHBase::SAH;
+      else if (name == "median")
+        splitMethod = BVHBase::Median;
+      else if (name == "spatial")
+        splitMethod = BVHBase::Spatial;
+      else
+      {
+        usage();
+        return 1;
+      }
+    }
+    else if (*arg == '-')
+    {
+      usage();
+      return 1;
+    }
+    else
+      files.push_back(arg);
+  }
+  if (files.size() != 2)
+  {
+    usage();
+    return 1;
+  }
+
+  Reference<TriangleMesh> mesh{MeshReader::readOBJ(files[0])};
+
+  if (mesh == nullptr)
+  {
+    fprintf(stderr, "Unable to read %s\n", files[0]);
+    return 1;
+  }
+
+  if (chunkTriangleCount > 0)
+  {
+    Reference<ChunkedTriangleMesh> chunked;
+
+    if (MeshWriter::writeChunkedMesh(*mesh,
+      files[1],
+      chunkTriangleCount,
+      maxTrianglesPerNode))
+      chunked = ChunkedTriangleMesh::open(files[1]);
+    if (chunked == nullptr)
+    {
+      fprintf(stderr, "Unable to write %s\n", files[1]);
+      return 1;
+    }
+    printf("%s: %d vertices, %d triangles, %d chunks\n",
+      files[1],
+      chunked->vertexCount(),
+      chunked->triangleCount(),
+      chunked->chunkCount());
+    return 0;
+  }
+
+  Reference<TriangleMeshBVH> meshBVH;
+
+  if (bvh)
+    meshBVH = new TriangleMeshBVH{*mesh, maxTrianglesPerNode, splitMethod};
+  if (!MeshWriter::writeMesh(*mesh, files[1], meshBVH))
+  {
+    fprintf(stderr, "Unable to write %s\n", files[1]);
+    return 1;
+  }
+  printf("%s: %d vertices, %d triangles%s\n",
+    files[1],
+    mesh->data().vertexCount,
+    mesh->data().triangleCount,
+    bvh ? ", BVH" : "");
+  return 0;
+}